@@ -33,11 +33,17 @@
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
 #include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
 #include <vtkMRMLAstroModelingParametersNode.h>
 #include <vtkMRMLTableNode.h>
 
+// vtkFits includes
+#include <vtkFITSHeader.h>
+
 // VTK includes
+#include <vtkBitArray.h>
 #include <vtkCacheManager.h>
+#include <vtkDataArray.h>
 #include <vtkImageData.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
@@ -51,6 +57,11 @@
 #include <cassert>
 #include <iostream>
 
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
 // Qt includes
 #include <QtDebug>
 
@@ -159,18 +170,6 @@ template <typename T> T StringToNumber(const char* num)
   return ss >> result ? result : 0;
 }
 
-//----------------------------------------------------------------------------
-int StringToInt(const char* str)
-{
-  return StringToNumber<int>(str);
-}
-
-//----------------------------------------------------------------------------
-long StringToLong(const char* str)
-{
-  return StringToNumber<long>(str);
-}
-
 //----------------------------------------------------------------------------
 float StringToFloat(const char* str)
 {
@@ -193,12 +192,6 @@ template <typename T> std::string NumberToString(T V)
   return stringValue;
 }
 
-//----------------------------------------------------------------------------
-std::string IntToString(int Value)
-{
-  return NumberToString<int>(Value);
-}
-
 //----------------------------------------------------------------------------
 std::string FloatToString(float Value)
 {
@@ -211,6 +204,32 @@ std::string DoubleToString(double Value)
   return NumberToString<double>(Value);
 }
 
+//----------------------------------------------------------------------------
+// BBarolo takes the mask as one bool per voxel: unpack the (cached)
+// bit-packed binary mask of the label map
+bool FillMask(vtkMRMLAstroLabelMapVolumeNode *maskVolume, bool *mask, vtkIdType numElements)
+{
+  vtkBitArray *binaryMask = maskVolume->GetBinaryMask();
+  if (!binaryMask || binaryMask->GetNumberOfTuples() != numElements)
+    {
+    return false;
+    }
+
+  const unsigned char *bits = binaryMask->GetPointer(0);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType ii = 0; ii < numElements; ii++)
+    {
+    // vtkBitArray stores the first value in the most significant bit
+    mask[ii] = (bits[ii >> 3] & (0x80 >> (ii & 7))) != 0;
+    }
+
+  // BBarolo keeps its own (bool) copy of the mask
+  maskVolume->ReleaseBinaryMask();
+  return true;
+}
+
 } // end namespace
 
 //----------------------------------------------------------------------------
@@ -543,57 +562,38 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
   this->Internal->par->setTOL(1.E-3);
 
   // set header
-  this->Internal->head->setBitpix(StringToInt(inputVolume->GetAttribute("SlicerAstro.BITPIX")));
-  int numAxes = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS"));
+  vtkFITSHeader *header = inputVolume->GetAstroHeader();
+  this->Internal->head->setBitpix(header->GetBITPIX());
+  int numAxes = header->GetNAXIS();
   this->Internal->head->setNumAx(numAxes);
-  string inputString;
 
   for (int ii = 0; ii < numAxes; ii++)
     {
-    inputString = "SlicerAstro.NAXIS";
-    inputString += IntToString(ii + 1);
-    this->Internal->head->setDimAx(ii,StringToLong(inputVolume->GetAttribute(inputString.c_str())));
-    inputString = "SlicerAstro.CRPIX";
-    inputString += IntToString(ii + 1);
-    this->Internal->head->setCrpix(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-    inputString = "SlicerAstro.CRVAL";
-    inputString += IntToString(ii + 1);
-    this->Internal->head->setCrval(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-    inputString = "SlicerAstro.CDELT";
-    inputString += IntToString(ii + 1);
-    this->Internal->head->setCdelt(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-    inputString = "SlicerAstro.CTYPE";
-    inputString += IntToString(ii + 1);
-    inputString = inputVolume->GetAttribute(inputString.c_str());
-    this->Internal->head->setCtype(ii, inputString);
-    inputString = "SlicerAstro.CUNIT";
-    inputString += IntToString(ii + 1);
-    inputString = inputVolume->GetAttribute(inputString.c_str());
-    this->Internal->head->setCunit(ii, inputString);
+    this->Internal->head->setDimAx(ii, header->GetNAXISi(ii));
+    this->Internal->head->setCrpix(ii, header->GetCRPIX(ii));
+    this->Internal->head->setCrval(ii, header->GetCRVAL(ii));
+    this->Internal->head->setCdelt(ii, header->GetCDELT(ii));
+    this->Internal->head->setCtype(ii, header->GetCTYPE(ii));
+    this->Internal->head->setCunit(ii, header->GetCUNIT(ii));
     }
 
-  this->Internal->head->setBmaj(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BMAJ")));
-  this->Internal->head->setBmin(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BMIN")));
-  this->Internal->head->setBpa(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BPA")));
-  this->Internal->head->setBzero(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BZERO")));
-  this->Internal->head->setBscale(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BSCALE")));
-  this->Internal->head->setBlank(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BLANK")));
-  this->Internal->head->setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
-  this->Internal->head->setEpoch(StringToFloat(inputVolume->GetAttribute("SlicerAstro.EPOCH")));
-  this->Internal->head->setFreq0(StringToDouble(inputVolume->GetAttribute("SlicerAstro.RESTFREQ")));
-  inputString = inputVolume->GetAttribute("SlicerAstro.BUNIT");
-  this->Internal->head->setBunit(inputString);
-  inputString = inputVolume->GetAttribute("SlicerAstro.BTYPE");
-  this->Internal->head->setBtype(inputString);
-  inputString = inputVolume->GetAttribute("SlicerAstro.OBJECT");
-  this->Internal->head->setName(inputString);
-  inputString = inputVolume->GetAttribute("SlicerAstro.TELESCOP");
-  this->Internal->head->setTelesc(inputString);
-  inputString = inputVolume->GetAttribute("SlicerAstro.DUNIT3");
-  this->Internal->head->setDunit3(inputString);
-  this->Internal->head->setDrval3(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DRVAL3")));
-  this->Internal->head->setDataMin(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DATAMIN")));
-  this->Internal->head->setDataMax(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DATAMAX")));
+  this->Internal->head->setBmaj(header->GetBMAJ());
+  this->Internal->head->setBmin(header->GetBMIN());
+  this->Internal->head->setBpa(header->GetBPA());
+  this->Internal->head->setBzero(header->GetBZERO());
+  this->Internal->head->setBscale(header->GetBSCALE());
+  this->Internal->head->setBlank(header->GetBLANK());
+  this->Internal->head->setCrota(header->GetCROTA());
+  this->Internal->head->setEpoch(header->GetEPOCH());
+  this->Internal->head->setFreq0(header->GetRESTFREQ());
+  this->Internal->head->setBunit(header->GetBUNIT());
+  this->Internal->head->setBtype(header->GetBTYPE());
+  this->Internal->head->setName(header->GetOBJECT());
+  this->Internal->head->setTelesc(header->GetTELESCOP());
+  this->Internal->head->setDunit3(header->GetDUNIT3());
+  this->Internal->head->setDrval3(header->GetDRVAL3());
+  this->Internal->head->setDataMin(header->GetDATAMIN());
+  this->Internal->head->setDataMax(header->GetDATAMAX());
   if(!this->Internal->head->saveWCSStruct(inputVolume->GetAstroVolumeDisplayNode()->GetWCSStruct()))
     {
     vtkErrorMacro("vtkSlicerAstroModelingLogic::FitModel : the WCS copy failed!")
@@ -611,7 +611,7 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
 
   int *dims = outputVolume->GetImageData()->GetDimensions();
   int numComponents = outputVolume->GetImageData()->GetNumberOfScalarComponents();
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   switch (DataType)
     {
@@ -626,24 +626,19 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
 
       this->Internal->cubeF->saveParam(*this->Internal->par);
       this->Internal->cubeF->saveHead(*this->Internal->head);
-      this->Internal->cubeF->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+      this->Internal->cubeF->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
       this->Internal->cubeF->setCube(static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer()), dims);
 
       // Feed segmentation mask to cube
       if (maskActive)
         {
-        short* segmentationMaskPointer = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer());
         bool* mask = new bool[numElements];
-        for(int ii = 0; ii < numElements; ii++)
+        if (!FillMask(maskVolume, mask, numElements))
           {
-          if (*(segmentationMaskPointer + ii) > 0)
-            {
-            *(mask + ii) = true;
-            }
-          else
-            {
-            *(mask + ii) = false;
-            }
+          delete [] mask;
+          vtkErrorMacro("vtkSlicerAstroModelingLogic::FitModel :"
+                        " mask data type or dimensions not supported.");
+          return 0;
           }
 
         this->Internal->cubeF->setMask(mask);
@@ -784,7 +779,7 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
 
         float *outFPixel = static_cast<float*> (outputVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           *(outFPixel + ii) = *(outarray + ii);
           }
@@ -792,7 +787,7 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
         float *inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer());
         float *residualFPixel = static_cast<float*> (residualVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           if (*(outFPixel + ii) < 1.E-6)
             {
@@ -819,24 +814,19 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
 
       this->Internal->cubeD->saveParam(*this->Internal->par);
       this->Internal->cubeD->saveHead(*this->Internal->head);
-      this->Internal->cubeD->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+      this->Internal->cubeD->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
       this->Internal->cubeD->setCube(static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer()), dims);
 
       // Feed segmentation mask to cube
       if (maskActive)
         {
-        short* segmentationMaskPointer = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer());
         bool* mask = new bool[numElements];
-        for(int ii = 0; ii < numElements; ii++)
+        if (!FillMask(maskVolume, mask, numElements))
           {
-          if (*(segmentationMaskPointer + ii) > 0)
-            {
-            *(mask + ii) = true;
-            }
-          else
-            {
-            *(mask + ii) = false;
-            }
+          delete [] mask;
+          vtkErrorMacro("vtkSlicerAstroModelingLogic::FitModel :"
+                        " mask data type or dimensions not supported.");
+          return 0;
           }
 
         this->Internal->cubeD->setMask(mask);
@@ -976,7 +966,7 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
 
         double *outDPixel = static_cast<double*> (outputVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           *(outDPixel + ii) = *(outarray + ii);
           }
@@ -984,7 +974,7 @@ int vtkSlicerAstroModelingLogic::FitModel(vtkMRMLAstroModelingParametersNode* pn
         double *inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer());
         double *residualDPixel = static_cast<double*> (residualVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           if (*(outDPixel + ii) < 1.E-6)
             {
@@ -1288,10 +1278,14 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
                     " residualVolume not found!");
     }
 
+  // the voxels of the output volumes are written in place
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(outputVolume);
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(residualVolume);
+
   const int DataType = outputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
   int *dims = outputVolume->GetImageData()->GetDimensions();
   int numComponents = outputVolume->GetImageData()->GetNumberOfScalarComponents();
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   if (!this->Internal->fitF && !this->Internal->fitD)
     { 
@@ -1513,57 +1507,38 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
     this->Internal->par->setTOL(1.E-3);
 
     // set header
-    this->Internal->head->setBitpix(StringToInt(inputVolume->GetAttribute("SlicerAstro.BITPIX")));
-    int numAxes = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS"));
+    vtkFITSHeader *header = inputVolume->GetAstroHeader();
+    this->Internal->head->setBitpix(header->GetBITPIX());
+    int numAxes = header->GetNAXIS();
     this->Internal->head->setNumAx(numAxes);
-    string inputString;
 
     for (int ii = 0; ii < numAxes; ii++)
       {
-      inputString = "SlicerAstro.NAXIS";
-      inputString += IntToString(ii + 1);
-      this->Internal->head->setDimAx(ii,StringToLong(inputVolume->GetAttribute(inputString.c_str())));
-      inputString = "SlicerAstro.CRPIX";
-      inputString += IntToString(ii + 1);
-      this->Internal->head->setCrpix(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-      inputString = "SlicerAstro.CRVAL";
-      inputString += IntToString(ii + 1);
-      this->Internal->head->setCrval(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-      inputString = "SlicerAstro.CDELT";
-      inputString += IntToString(ii + 1);
-      this->Internal->head->setCdelt(ii, StringToFloat(inputVolume->GetAttribute(inputString.c_str())));
-      inputString = "SlicerAstro.CTYPE";
-      inputString += IntToString(ii + 1);
-      inputString = inputVolume->GetAttribute(inputString.c_str());
-      this->Internal->head->setCtype(ii, inputString);
-      inputString = "SlicerAstro.CUNIT";
-      inputString += IntToString(ii + 1);
-      inputString = inputVolume->GetAttribute(inputString.c_str());
-      this->Internal->head->setCunit(ii, inputString);
-      }
-
-    this->Internal->head->setBmaj(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BMAJ")));
-    this->Internal->head->setBmin(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BMIN")));
-    this->Internal->head->setBpa(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BPA")));
-    this->Internal->head->setBzero(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BZERO")));
-    this->Internal->head->setBscale(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BSCALE")));
-    this->Internal->head->setBlank(StringToFloat(inputVolume->GetAttribute("SlicerAstro.BLANK")));
-    this->Internal->head->setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
-    this->Internal->head->setEpoch(StringToFloat(inputVolume->GetAttribute("SlicerAstro.EPOCH")));
-    this->Internal->head->setFreq0(StringToDouble(inputVolume->GetAttribute("SlicerAstro.RESTFREQ")));
-    inputString = inputVolume->GetAttribute("SlicerAstro.BUNIT");
-    this->Internal->head->setBunit(inputString);
-    inputString = inputVolume->GetAttribute("SlicerAstro.BTYPE");
-    this->Internal->head->setBtype(inputString);
-    inputString = inputVolume->GetAttribute("SlicerAstro.OBJECT");
-    this->Internal->head->setName(inputString);
-    inputString = inputVolume->GetAttribute("SlicerAstro.TELESCOP");
-    this->Internal->head->setTelesc(inputString);
-    inputString = inputVolume->GetAttribute("SlicerAstro.DUNIT3");
-    this->Internal->head->setDunit3(inputString);
-    this->Internal->head->setDrval3(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DRVAL3")));
-    this->Internal->head->setDataMin(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DATAMIN")));
-    this->Internal->head->setDataMax(StringToDouble(inputVolume->GetAttribute("SlicerAstro.DATAMAX")));
+      this->Internal->head->setDimAx(ii, header->GetNAXISi(ii));
+      this->Internal->head->setCrpix(ii, header->GetCRPIX(ii));
+      this->Internal->head->setCrval(ii, header->GetCRVAL(ii));
+      this->Internal->head->setCdelt(ii, header->GetCDELT(ii));
+      this->Internal->head->setCtype(ii, header->GetCTYPE(ii));
+      this->Internal->head->setCunit(ii, header->GetCUNIT(ii));
+      }
+
+    this->Internal->head->setBmaj(header->GetBMAJ());
+    this->Internal->head->setBmin(header->GetBMIN());
+    this->Internal->head->setBpa(header->GetBPA());
+    this->Internal->head->setBzero(header->GetBZERO());
+    this->Internal->head->setBscale(header->GetBSCALE());
+    this->Internal->head->setBlank(header->GetBLANK());
+    this->Internal->head->setCrota(header->GetCROTA());
+    this->Internal->head->setEpoch(header->GetEPOCH());
+    this->Internal->head->setFreq0(header->GetRESTFREQ());
+    this->Internal->head->setBunit(header->GetBUNIT());
+    this->Internal->head->setBtype(header->GetBTYPE());
+    this->Internal->head->setName(header->GetOBJECT());
+    this->Internal->head->setTelesc(header->GetTELESCOP());
+    this->Internal->head->setDunit3(header->GetDUNIT3());
+    this->Internal->head->setDrval3(header->GetDRVAL3());
+    this->Internal->head->setDataMin(header->GetDATAMIN());
+    this->Internal->head->setDataMax(header->GetDATAMAX());
     if(!this->Internal->head->saveWCSStruct(inputVolume->GetAstroVolumeDisplayNode()->GetWCSStruct()))
       {
       vtkErrorMacro("vtkSlicerAstroModelingLogic::UpdateModelFromTable : the WCS copy failed!")
@@ -1584,7 +1559,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
 
         this->Internal->cubeF->saveParam(*this->Internal->par);
         this->Internal->cubeF->saveHead(*this->Internal->head);
-        this->Internal->cubeF->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+        this->Internal->cubeF->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
         this->Internal->cubeF->setCube(static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer()), dims);
 
         this->Internal->fitF = new Model::Galfit<float>(this->Internal->cubeF);
@@ -1615,7 +1590,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
 
         this->Internal->cubeD->saveParam(*this->Internal->par);
         this->Internal->cubeD->saveHead(*this->Internal->head);
-        this->Internal->cubeD->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+        this->Internal->cubeD->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
         this->Internal->cubeD->setCube(static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer()), dims);
 
         this->Internal->fitD = new Model::Galfit<double>(this->Internal->cubeD);
@@ -1701,7 +1676,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
         this->Internal->fitF->Outrings()->nv.push_back(0);
         }
 
-      this->Internal->fitF->In()->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+      this->Internal->fitF->In()->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
       float *ringreg = this->Internal->fitF->getFinalRingsRegion();
       this->Internal->modF = this->Internal->fitF->getModel();
       float *outarray = this->Internal->modF->Out()->Array();
@@ -1779,7 +1754,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
 
       float *outFPixel = static_cast<float*> (outputVolume->GetImageData()->GetScalarPointer());
 
-      for (int ii = 0; ii < numElements; ii++)
+      for (vtkIdType ii = 0; ii < numElements; ii++)
         {
         *(outFPixel + ii) = *(outarray + ii);
         }
@@ -1789,7 +1764,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
         float *inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer());
         float *residualFPixel = static_cast<float*> (residualVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           if (*(outFPixel + ii) < 1.E-6)
             {
@@ -1858,7 +1833,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
         this->Internal->fitD->Outrings()->nv.push_back(0);
         }
 
-      this->Internal->fitD->In()->Head().setCrota(StringToDouble(inputVolume->GetAttribute("SlicerAstro.CROTA")));
+      this->Internal->fitD->In()->Head().setCrota(inputVolume->GetAstroHeader()->GetCROTA());
       double *ringreg = this->Internal->fitD->getFinalRingsRegion();
       this->Internal->modD = this->Internal->fitD->getModel();
       double *outarray = this->Internal->modD->Out()->Array();
@@ -1934,7 +1909,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
 
       double *outDPixel = static_cast<double*> (outputVolume->GetImageData()->GetScalarPointer());
 
-      for (int ii = 0; ii < numElements; ii++)
+      for (vtkIdType ii = 0; ii < numElements; ii++)
         {
         *(outDPixel + ii) = *(outarray + ii);
         }
@@ -1944,7 +1919,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
         double *inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer());
         double *residualDPixel = static_cast<double*> (residualVolume->GetImageData()->GetScalarPointer());
 
-        for (int ii = 0; ii < numElements; ii++)
+        for (vtkIdType ii = 0; ii < numElements; ii++)
           {
           if (*(outDPixel + ii) < 1.E-6)
             {
@@ -1961,5 +1936,13 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
       }
     }
 
+  // the voxels have been written in place: the caches keyed on the
+  // scalars (range, histogram, pyramid) have to see the change
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
+  if (inputVolume && residualVolume)
+    {
+    residualVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
+    }
+
   return 1;
 }
@@ -81,6 +81,7 @@
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroModelingParametersNode.h>
 #include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
 #include <vtkMRMLDoubleArrayNode.h>
 #include <vtkMRMLChartNode.h>
@@ -753,6 +754,9 @@ bool qSlicerAstroModelingModuleWidget::convertFirstSegmentToLabelMap()
   storedOrigin[1] -= Origin[1];
   storedOrigin[2] -= Origin[2];
 
+  // the voxels of the label map are rewritten in place
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(labelMapNode);
+
   vtkNew<vtkImageData> tempVolumeData;
   tempVolumeData->Initialize();
   tempVolumeData->DeepCopy(labelMapNode->GetImageData());
@@ -802,7 +806,10 @@ bool qSlicerAstroModelingModuleWidget::convertFirstSegmentToLabelMap()
     *(voxelPtr + shift) = *(tempVoxelPtr + elemCnt);
     }
 
+  labelMapNode->GetImageData()->GetPointData()->GetScalars()->Modified();
   labelMapNode->UpdateRangeAttributes();
+  // less than 256 segments: store the labels as unsigned char
+  labelMapNode->ConvertToCompactLabels();
 
   d->parametersNode->SetMaskVolumeNodeID(labelMapNode->GetID());
 
@@ -1826,6 +1833,10 @@ void qSlicerAstroModelingModuleWidget::onApply()
       }
     }
 
+  // the worker thread writes the voxels of the output volumes in place
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(outputVolume);
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(residualVolume);
+
   d->worker->SetAstroModelingParametersNode(d->parametersNode);
   d->worker->SetAstroModelingLogic(logic);
   d->worker->requestWork();
@@ -2040,6 +2051,9 @@ void qSlicerAstroModelingModuleWidget::onWorkFinished()
 
   if (d->parametersNode->GetFitSuccess())
     {
+    // the fit wrote the voxels of the model and residual in place
+    outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
+    residualVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
     outputVolume->UpdateNoiseAttributes();
     outputVolume->UpdateRangeAttributes();
     outputVolume->SetAttribute("SlicerAstro.DATATYPE", "MODEL");
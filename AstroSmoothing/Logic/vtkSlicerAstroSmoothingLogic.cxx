@@ -24,8 +24,12 @@
 
 // MRML includes
 #include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
 #include <vtkMRMLAstroSmoothingParametersNode.h>
 
+// vtkFits includes
+#include <vtkFITSHeader.h>
+
 // VTK includes
 #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENGL
 #include <vtkAstroOpenGLImageBox.h>
@@ -41,8 +45,12 @@
 #include <vtkVersion.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
 
 // OpenMP includes
 #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
@@ -88,6 +96,25 @@ vtkSlicerAstroSmoothingLogic::vtkInternal::~vtkInternal()
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerAstroSmoothingLogic);
 
+namespace
+{
+//----------------------------------------------------------------------------
+template <typename T> std::string NumberToString(T V)
+{
+  std::string stringValue;
+  std::stringstream strstream;
+  strstream << V;
+  strstream >> stringValue;
+  return stringValue;
+}
+
+//----------------------------------------------------------------------------
+std::string DoubleToString(double Value)
+{
+  return NumberToString<double>(Value);
+}
+}// end namespace
+
 //----------------------------------------------------------------------------
 vtkSlicerAstroSmoothingLogic::vtkSlicerAstroSmoothingLogic()
 {
@@ -129,6 +156,537 @@ double StringToDouble(const char* str)
   return StringToNumber<double>(str);
 }
 
+//----------------------------------------------------------------------------
+// Number of columns filtered by each task of the Y and Z passes of the
+// separable filters
+const int ColumnBlockSize = 512;
+
+//----------------------------------------------------------------------------
+// Box average of a contiguous line with a running sum: each output costs
+// one addition and one subtraction whatever the size of the box.
+// Taps outside the line count as zero, the average is normalized by the
+// full box (norm = 1 / number of taps). A box containing a NaN voxel is NaN:
+// the NaN voxels of the window are counted instead of being summed.
+template <typename T> void BoxFilterLine(const T *in, T *out, int length,
+                                         int half, double norm)
+{
+  double sum = 0.;
+  int nans = 0;
+  for (int i = 0; i <= half && i < length; i++)
+    {
+    const double value = *(in + i);
+    if (value != value)
+      {
+      nans++;
+      }
+    else
+      {
+      sum += value;
+      }
+    }
+
+  for (int i = 0; i < length; i++)
+    {
+    *(out + i) = nans ? std::numeric_limits<T>::quiet_NaN() : static_cast<T>(sum * norm);
+
+    if (i + half + 1 < length)
+      {
+      const double value = *(in + i + half + 1);
+      if (value != value)
+        {
+        nans++;
+        }
+      else
+        {
+        sum += value;
+        }
+      }
+    if (i - half >= 0)
+      {
+      const double value = *(in + i - half);
+      if (value != value)
+        {
+        nans--;
+        }
+      else
+        {
+        sum -= value;
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Same running sum along the rows of a block of columns [first, last):
+// row r starts at in + r * rowStride. Whole rows are read and written at
+// once, so the strided axes are scanned in memory order.
+template <typename T> void BoxFilterRows(const T *in, T *out, int numRows,
+                                         vtkIdType rowStride, int first, int last,
+                                         int half, double norm)
+{
+  const int numColumns = last - first;
+  std::vector<double> sum(numColumns, 0.);
+  std::vector<int> nans(numColumns, 0);
+
+  for (int r = 0; r <= half && r < numRows; r++)
+    {
+    const T *inRow = in + r * rowStride + first;
+    for (int c = 0; c < numColumns; c++)
+      {
+      const double value = *(inRow + c);
+      if (value != value)
+        {
+        nans[c]++;
+        }
+      else
+        {
+        sum[c] += value;
+        }
+      }
+    }
+
+  for (int r = 0; r < numRows; r++)
+    {
+    T *outRow = out + r * rowStride + first;
+    for (int c = 0; c < numColumns; c++)
+      {
+      *(outRow + c) = nans[c] ? std::numeric_limits<T>::quiet_NaN() :
+                                static_cast<T>(sum[c] * norm);
+      }
+
+    if (r + half + 1 < numRows)
+      {
+      const T *inRow = in + (r + half + 1) * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        const double value = *(inRow + c);
+        if (value != value)
+          {
+          nans[c]++;
+          }
+        else
+          {
+          sum[c] += value;
+          }
+        }
+      }
+    if (r - half >= 0)
+      {
+      const T *inRow = in + (r - half) * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        const double value = *(inRow + c);
+        if (value != value)
+          {
+          nans[c]--;
+          }
+        else
+          {
+          sum[c] -= value;
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Box kernel of the separable filter (see BoxFilterLine)
+struct BoxKernel
+{
+  int Half;
+  double Norm;
+
+  void SetSize(int nItems)
+    {
+    this->Half = (nItems - 1) / 2;
+    this->Norm = 1. / nItems;
+    }
+
+  template <typename T> void FilterLine(const T *in, T *out, int length) const
+    {
+    BoxFilterLine(in, out, length, this->Half, this->Norm);
+    }
+
+  template <typename T> void FilterRows(const T *in, T *out, int numRows,
+                                        vtkIdType rowStride, int first, int last) const
+    {
+    BoxFilterRows(in, out, numRows, rowStride, first, last, this->Half, this->Norm);
+    }
+};
+
+//----------------------------------------------------------------------------
+// Ratio between the FWHM and the sigma of a Gaussian
+const double SigmatoFWHM = 2.3548200450309493;
+
+//----------------------------------------------------------------------------
+// Smallest sigma (in pixels) reproduced accurately by the recursive Gaussian:
+// the Deriche coefficients lose accuracy quickly below 0.75 pixels
+const double RecursiveGaussianMinimumSigma = 0.75;
+
+//----------------------------------------------------------------------------
+// The recursive Gaussian is separable along the axes of the volume: it
+// can not rotate the kernel and it is used only on the axes smoothed
+// with a large enough sigma (axes with a null FWHM are not smoothed).
+bool IsRecursiveGaussianApplicable(vtkMRMLAstroSmoothingParametersNode *pnode)
+{
+  if (!pnode->GetRecursive() || pnode->GetRx() != 0 ||
+      pnode->GetRy() != 0 || pnode->GetRz() != 0)
+    {
+    return false;
+    }
+
+  const double parameters[3] = {pnode->GetParameterX(),
+                                pnode->GetParameterY(),
+                                pnode->GetParameterZ()};
+  for (int axis = 0; axis < 3; axis++)
+    {
+    if (parameters[axis] > 0.001 &&
+        parameters[axis] / SigmatoFWHM < RecursiveGaussianMinimumSigma)
+      {
+      return false;
+      }
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Recursive Gaussian kernel (Deriche, 4th order): the Gaussian is the sum
+// of a causal and an anticausal 4th order IIR filter, whose cost per voxel
+// does not depend on sigma. The relative error on the impulse response is
+// below 1e-3 of its peak for sigma >= 0.75 pixels.
+// Voxels outside the line count as zero, as for the kernel filters, which
+// the recursion reproduces exactly starting from zero states. NaN voxels
+// enter the recursion as zero and, as for the kernel filters, every output
+// voxel with a NaN voxel inside the window of the truncated kernel
+// (Half voxels on each side) is NaN.
+struct RecursiveGaussianKernel
+{
+  /// numerators of the causal (N) and anticausal (M) filters, denominator (D)
+  double N[4];
+  double M[4];
+  double D[4];
+  double Norm;
+  /// half length of the window of the equivalent kernel filter
+  int Half;
+  /// axis not smoothed
+  bool Identity;
+
+  void SetSigma(double sigma, int half)
+    {
+    this->Half = half;
+    this->Identity = sigma <= 0.;
+    if (this->Identity)
+      {
+      return;
+      }
+
+    const double a0 = 1.68, a1 = 3.735, b0 = 1.783, b1 = 1.723;
+    const double w0 = 0.6318, w1 = 1.997, c0 = -0.6803, c1 = -0.2598;
+    const double cw0 = cos(w0 / sigma), sw0 = sin(w0 / sigma);
+    const double cw1 = cos(w1 / sigma), sw1 = sin(w1 / sigma);
+    const double e0 = exp(-b0 / sigma), e1 = exp(-b1 / sigma);
+
+    this->N[0] = a0 + c0;
+    this->N[1] = e1 * (c1 * sw1 - (c0 + 2. * a0) * cw1) + e0 * (a1 * sw0 - (2. * c0 + a0) * cw0);
+    this->N[2] = 2. * e0 * e1 * ((a0 + c0) * cw1 * cw0 - a1 * cw1 * sw0 - c1 * cw0 * sw1) +
+                 c0 * e0 * e0 + a0 * e1 * e1;
+    this->N[3] = e1 * e0 * e0 * (c1 * sw1 - c0 * cw1) + e0 * e1 * e1 * (a1 * sw0 - a0 * cw0);
+    this->D[0] = -2. * e1 * cw1 - 2. * e0 * cw0;
+    this->D[1] = 4. * cw1 * cw0 * e0 * e1 + e1 * e1 + e0 * e0;
+    this->D[2] = -2. * cw0 * e0 * e1 * e1 - 2. * cw1 * e1 * e0 * e0;
+    this->D[3] = e0 * e0 * e1 * e1;
+    for (int i = 0; i < 3; i++)
+      {
+      this->M[i] = this->N[i + 1] - this->D[i] * this->N[0];
+      }
+    this->M[3] = -this->D[3] * this->N[0];
+
+    // unit gain
+    double sumN = 0., sumM = 0., sumD = 1.;
+    for (int i = 0; i < 4; i++)
+      {
+      sumN += this->N[i];
+      sumM += this->M[i];
+      sumD += this->D[i];
+      }
+    this->Norm = sumD / (sumN + sumM);
+    }
+
+  template <typename T> void FilterLine(const T *in, T *out, int length) const
+    {
+    if (this->Identity)
+      {
+      std::copy(in, in + length, out);
+      return;
+      }
+
+    // causal pass: x[i] is the input i voxels back, y[i] the output
+    double x[4] = {0., 0., 0., 0.}, y[4] = {0., 0., 0., 0.};
+    bool blanks = false;
+    for (int n = 0; n < length; n++)
+      {
+      double value = *(in + n);
+      if (value != value)
+        {
+        value = 0.;
+        blanks = true;
+        }
+      const double causal = this->N[0] * value + this->N[1] * x[0] + this->N[2] * x[1] + this->N[3] * x[2]
+        - this->D[0] * y[0] - this->D[1] * y[1] - this->D[2] * y[2] - this->D[3] * y[3];
+      x[2] = x[1]; x[1] = x[0]; x[0] = value;
+      y[3] = y[2]; y[2] = y[1]; y[1] = y[0]; y[0] = causal;
+      *(out + n) = static_cast<T>(causal);
+      }
+
+    // anticausal pass, summed to the causal one
+    x[0] = x[1] = x[2] = x[3] = 0.;
+    y[0] = y[1] = y[2] = y[3] = 0.;
+    for (int n = length - 1; n >= 0; n--)
+      {
+      const double anticausal = this->M[0] * x[0] + this->M[1] * x[1] + this->M[2] * x[2] + this->M[3] * x[3]
+        - this->D[0] * y[0] - this->D[1] * y[1] - this->D[2] * y[2] - this->D[3] * y[3];
+      const double value = *(in + n);
+      x[3] = x[2]; x[2] = x[1]; x[1] = x[0]; x[0] = value != value ? 0. : value;
+      y[3] = y[2]; y[2] = y[1]; y[1] = y[0]; y[0] = anticausal;
+      *(out + n) = static_cast<T>((*(out + n) + anticausal) * this->Norm);
+      }
+
+    if (!blanks)
+      {
+      return;
+      }
+
+    // NaN windows: running count of the NaN voxels in [n - Half, n + Half]
+    int nans = 0;
+    for (int n = 0; n <= this->Half && n < length; n++)
+      {
+      nans += *(in + n) != *(in + n);
+      }
+    for (int n = 0; n < length; n++)
+      {
+      if (nans)
+        {
+        *(out + n) = std::numeric_limits<T>::quiet_NaN();
+        }
+      if (n + this->Half + 1 < length)
+        {
+        nans += *(in + n + this->Half + 1) != *(in + n + this->Half + 1);
+        }
+      if (n - this->Half >= 0)
+        {
+        nans -= *(in + n - this->Half) != *(in + n - this->Half);
+        }
+      }
+    }
+
+  template <typename T> void FilterRows(const T *in, T *out, int numRows,
+                                        vtkIdType rowStride, int first, int last) const
+    {
+    const int numColumns = last - first;
+    if (this->Identity)
+      {
+      for (int r = 0; r < numRows; r++)
+        {
+        std::copy(in + r * rowStride + first, in + r * rowStride + last,
+                  out + r * rowStride + first);
+        }
+      return;
+      }
+
+    // states of the recursion of each column, see FilterLine
+    std::vector<double> states(8 * numColumns, 0.);
+    double *x = &states[0];
+    double *y = &states[4 * numColumns];
+    bool blanks = false;
+
+    for (int r = 0; r < numRows; r++)
+      {
+      const T *inRow = in + r * rowStride + first;
+      T *outRow = out + r * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        double *xc = x + 4 * c, *yc = y + 4 * c;
+        double value = *(inRow + c);
+        if (value != value)
+          {
+          value = 0.;
+          blanks = true;
+          }
+        const double causal = this->N[0] * value + this->N[1] * xc[0] + this->N[2] * xc[1] + this->N[3] * xc[2]
+          - this->D[0] * yc[0] - this->D[1] * yc[1] - this->D[2] * yc[2] - this->D[3] * yc[3];
+        xc[2] = xc[1]; xc[1] = xc[0]; xc[0] = value;
+        yc[3] = yc[2]; yc[2] = yc[1]; yc[1] = yc[0]; yc[0] = causal;
+        *(outRow + c) = static_cast<T>(causal);
+        }
+      }
+
+    std::fill(states.begin(), states.end(), 0.);
+    for (int r = numRows - 1; r >= 0; r--)
+      {
+      const T *inRow = in + r * rowStride + first;
+      T *outRow = out + r * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        double *xc = x + 4 * c, *yc = y + 4 * c;
+        const double anticausal = this->M[0] * xc[0] + this->M[1] * xc[1] + this->M[2] * xc[2] + this->M[3] * xc[3]
+          - this->D[0] * yc[0] - this->D[1] * yc[1] - this->D[2] * yc[2] - this->D[3] * yc[3];
+        const double value = *(inRow + c);
+        xc[3] = xc[2]; xc[2] = xc[1]; xc[1] = xc[0]; xc[0] = value != value ? 0. : value;
+        yc[3] = yc[2]; yc[2] = yc[1]; yc[1] = yc[0]; yc[0] = anticausal;
+        *(outRow + c) = static_cast<T>((*(outRow + c) + anticausal) * this->Norm);
+        }
+      }
+
+    if (!blanks)
+      {
+      return;
+      }
+
+    // NaN windows, see FilterLine
+    std::vector<int> nans(numColumns, 0);
+    for (int r = 0; r <= this->Half && r < numRows; r++)
+      {
+      const T *inRow = in + r * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        nans[c] += *(inRow + c) != *(inRow + c);
+        }
+      }
+    for (int r = 0; r < numRows; r++)
+      {
+      T *outRow = out + r * rowStride + first;
+      for (int c = 0; c < numColumns; c++)
+        {
+        if (nans[c])
+          {
+          *(outRow + c) = std::numeric_limits<T>::quiet_NaN();
+          }
+        }
+      if (r + this->Half + 1 < numRows)
+        {
+        const T *inRow = in + (r + this->Half + 1) * rowStride + first;
+        for (int c = 0; c < numColumns; c++)
+          {
+          nans[c] += *(inRow + c) != *(inRow + c);
+          }
+        }
+      if (r - this->Half >= 0)
+        {
+        const T *inRow = in + (r - this->Half) * rowStride + first;
+        for (int c = 0; c < numColumns; c++)
+          {
+          nans[c] -= *(inRow + c) != *(inRow + c);
+          }
+        }
+      }
+    }
+};
+
+//----------------------------------------------------------------------------
+// Separable filter with one kernel per axis: X pass in -> out, Y pass
+// out -> temp and Z pass temp -> out. The X pass filters the contiguous
+// lines, the Y and Z passes whole rows of blocks of columns, so that the
+// strided axes are scanned in memory order.
+// Returns false if the filter has been cancelled.
+template <typename T, typename Kernel> bool SeparableFilterVolume(const T *in, T *out, T *temp,
+                                                                  const int dims[3],
+                                                                  const Kernel kernels[3],
+                                                                  vtkMRMLAstroSmoothingParametersNode *pnode)
+{
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1];
+  bool cancel = false;
+
+  pnode->SetStatus(10);
+  const int numLines = dims[1] * dims[2];
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(pnode, cancel)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int line = 0; line < numLines; line++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (!cancel)
+      {
+      const vtkIdType offset = static_cast<vtkIdType>(line) * dims[0];
+      kernels[0].FilterLine(in + offset, out + offset, dims[0]);
+      }
+    }
+  if (cancel)
+    {
+    return false;
+    }
+
+  pnode->SetStatus(40);
+  const int numYBlocks = (dims[0] + ColumnBlockSize - 1) / ColumnBlockSize;
+  const int numYTasks = numYBlocks * dims[2];
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(pnode, cancel)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int task = 0; task < numYTasks; task++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (!cancel)
+      {
+      const vtkIdType offset = (task / numYBlocks) * numSlice;
+      const int first = (task % numYBlocks) * ColumnBlockSize;
+      const int last = std::min(first + ColumnBlockSize, dims[0]);
+      kernels[1].FilterRows(out + offset, temp + offset, dims[1], dims[0], first, last);
+      }
+    }
+  if (cancel)
+    {
+    return false;
+    }
+
+  pnode->SetStatus(70);
+  const int numZTasks = static_cast<int>((numSlice + ColumnBlockSize - 1) / ColumnBlockSize);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(pnode, cancel)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int task = 0; task < numZTasks; task++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (!cancel)
+      {
+      const int first = task * ColumnBlockSize;
+      const int last = static_cast<int>(std::min<vtkIdType>(first + ColumnBlockSize, numSlice));
+      kernels[2].FilterRows(temp, out, dims[2], numSlice, first, last);
+      }
+    }
+
+  return !cancel;
+}
+
 }// end namespace
 
 //----------------------------------------------------------------------------
@@ -151,10 +709,45 @@ void vtkSlicerAstroSmoothingLogic::RegisterNodes()
   pNode->Delete();
 }
 
-//----------------------------------------------------------------------------
-int vtkSlicerAstroSmoothingLogic::Apply(vtkMRMLAstroSmoothingParametersNode* pnode,
-                                        vtkRenderWindow* renderWindow)
-{
+//----------------------------------------------------------------------------
+int vtkSlicerAstroSmoothingLogic::Apply(vtkMRMLAstroSmoothingParametersNode* pnode,
+                                        vtkRenderWindow* renderWindow)
+{
+  vtkMRMLAstroVolumeNode *inputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast
+      (this->GetMRMLScene()->GetNodeByID(pnode->GetInputVolumeNodeID()));
+
+  vtkMRMLAstroVolumeNode *outputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast
+      (this->GetMRMLScene()->GetNodeByID(pnode->GetOutputVolumeNodeID()));
+
+  if (!inputVolume || !outputVolume)
+    {
+    vtkErrorMacro("vtkSlicerAstroSmoothingLogic::Apply : input or output volume not found.");
+    return 0;
+    }
+
+  // the filters write the voxels of the output volume in place
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(outputVolume);
+
+  // Volumes loaded with their native integer type store the values of the
+  // FITS file: the filters work on a float copy of the physical values.
+  const int inputDataType = inputVolume->GetImageData()->GetScalarType();
+  if (inputDataType != VTK_FLOAT && inputDataType != VTK_DOUBLE)
+    {
+    const char* keys[] = {"SlicerAstro.BSCALE", "SlicerAstro.BZERO", "SlicerAstro.DATAMIN",
+                          "SlicerAstro.DATAMAX", "SlicerAstro.RMS", "SlicerAstro.NOISEMEAN"};
+    for (int i = 0; i < 6; i++)
+      {
+      if (inputVolume->GetAttribute(keys[i]))
+        {
+        outputVolume->SetAttribute(keys[i], inputVolume->GetAttribute(keys[i]));
+        }
+      }
+    outputVolume->GetImageData()->DeepCopy(inputVolume->GetImageData());
+    outputVolume->ApplyDataScaling();
+    }
+
   int success = 0;
   switch (pnode->GetFilter())
     {
@@ -182,7 +775,11 @@ int vtkSlicerAstroSmoothingLogic::Apply(vtkMRMLAstroSmoothingParametersNode* pno
       {
         if (!(pnode->GetHardware()))
           {
-          if (fabs(pnode->GetParameterX() - pnode->GetParameterY()) < 0.001 &&
+          if (IsRecursiveGaussianApplicable(pnode))
+            {
+            success = this->RecursiveGaussianCPUFilter(pnode);
+            }
+          else if (fabs(pnode->GetParameterX() - pnode->GetParameterY()) < 0.001 &&
               fabs(pnode->GetParameterY() - pnode->GetParameterZ()) < 0.001)
             {
             success = this->IsotropicGaussianCPUFilter(pnode);
@@ -233,50 +830,33 @@ int vtkSlicerAstroSmoothingLogic::AnisotropicBoxCPUFilter(vtkMRMLAstroSmoothingP
       (this->GetMRMLScene()->GetNodeByID(pnode->GetOutputVolumeNodeID()));
 
   const int *dims = outputVolume->GetImageData()->GetDimensions();
-  const int numComponents = outputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numElements = dims[0] * dims[1] * dims[2] * numComponents;
-  const int numSlice = dims[0] * dims[1];
-  int nItemsX = pnode->GetParameterX();
-  if (nItemsX % 2 == 0)
-    {
-    nItemsX++;
-    }
-  const int Xmax = (int) ((nItemsX - 1) / 2.);
-  int nItemsY = pnode->GetParameterY();
-  if (nItemsY % 2 == 0)
+  const int parameters[3] = {static_cast<int>(pnode->GetParameterX()),
+                             static_cast<int>(pnode->GetParameterY()),
+                             static_cast<int>(pnode->GetParameterZ())};
+  BoxKernel kernels[3];
+  for (int axis = 0; axis < 3; axis++)
     {
-    nItemsY++;
+    kernels[axis].SetSize(parameters[axis] % 2 == 0 ? parameters[axis] + 1 : parameters[axis]);
     }
-  const int Ymax = (int) ((nItemsY - 1) / 2.);
-  int nItemsZ = pnode->GetParameterZ();
-  if (nItemsZ % 2 == 0)
+
+  const int DataType = outputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
+  // native integer input: Apply has converted it in the output volume
+  vtkNew<vtkImageData> physicalInputData;
+  vtkImageData *inputData = inputVolume->GetImageData();
+  if (inputData->GetScalarType() != DataType)
     {
-    nItemsZ++;
+    physicalInputData->DeepCopy(outputVolume->GetImageData());
+    inputData = physicalInputData.GetPointer();
     }
-  const int Zmax = (int) ((nItemsZ - 1) / 2.);
-  const int cont = nItemsX * nItemsY * nItemsZ;
-  float *inFPixel = NULL;
-  float *outFPixel = NULL;
-  double *inDPixel = NULL;
-  double *outDPixel = NULL;
-  const int DataType = outputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  switch (DataType)
+  if (DataType != VTK_FLOAT && DataType != VTK_DOUBLE)
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outFPixel = static_cast<float*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outDPixel = static_cast<double*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("Attempt to allocate scalars of type not allowed");
-      return 0;
+    vtkErrorMacro("Attempt to allocate scalars of type not allowed");
+    return 0;
     }
 
-  bool cancel = false;
-  int status = 0;
+  this->Internal->tempVolumeData->Initialize();
+  this->Internal->tempVolumeData->CopyStructure(outputVolume->GetImageData());
+  this->Internal->tempVolumeData->AllocateScalars(DataType, 1);
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   int numProcs = 0;
@@ -300,119 +880,25 @@ int vtkSlicerAstroSmoothingLogic::AnisotropicBoxCPUFilter(vtkMRMLAstroSmoothingP
 
   pnode->SetStatus(1);
 
-  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-  #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outFPixel, outDPixel, cancel, status)
-  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-  for (int elemCnt = 0; elemCnt < numElements; elemCnt++)
+  bool done = false;
+  switch (DataType)
     {
-    int stat = pnode->GetStatus();
-
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    if (stat == -1 && omp_get_thread_num() == 0)
-    #else
-    if (stat == -1)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      {
-      cancel = true;
-      }
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp flush (cancel)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    if (!cancel)
-      {
-      switch (DataType)
-        {
-        case VTK_FLOAT:
-          *(outFPixel + elemCnt) = 0.;
-          break;
-        case VTK_DOUBLE:
-          *(outDPixel + elemCnt) = 0.;
-          break;
-        }
-
-      for (int k = -Zmax; k <= Zmax; k++)
-        {
-        for (int j = -Ymax; j <= Ymax; j++)
-          {
-          for (int i = -Xmax; i <= Xmax; i++)
-            {
-            int posData = elemCnt + i;
-
-            int ref = (int) floor(elemCnt / dims[0]);
-            ref *= dims[0];
-            if(posData < ref)
-              {
-              continue;
-              }
-            if(posData >= ref + dims[0])
-              {
-              break;
-              }
-
-            posData += j * dims[0];
-            ref = (int) floor(elemCnt / numSlice);
-            ref *= numSlice;
-            if(posData < ref)
-              {
-              continue;
-              }
-            if(posData >= ref + numSlice)
-              {
-              break;
-              }
-
-            posData += k * numSlice;
-            if(posData < 0)
-              {
-              continue;
-              }
-            if(posData >= numElements)
-              {
-              break;
-              }
-
-            switch (DataType)
-              {
-              case VTK_FLOAT:
-                *(outFPixel + elemCnt) += *(inFPixel + posData);
-                break;
-              case VTK_DOUBLE:
-                *(outDPixel + elemCnt) += *(inDPixel + posData);
-                break;
-              }
-            }
-          }
-        }
-
-      switch (DataType)
-        {
-        case VTK_FLOAT:
-          *(outFPixel + elemCnt) /= cont;
-          break;
-        case VTK_DOUBLE:
-          *(outDPixel + elemCnt) /= cont;
-          break;
-        }
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (omp_get_thread_num() == 0)
-        {
-        if(elemCnt / (numElements / (numProcs * 100)) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        }
-      #else
-      if(elemCnt / (numElements / 100) > status)
-        {
-        status += 10;
-        pnode->SetStatus(status);
-        }
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      }
+    case VTK_FLOAT:
+      done = SeparableFilterVolume(static_cast<float*>(inputData->GetScalarPointer(0,0,0)),
+                                   static_cast<float*>(outputVolume->GetImageData()->GetScalarPointer(0,0,0)),
+                                   static_cast<float*>(this->Internal->tempVolumeData->GetScalarPointer(0,0,0)),
+                                   dims, kernels, pnode);
+      break;
+    case VTK_DOUBLE:
+      done = SeparableFilterVolume(static_cast<double*>(inputData->GetScalarPointer(0,0,0)),
+                                   static_cast<double*>(outputVolume->GetImageData()->GetScalarPointer(0,0,0)),
+                                   static_cast<double*>(this->Internal->tempVolumeData->GetScalarPointer(0,0,0)),
+                                   dims, kernels, pnode);
+      break;
     }
 
+  this->Internal->tempVolumeData->Initialize();
+
   gettimeofday(&end, NULL);
 
   seconds  = end.tv_sec  - start.tv_sec;
@@ -422,25 +908,16 @@ int vtkSlicerAstroSmoothingLogic::AnisotropicBoxCPUFilter(vtkMRMLAstroSmoothingP
 
   vtkDebugMacro("Box Filter (CPU) Kernel Time : "<<mtime<<" ms /n");
 
-  inFPixel = NULL;
-  outFPixel = NULL;
-  inDPixel = NULL;
-  outDPixel = NULL;
-
-  delete inFPixel;
-  delete outFPixel;
-  delete inDPixel;
-  delete outDPixel;
-
   pnode->SetStatus(0);
 
-  if (cancel)
+  if (!done)
     {
     return 0;
     }
 
   gettimeofday(&start, NULL);
 
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
   outputVolume->UpdateRangeAttributes();
   outputVolume->UpdateNoiseAttributes();
 
@@ -830,6 +1307,7 @@ int vtkSlicerAstroSmoothingLogic::IsotropicBoxCPUFilter(vtkMRMLAstroSmoothingPar
 
   gettimeofday(&start, NULL);
 
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
   outputVolume->UpdateRangeAttributes();
   outputVolume->UpdateNoiseAttributes();
 
@@ -989,14 +1467,22 @@ int vtkSlicerAstroSmoothingLogic::AnisotropicGaussianCPUFilter(vtkMRMLAstroSmoot
   double *inDPixel = NULL;
   double *outDPixel = NULL;
   const int DataType = outputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
+  // native integer input: Apply has converted it in the output volume
+  vtkNew<vtkImageData> physicalInputData;
+  vtkImageData *inputData = inputVolume->GetImageData();
+  if (inputData->GetScalarType() != DataType)
+    {
+    physicalInputData->DeepCopy(outputVolume->GetImageData());
+    inputData = physicalInputData.GetPointer();
+    }
   switch (DataType)
     {
     case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
+      inFPixel = static_cast<float*> (inputData->GetScalarPointer(0,0,0));
       outFPixel = static_cast<float*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
       break;
     case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
+      inDPixel = static_cast<double*> (inputData->GetScalarPointer(0,0,0));
       outDPixel = static_cast<double*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
       break;
     default:
@@ -1163,6 +1649,7 @@ int vtkSlicerAstroSmoothingLogic::AnisotropicGaussianCPUFilter(vtkMRMLAstroSmoot
 
   gettimeofday(&start, NULL);
 
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
   outputVolume->UpdateRangeAttributes();
   outputVolume->UpdateNoiseAttributes();
 
@@ -1517,6 +2004,133 @@ int vtkSlicerAstroSmoothingLogic::IsotropicGaussianCPUFilter(vtkMRMLAstroSmoothi
 
   gettimeofday(&start, NULL);
 
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
+  outputVolume->UpdateRangeAttributes();
+  outputVolume->UpdateNoiseAttributes();
+
+  gettimeofday(&end, NULL);
+
+  seconds  = end.tv_sec  - start.tv_sec;
+  useconds = end.tv_usec - start.tv_usec;
+
+  mtime = ((seconds) * 1000 + useconds/1000.0) + 0.5;
+
+  vtkDebugMacro("Update Time : "<<mtime<<" ms /n");
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerAstroSmoothingLogic::RecursiveGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode* pnode)
+{
+  #ifndef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  vtkWarningMacro("vtkSlicerAstroSmoothingLogic::RecursiveGaussianCPUFilter : "
+                  "this release of SlicerAstro has been built "
+                  "without OpenMP support. It may results that "
+                  "the AstroSmoothing algorithm will show poor performance.")
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  vtkMRMLAstroVolumeNode *inputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast
+      (this->GetMRMLScene()->GetNodeByID(pnode->GetInputVolumeNodeID()));
+
+  vtkMRMLAstroVolumeNode *outputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast
+      (this->GetMRMLScene()->GetNodeByID(pnode->GetOutputVolumeNodeID()));
+
+  const int *dims = outputVolume->GetImageData()->GetDimensions();
+  const double parameters[3] = {pnode->GetParameterX(),
+                                pnode->GetParameterY(),
+                                pnode->GetParameterZ()};
+  RecursiveGaussianKernel kernels[3];
+  for (int axis = 0; axis < 3; axis++)
+    {
+    // the NaN voxels are propagated over the window of the kernel
+    // filter (see vtkMRMLAstroSmoothingParametersNode::SetGaussianKernel3D)
+    const double sigma = parameters[axis] > 0.001 ? parameters[axis] / SigmatoFWHM : 0.;
+    const int kernelLength = static_cast<int>(sigma * pnode->GetAccuracy() * 2 + 1);
+    kernels[axis].SetSigma(sigma, kernelLength / 2);
+    }
+
+  const int DataType = outputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
+  // native integer input: Apply has converted it in the output volume
+  vtkNew<vtkImageData> physicalInputData;
+  vtkImageData *inputData = inputVolume->GetImageData();
+  if (inputData->GetScalarType() != DataType)
+    {
+    physicalInputData->DeepCopy(outputVolume->GetImageData());
+    inputData = physicalInputData.GetPointer();
+    }
+  if (DataType != VTK_FLOAT && DataType != VTK_DOUBLE)
+    {
+    vtkErrorMacro("Attempt to allocate scalars of type not allowed");
+    return 0;
+    }
+
+  this->Internal->tempVolumeData->Initialize();
+  this->Internal->tempVolumeData->CopyStructure(outputVolume->GetImageData());
+  this->Internal->tempVolumeData->AllocateScalars(DataType, 1);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  int numProcs = 0;
+  if (pnode->GetCores() == 0)
+    {
+    numProcs = omp_get_num_procs();
+    }
+  else
+    {
+    numProcs = pnode->GetCores();
+    }
+
+  omp_set_num_threads(numProcs);
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  struct timeval start, end;
+
+  long mtime, seconds, useconds;
+
+  gettimeofday(&start, NULL);
+
+  pnode->SetStatus(1);
+
+  bool done = false;
+  switch (DataType)
+    {
+    case VTK_FLOAT:
+      done = SeparableFilterVolume(static_cast<float*>(inputData->GetScalarPointer(0,0,0)),
+                                   static_cast<float*>(outputVolume->GetImageData()->GetScalarPointer(0,0,0)),
+                                   static_cast<float*>(this->Internal->tempVolumeData->GetScalarPointer(0,0,0)),
+                                   dims, kernels, pnode);
+      break;
+    case VTK_DOUBLE:
+      done = SeparableFilterVolume(static_cast<double*>(inputData->GetScalarPointer(0,0,0)),
+                                   static_cast<double*>(outputVolume->GetImageData()->GetScalarPointer(0,0,0)),
+                                   static_cast<double*>(this->Internal->tempVolumeData->GetScalarPointer(0,0,0)),
+                                   dims, kernels, pnode);
+      break;
+    }
+
+  this->Internal->tempVolumeData->Initialize();
+
+  gettimeofday(&end, NULL);
+
+  seconds  = end.tv_sec  - start.tv_sec;
+  useconds = end.tv_usec - start.tv_usec;
+
+  mtime = ((seconds) * 1000 + useconds/1000.0) + 0.5;
+
+  vtkDebugMacro("Recursive Gaussian Filter (CPU) Time : "<<mtime<<" ms /n");
+
+  pnode->SetStatus(0);
+
+  if (!done)
+    {
+    return 0;
+    }
+
+  gettimeofday(&start, NULL);
+
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
   outputVolume->UpdateRangeAttributes();
   outputVolume->UpdateNoiseAttributes();
 
@@ -1672,7 +2286,7 @@ int vtkSlicerAstroSmoothingLogic::GradientCPUFilter(vtkMRMLAstroSmoothingParamet
   const int numComponents = outputVolume->GetImageData()->GetNumberOfScalarComponents();
   const int numElements = dims[0] * dims[1] * dims[2] * numComponents;
   const int numSlice = dims[0] * dims[1];
-  const double noise = StringToDouble(outputVolume->GetAttribute("SlicerAstro.RMS"));
+  const double noise = outputVolume->GetAstroHeader()->GetRMS();
   const double noise2 = noise * noise * pnode->GetK() * pnode->GetK();
   float *outFPixel = NULL;
   float *tempFPixel = NULL;
@@ -1860,10 +2474,12 @@ int vtkSlicerAstroSmoothingLogic::GradientCPUFilter(vtkMRMLAstroSmoothingParamet
 
   gettimeofday(&start, NULL);
 
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
   outputVolume->UpdateRangeAttributes();
   outputVolume->UpdateNoiseAttributes();
 
-  double noiseMean = StringToDouble(outputVolume->GetAttribute("SlicerAstro.NOISEMEAN"));
+  vtkFITSHeader *header = outputVolume->GetAstroHeader();
+  double noiseMean = header->GetNOISEMEAN();
 
   for( int elemCnt = 0; elemCnt < numElements; elemCnt++)
     {
@@ -1877,9 +2493,15 @@ int vtkSlicerAstroSmoothingLogic::GradientCPUFilter(vtkMRMLAstroSmoothingParamet
         break;
       }
     }
+  outputVolume->GetImageData()->GetPointData()->GetScalars()->Modified();
 
-  outputVolume->UpdateRangeAttributes();
-  outputVolume->UpdateNoiseAttributes();
+  // subtracting the noise mean shifts the range and the noise mean:
+  // no need of a second pass on the data
+  double min = header->GetDATAMIN() - noiseMean;
+  double max = header->GetDATAMAX() - noiseMean;
+  outputVolume->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(min).c_str());
+  outputVolume->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(max).c_str());
+  outputVolume->SetAttribute("SlicerAstro.NOISEMEAN", "0.");
 
   gettimeofday(&end, NULL);
 
@@ -1969,7 +2591,7 @@ int vtkSlicerAstroSmoothingLogic::GradientGPUFilter(vtkMRMLAstroSmoothingParamet
   filter->SetK(pnode->GetK());
   filter->SetAccuracy(pnode->GetAccuracy());
   filter->SetTimeStep(pnode->GetTimeStep());
-  filter->SetRMS(StringToDouble(outputVolume->GetAttribute("SlicerAstro.RMS")));
+  filter->SetRMS(outputVolume->GetAstroHeader()->GetRMS());
 
   filter->SetRenderWindow(renderWindow);
 
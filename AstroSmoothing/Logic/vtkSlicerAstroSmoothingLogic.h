@@ -60,6 +60,9 @@ protected:
 
   int AnisotropicGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
   int IsotropicGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
+  /// Gaussian smoothing with recursive filters along the axes, whose cost
+  /// does not depend on the FWHM (see vtkMRMLAstroSmoothingParametersNode::SetRecursive)
+  int RecursiveGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
   int GaussianGPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode, vtkRenderWindow* renderWindow);
 
   int GradientCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
@@ -0,0 +1,256 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLAstroSmoothingParametersNode.h"
+#include "vtkMRMLAstroVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// Logic includes
+#include "vtkSlicerAstroSmoothingLogic.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Reference box filter: the neighbourhood loop of the box filters before
+// the running sums. The taps outside the volume count as zero, the norm is
+// the number of taps of the box and a box containing a NaN voxel is NaN.
+float ReferenceBox(const float *in, const int dims[3], const int half[3],
+                   int x, int y, int z)
+{
+  double sum = 0.;
+  for (int k = z - half[2]; k <= z + half[2]; k++)
+    {
+    for (int j = y - half[1]; j <= y + half[1]; j++)
+      {
+      for (int i = x - half[0]; i <= x + half[0]; i++)
+        {
+        if (i < 0 || i >= dims[0] || j < 0 || j >= dims[1] || k < 0 || k >= dims[2])
+          {
+          continue;
+          }
+        sum += in[(k * dims[1] + j) * dims[0] + i];
+        }
+      }
+    }
+  return static_cast<float>(sum / ((2 * half[0] + 1) * (2 * half[1] + 1) * (2 * half[2] + 1)));
+}
+
+//----------------------------------------------------------------------------
+void FillVolume(vtkMRMLAstroVolumeNode *volume, const int dims[3], const float *values)
+{
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+  float *pixels = static_cast<float*>(imageData->GetScalarPointer(0,0,0));
+  for (int i = 0; i < dims[0] * dims[1] * dims[2]; i++)
+    {
+    pixels[i] = values[i];
+    }
+  volume->SetAndObserveImageData(imageData.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+bool TestBoxFilter(vtkSlicerAstroSmoothingLogic *logic,
+                   vtkMRMLAstroSmoothingParametersNode *pnode,
+                   vtkMRMLAstroVolumeNode *inputVolume,
+                   vtkMRMLAstroVolumeNode *outputVolume,
+                   int sizeX, int sizeY, int sizeZ)
+{
+  const int dims[3] = {9, 7, 5};
+  const int numElements = dims[0] * dims[1] * dims[2];
+  std::vector<float> values(numElements);
+  for (int i = 0; i < numElements; i++)
+    {
+    values[i] = static_cast<float>((i * 37) % 11) - 3.f;
+    }
+  // one NaN inside the volume and one on an edge
+  values[(2 * dims[1] + 3) * dims[0] + 4] = std::numeric_limits<float>::quiet_NaN();
+  values[(4 * dims[1] + 6) * dims[0] + 8] = std::numeric_limits<float>::quiet_NaN();
+
+  FillVolume(inputVolume, dims, &values[0]);
+  FillVolume(outputVolume, dims, &values[0]);
+
+  pnode->SetFilter(0);
+  pnode->SetParameterX(sizeX);
+  pnode->SetParameterY(sizeY);
+  pnode->SetParameterZ(sizeZ);
+  if (!logic->Apply(pnode, NULL))
+    {
+    std::cerr << "Box filter " << sizeX << " " << sizeY << " " << sizeZ
+              << " : Apply failed" << std::endl;
+    return false;
+    }
+
+  // even sizes are rounded up to the next odd size
+  const int half[3] = {sizeX / 2, sizeY / 2, sizeZ / 2};
+  const float *outPixels = static_cast<float*>
+    (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
+  for (int z = 0; z < dims[2]; z++)
+    {
+    for (int y = 0; y < dims[1]; y++)
+      {
+      for (int x = 0; x < dims[0]; x++)
+        {
+        const float expected = ReferenceBox(&values[0], dims, half, x, y, z);
+        const float value = outPixels[(z * dims[1] + y) * dims[0] + x];
+        const bool expectedNaN = expected != expected;
+        const bool valueNaN = value != value;
+        if (expectedNaN != valueNaN ||
+            (!expectedNaN && fabs(value - expected) > 1.E-5 * (1. + fabs(expected))))
+          {
+          std::cerr << "Box filter " << sizeX << " " << sizeY << " " << sizeZ
+                    << " : voxel (" << x << ", " << y << ", " << z << ") is "
+                    << value << " instead of " << expected << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRecursiveGaussian(vtkSlicerAstroSmoothingLogic *logic,
+                           vtkMRMLAstroSmoothingParametersNode *pnode,
+                           vtkMRMLAstroVolumeNode *inputVolume,
+                           vtkMRMLAstroVolumeNode *outputVolume)
+{
+  // a delta along X in every row
+  const int dims[3] = {61, 3, 2};
+  const int center = dims[0] / 2;
+  std::vector<float> values(dims[0] * dims[1] * dims[2], 0.f);
+  for (int row = 0; row < dims[1] * dims[2]; row++)
+    {
+    values[row * dims[0] + center] = 1.f;
+    }
+
+  FillVolume(inputVolume, dims, &values[0]);
+  FillVolume(outputVolume, dims, &values[0]);
+
+  const double fwhm = 6.;
+  pnode->SetFilter(1);
+  pnode->SetRecursive(true);
+  pnode->SetRx(0);
+  pnode->SetRy(0);
+  pnode->SetRz(0);
+  pnode->SetParameterX(fwhm);
+  pnode->SetParameterY(0.);
+  pnode->SetParameterZ(0.);
+  if (!logic->Apply(pnode, NULL))
+    {
+    std::cerr << "Recursive Gaussian : Apply failed" << std::endl;
+    return false;
+    }
+
+  const float *outPixels = static_cast<float*>
+    (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
+  for (int row = 0; row < dims[1] * dims[2]; row++)
+    {
+    const float *line = outPixels + row * dims[0];
+    double sum = 0.;
+    for (int x = 0; x < dims[0]; x++)
+      {
+      sum += line[x];
+      }
+    if (fabs(sum - 1.) > 0.01)
+      {
+      std::cerr << "Recursive Gaussian : gain of row " << row << " is "
+                << sum << " instead of 1" << std::endl;
+      return false;
+      }
+
+    // FWHM from the half maximum crossings, interpolated linearly
+    const double halfMaximum = line[center] / 2.;
+    int right = center;
+    while (right < dims[0] - 1 && line[right + 1] > halfMaximum)
+      {
+      right++;
+      }
+    int left = center;
+    while (left > 0 && line[left - 1] > halfMaximum)
+      {
+      left--;
+      }
+    const double rightCrossing = right +
+      (line[right] - halfMaximum) / (line[right] - line[right + 1]);
+    const double leftCrossing = left -
+      (line[left] - halfMaximum) / (line[left] - line[left - 1]);
+    const double measuredFWHM = rightCrossing - leftCrossing;
+    if (fabs(measuredFWHM - fwhm) > 0.05 * fwhm)
+      {
+      std::cerr << "Recursive Gaussian : FWHM of row " << row << " is "
+                << measuredFWHM << " instead of " << fwhm << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkSlicerAstroSmoothingLogicTest1(int , char * [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkNew<vtkMRMLAstroVolumeNode> inputVolume;
+  scene->AddNode(inputVolume.GetPointer());
+  vtkNew<vtkMRMLAstroVolumeNode> outputVolume;
+  scene->AddNode(outputVolume.GetPointer());
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetOutputVolumeNodeID(outputVolume->GetID());
+  pnode->SetHardware(0);
+  pnode->SetCores(0);
+
+  // isotropic (3, 3, 3) and anisotropic boxes, with an even size
+  if (!TestBoxFilter(logic.GetPointer(), pnode.GetPointer(),
+                     inputVolume.GetPointer(), outputVolume.GetPointer(), 3, 3, 3) ||
+      !TestBoxFilter(logic.GetPointer(), pnode.GetPointer(),
+                     inputVolume.GetPointer(), outputVolume.GetPointer(), 3, 5, 1) ||
+      !TestBoxFilter(logic.GetPointer(), pnode.GetPointer(),
+                     inputVolume.GetPointer(), outputVolume.GetPointer(), 4, 1, 3))
+    {
+    return EXIT_FAILURE;
+    }
+
+  if (!TestRecursiveGaussian(logic.GetPointer(), pnode.GetPointer(),
+                             inputVolume.GetPointer(), outputVolume.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
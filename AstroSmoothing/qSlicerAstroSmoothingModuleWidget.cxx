@@ -214,6 +214,9 @@ void qSlicerAstroSmoothingModuleWidgetPrivate::init()
   QObject::connect(LinkCheckBox, SIGNAL(toggled(bool)),
                    q, SLOT(onLinkChanged(bool)));
 
+  QObject::connect(RecursiveCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(onRecursiveChanged(bool)));
+
   QObject::connect(AutoRunCheckBox, SIGNAL(toggled(bool)),
                    q, SLOT(onAutoRunChanged(bool)));
 
@@ -556,6 +559,7 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
 
   d->AutoRunCheckBox->setChecked(d->parametersNode->GetAutoRun());
   d->LinkCheckBox->setChecked(d->parametersNode->GetLink());
+  d->RecursiveCheckBox->setChecked(d->parametersNode->GetRecursive());
 
   if(status == 0)
     {  
@@ -568,6 +572,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->AccuracyValueLabel->hide();
         d->HardwareLabel->show();
         d->HardwareComboBox->show();
+        d->RecursiveLabel->hide();
+        d->RecursiveCheckBox->hide();
         d->KLabel->hide();
         d->KSpinBox->hide();
         d->TimeStepLabel->hide();
@@ -651,6 +657,9 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->AccuracyValueLabel->show();
         d->HardwareLabel->show();
         d->HardwareComboBox->show();
+        // the recursive Gaussian is a CPU filter
+        d->RecursiveLabel->setVisible(!d->parametersNode->GetHardware());
+        d->RecursiveCheckBox->setVisible(!d->parametersNode->GetHardware());
         d->KLabel->hide();
         d->KSpinBox->hide();
         d->TimeStepLabel->hide();
@@ -927,6 +936,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->AccuracyValueLabel->hide();
         d->HardwareLabel->show();
         d->HardwareComboBox->show();
+        d->RecursiveLabel->hide();
+        d->RecursiveCheckBox->hide();
         d->GaussianKernelView->hide();
         d->RxLabel->hide();
         d->RxSpinBox->hide();
@@ -1608,6 +1619,13 @@ void qSlicerAstroSmoothingModuleWidget::onLinkChanged(bool value)
  d->parametersNode->SetLink(value);
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onRecursiveChanged(bool value)
+{
+ Q_D(qSlicerAstroSmoothingModuleWidget);
+ d->parametersNode->SetRecursive(value);
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerAstroSmoothingModuleWidget::onAutoRunChanged(bool value)
 {
@@ -78,6 +78,7 @@ protected slots:
   void updateProgress(int value);
   void onHardwareChanged(int index);
   void onLinkChanged(bool value);
+  void onRecursiveChanged(bool value);
   void onAutoRunChanged(bool value);
 
 private:
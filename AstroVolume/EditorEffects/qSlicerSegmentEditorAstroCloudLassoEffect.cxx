@@ -98,6 +98,9 @@
 // AstroMRML includes
 #include <vtkMRMLAstroVolumeNode.h>
 
+// vtkFits includes
+#include <vtkFITSHistogram.h>
+
 // Slicer includes
 #include "qMRMLSliceView.h"
 #include "qMRMLSliceWidget.h"
@@ -785,12 +788,19 @@ void qSlicerSegmentEditorAstroCloudLassoEffectPrivate::reApplyPaint()
     return;
     }
 
-  double ThresholdMinimumValue = q->doubleParameter("ThresholdMinimumValue");
-  double ThresholdMaximumValue = q->doubleParameter("ThresholdMaximumValue");
+  double thresholdRange[2] = {q->doubleParameter("ThresholdMinimumValue"),
+                               q->doubleParameter("ThresholdMaximumValue")};
+  // the thresholds are physical values: convert them in voxel units
+  vtkMRMLAstroVolumeNode *astroMasterVolume = vtkMRMLAstroVolumeNode::SafeDownCast
+    (q->parameterSetNode()->GetMasterVolumeNode());
+  if (astroMasterVolume)
+    {
+    astroMasterVolume->GetVoxelRange(thresholdRange);
+    }
   // Create threshold image
   vtkNew<vtkImageThreshold> threshold;
   threshold->SetInputData(masterVolumeOrientedImageData);
-  threshold->ThresholdBetween(ThresholdMinimumValue, ThresholdMaximumValue);
+  threshold->ThresholdBetween(thresholdRange[0], thresholdRange[1]);
   threshold->SetInValue(1);
   threshold->SetOutValue(0);
   threshold->SetOutputScalarType(this->LastMask->GetScalarType());
@@ -1352,9 +1362,15 @@ void qSlicerSegmentEditorAstroCloudLassoEffect::masterVolumeNodeChanged()
     return;
     }
 
-  double min = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMIN"));
+  double range[2];
+  if (!astroMasterVolume->GetPlanesRange(0, -1, range))
+    {
+    range[0] = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMIN"));
+    range[1] = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMAX"));
+    }
+  double min = range[0];
   this->setCommonParameter("ThresholdMinimumValueLimit", min);
-  double max = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMAX"));
+  double max = range[1];
   this->setCommonParameter("ThresholdMaximumValue", max);
   this->setCommonParameter("ThresholdMaximumValueLimit", max);
 
@@ -1366,6 +1382,13 @@ void qSlicerSegmentEditorAstroCloudLassoEffect::masterVolumeNodeChanged()
   this->setCommonParameter("ThresholdDecimals", unitNodeIntensity->GetPrecision());
 
   double noise3 = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.RMS")) * 3.;
+  // without noise estimate, or with no voxels above 3 RMS, start from the
+  // brightest percent of the voxels
+  vtkFITSHistogram *histogram = astroMasterVolume->GetHistogram();
+  if (histogram && (noise3 <= 0. || histogram->GetFractionAbove(noise3) <= 0.))
+    {
+    noise3 = histogram->GetQuantile(0.99);
+    }
   this->setCommonParameter("ThresholdMinimumValue", noise3);
   this->setCommonParameter("Threshold3RMSValue", noise3);
 
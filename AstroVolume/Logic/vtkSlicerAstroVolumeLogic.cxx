@@ -58,6 +58,10 @@
 #include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 
+// vtkFits includes
+#include <vtkFITSHeader.h>
+#include <vtkFITSHistogram.h>
+
 // WCS includes
 #include "wcslib.h"
 
@@ -79,24 +83,6 @@ vtkSlicerAstroVolumeLogic::~vtkSlicerAstroVolumeLogic()
     }
 }
 
-namespace
-{
-//----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
-
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
-}// end namespace
-
 //----------------------------------------------------------------------------
 void vtkSlicerAstroVolumeLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -255,12 +241,12 @@ void vtkSlicerAstroVolumeLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
         vtkMRMLAstroVolumeNode::SafeDownCast(listAstroVolumes->GetItemAsObject(i));
       if (astroVolumeNode)
         {
-        double mint = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMIN"));
+        double mint = astroVolumeNode->GetAstroHeader()->GetDATAMIN();
         if (mint < min)
           {
           min = mint;
           }
-        double maxt = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMAX"));
+        double maxt = astroVolumeNode->GetAstroHeader()->GetDATAMAX();
         if (maxt > max)
           {
           max = maxt;
@@ -413,6 +399,17 @@ void vtkSlicerAstroVolumeLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode *node)
 
 namespace
 {
+//----------------------------------------------------------------------------
+void SetStorageNodeBinning(vtkMRMLAstroVolumeStorageNode* storageNode, int options)
+{
+  int binXY = (options >> vtkSlicerAstroVolumeLogic::BinningXYShift) &
+              vtkSlicerAstroVolumeLogic::BinningMask;
+  int binZ = (options >> vtkSlicerAstroVolumeLogic::BinningZShift) &
+             vtkSlicerAstroVolumeLogic::BinningMask;
+  storageNode->SetBinning(std::max(binXY, 1), std::max(binXY, 1), std::max(binZ, 1));
+  storageNode->SetSubsample((options & vtkSlicerAstroVolumeLogic::Subsample) ? 1 : 0);
+}
+
 //----------------------------------------------------------------------------
 ArchetypeVolumeNodeSet AstroVolumeNodeSetFactory(std::string& volumeName, vtkMRMLScene* scene, int options)
 {
@@ -429,6 +426,8 @@ ArchetypeVolumeNodeSet AstroVolumeNodeSetFactory(std::string& volumeName, vtkMRM
 
   vtkNew<vtkMRMLAstroVolumeStorageNode> storageNode;
   storageNode->SetCenterImage(options & vtkSlicerVolumesLogic::CenterImage);
+  storageNode->SetUseNativeDataType((options & vtkSlicerAstroVolumeLogic::NativeDataType) ? 1 : 0);
+  SetStorageNodeBinning(storageNode.GetPointer(), options);
   nodeSet.Scene->AddNode(storageNode.GetPointer());
   astroNode->SetAndObserveStorageNodeID(storageNode->GetID());
 
@@ -460,6 +459,8 @@ ArchetypeVolumeNodeSet AstroLabelMapVolumeNodeSetFactory(std::string& volumeName
 
   vtkNew<vtkMRMLAstroVolumeStorageNode> storageNode;
   storageNode->SetCenterImage(options & vtkSlicerVolumesLogic::CenterImage);
+  storageNode->SetUseNativeDataType((options & vtkSlicerAstroVolumeLogic::NativeDataType) ? 1 : 0);
+  SetStorageNodeBinning(storageNode.GetPointer(), options);
   nodeSet.Scene->AddNode(storageNode.GetPointer());
   astroLabelMapNode->SetAndObserveStorageNodeID(storageNode->GetID());
 
@@ -529,8 +530,9 @@ void vtkSlicerAstroVolumeLogic::updateUnitsNodes(vtkMRMLNode *astroVolumeNode)
   if (selectionNode)
     {
     vtkMRMLUnitNode* unitNode1 = selectionNode->GetUnitNode("intensity");
-    double max = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMAX"));
-    double min = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMIN"));
+    vtkFITSHeader *header = vtkMRMLAstroVolumeNode::SafeDownCast(astroVolumeNode)->GetAstroHeader();
+    double max = header->GetDATAMAX();
+    double min = header->GetDATAMIN();
     unitNode1->SetMaximumValue(max);
     unitNode1->SetMinimumValue(min);
     unitNode1->SetDisplayCoefficient(1.);
@@ -677,16 +679,32 @@ bool vtkSlicerAstroVolumeLogic::synchronizePresetsToVolumeNode(vtkMRMLNode *node
     return false;
     }
 
-  double max = StringToDouble(node->GetAttribute("SlicerAstro.DATAMAX")) * 2.;
-  double min = StringToDouble(node->GetAttribute("SlicerAstro.DATAMIN")) * 2.;
-  double noise = StringToDouble(node->GetAttribute("SlicerAstro.RMS"));
+  vtkMRMLAstroVolumeNode *astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(node);
+  vtkFITSHeader *header = astroVolumeNode->GetAstroHeader();
+  double range[2] = {header->GetDATAMIN(), header->GetDATAMAX()};
+  astroVolumeNode->GetPlanesRange(0, -1, range);
+  double max = range[1] * 2.;
+  double min = range[0] * 2.;
+  double noise = header->GetRMS();
+  vtkFITSHistogram *histogram = noise < 0.000000001 ? astroVolumeNode->GetHistogram() : NULL;
+  if (histogram)
+    {
+    // half width of the central 68% of the voxels (1 sigma for Gaussian noise)
+    noise = (histogram->GetQuantile(0.8413) - histogram->GetQuantile(0.1587)) / 2.;
+    }
   if (noise < 0.000000001)
     {
     noise = (max - min) / 100.;
     }
-  double noise3 = noise * 3.;
-  double noise7 = noise * 7.;
-  double noise15 = noise * 15.;
+  // the levels are physical values, the transfer functions map voxel values
+  range[0] = min;
+  range[1] = max;
+  astroVolumeNode->GetVoxelRange(range);
+  min = range[0];
+  max = range[1];
+  double noise3 = astroVolumeNode->GetVoxelValue(noise * 3.);
+  double noise7 = astroVolumeNode->GetVoxelValue(noise * 7.);
+  double noise15 = astroVolumeNode->GetVoxelValue(noise * 15.);
 
   vtkSmartPointer<vtkCollection> presets = vtkSmartPointer<vtkCollection>::Take(
       this->PresetsScene->GetNodesByClass("vtkMRMLVolumePropertyNode"));
@@ -49,6 +49,20 @@ public:
 
   typedef vtkSlicerAstroVolumeLogic Self;
 
+  /// Load options of the AstroVolume node set factories, in addition
+  /// to the vtkSlicerVolumesLogic ones (LabelMap, CenterImage, ...).
+  /// The read-time binning factors (1-15, 0 means no binning) are stored
+  /// in the BinningMask bits starting at BinningXYShift and BinningZShift.
+  /// With Subsample the first voxel of each bin is kept (quick preview).
+  enum AstroLoadOptions
+    {
+    NativeDataType = 0x100,
+    Subsample = 0x200,
+    BinningXYShift = 12,
+    BinningZShift = 16,
+    BinningMask = 0xF
+    };
+
   /// Register the factory that the AstroVolume needs to manage fits
   /// file with the specified volumes logic
   void RegisterArchetypeVolumeNodeSetFactory(vtkSlicerVolumesLogic* volumesLogic);
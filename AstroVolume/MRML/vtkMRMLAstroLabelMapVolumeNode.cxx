@@ -19,6 +19,8 @@
 
 #include <string>
 
+#include "vtkSlicerAstroConfigure.h"
+
 // MRML includes
 #include <vtkMRMLAstroLabelMapVolumeDisplayNode.h>
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
@@ -26,18 +28,26 @@
 #include <vtkMRMLScene.h>
 
 // VTK includes
+#include <vtkBitArray.h>
 #include <vtkImageData.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkVolume.h>
 
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLAstroLabelMapVolumeNode);
 
 //----------------------------------------------------------------------------
 vtkMRMLAstroLabelMapVolumeNode::vtkMRMLAstroLabelMapVolumeNode()
 {
+  this->BinaryMaskMTime = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -62,6 +72,45 @@ std::string DoubleToString(double Value)
 {
   return NumberToString<double>(Value);
 }
+
+//----------------------------------------------------------------------------
+template <typename T> void CompactLabels(const T *inPixels, unsigned char *outPixels,
+                                         vtkIdType numElements)
+{
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    outPixels[elemCnt] = static_cast<unsigned char>(inPixels[elemCnt]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// vtkBitArray stores the bits from the most significant one: each byte
+// packs 8 voxels, so the bytes can be filled in parallel.
+template <typename T> void PackBinaryMask(const T *inPixels, unsigned char *bits,
+                                          vtkIdType numElements)
+{
+  const vtkIdType numBytes = (numElements + 7) / 8;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType byteCnt = 0; byteCnt < numBytes; byteCnt++)
+    {
+    const vtkIdType first = byteCnt * 8;
+    const vtkIdType last = first + 8 < numElements ? first + 8 : numElements;
+    unsigned char byte = 0;
+    for (vtkIdType elemCnt = first; elemCnt < last; elemCnt++)
+      {
+      if (inPixels[elemCnt] != 0)
+        {
+        byte |= static_cast<unsigned char>(0x80 >> (elemCnt - first));
+        }
+      }
+    bits[byteCnt] = byte;
+    }
+}
 }//end namespace
 
 //----------------------------------------------------------------------------
@@ -153,3 +202,115 @@ void vtkMRMLAstroLabelMapVolumeNode::UpdateRangeAttributes()
   this->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(range[0]).c_str());
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroLabelMapVolumeNode::ConvertToCompactLabels()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars || scalars->GetNumberOfComponents() != 1)
+    {
+    return false;
+    }
+  if (scalars->GetDataType() == VTK_UNSIGNED_CHAR)
+    {
+    return true;
+    }
+
+  double range[2];
+  scalars->GetRange(range);
+  if (range[0] < VTK_UNSIGNED_CHAR_MIN || range[1] > VTK_UNSIGNED_CHAR_MAX)
+    {
+    return false;
+    }
+
+  const vtkIdType numElements = scalars->GetNumberOfTuples();
+  vtkNew<vtkUnsignedCharArray> labels;
+  labels->SetName(scalars->GetName());
+  labels->SetNumberOfTuples(numElements);
+  unsigned char *outPixels = labels->GetPointer(0);
+  void *inPixels = scalars->GetVoidPointer(0);
+
+  switch (scalars->GetDataType())
+    {
+    case VTK_SHORT:
+      CompactLabels(static_cast<short*>(inPixels), outPixels, numElements);
+      break;
+    case VTK_INT:
+      CompactLabels(static_cast<int*>(inPixels), outPixels, numElements);
+      break;
+    case VTK_FLOAT:
+      CompactLabels(static_cast<float*>(inPixels), outPixels, numElements);
+      break;
+    case VTK_DOUBLE:
+      CompactLabels(static_cast<double*>(inPixels), outPixels, numElements);
+      break;
+    default:
+      vtkErrorMacro("vtkMRMLAstroLabelMapVolumeNode::ConvertToCompactLabels : "
+                    "data type " << scalars->GetDataTypeAsString() << " not supported.");
+      return false;
+    }
+
+  imageData->GetPointData()->SetScalars(labels.GetPointer());
+  imageData->Modified();
+  this->SetAttribute("SlicerAstro.BITPIX", "8");
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkBitArray *vtkMRMLAstroLabelMapVolumeNode::GetBinaryMask()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    return NULL;
+    }
+  if (this->BinaryMask && this->BinaryMaskMTime == scalars->GetMTime() &&
+      this->BinaryMask->GetNumberOfTuples() == scalars->GetNumberOfTuples())
+    {
+    return this->BinaryMask;
+    }
+
+  vtkSmartPointer<vtkBitArray> mask = vtkSmartPointer<vtkBitArray>::New();
+  const vtkIdType numElements = scalars->GetNumberOfTuples();
+  mask->SetNumberOfTuples(numElements);
+  unsigned char *bits = mask->GetPointer(0);
+  void *inPixels = scalars->GetVoidPointer(0);
+
+  switch (scalars->GetDataType())
+    {
+    case VTK_UNSIGNED_CHAR:
+      PackBinaryMask(static_cast<unsigned char*>(inPixels), bits, numElements);
+      break;
+    case VTK_SHORT:
+      PackBinaryMask(static_cast<short*>(inPixels), bits, numElements);
+      break;
+    case VTK_INT:
+      PackBinaryMask(static_cast<int*>(inPixels), bits, numElements);
+      break;
+    case VTK_FLOAT:
+      PackBinaryMask(static_cast<float*>(inPixels), bits, numElements);
+      break;
+    case VTK_DOUBLE:
+      PackBinaryMask(static_cast<double*>(inPixels), bits, numElements);
+      break;
+    default:
+      vtkErrorMacro("vtkMRMLAstroLabelMapVolumeNode::GetBinaryMask : "
+                    "data type " << scalars->GetDataTypeAsString() << " not supported.");
+      return NULL;
+    }
+
+  this->BinaryMask = mask;
+  this->BinaryMaskMTime = scalars->GetMTime();
+  return this->BinaryMask;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroLabelMapVolumeNode::ReleaseBinaryMask()
+{
+  this->BinaryMask = NULL;
+  this->BinaryMaskMTime = 0;
+}
@@ -25,6 +25,10 @@
 
 #include <vtkSlicerAstroVolumeModuleMRMLExport.h>
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
+class vtkBitArray;
 class vtkMRMLAstroLabelMapVolumeDisplayNode;
 
 /// \brief MRML node for representing a label map volume.
@@ -78,9 +82,28 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroLabelMapVolumeNode : public vtkMRMLLabel
   /// Update Max and Min Attributes
   virtual void UpdateRangeAttributes();
 
+  ///
+  /// Store the labels as VTK_UNSIGNED_CHAR (and BITPIX = 8) if they are
+  /// all in [0, 255]: a quarter of the memory of VTK_INT labels and half
+  /// of VTK_SHORT ones. Returns true if the labels are unsigned char.
+  bool ConvertToCompactLabels();
+
+  ///
+  /// Bit-packed binary mask (voxel != 0) of the labels: one bit per
+  /// voxel. The mask is cached and rebuilt when the scalars are modified.
+  vtkBitArray* GetBinaryMask();
+
+  ///
+  /// Free the cached binary mask, e.g. once it has been unpacked by a
+  /// consumer that keeps its own copy
+  void ReleaseBinaryMask();
+
 protected:
   vtkMRMLAstroLabelMapVolumeNode();
   ~vtkMRMLAstroLabelMapVolumeNode();
+
+  vtkSmartPointer<vtkBitArray> BinaryMask;
+  unsigned long BinaryMaskMTime;
   vtkMRMLAstroLabelMapVolumeNode(const vtkMRMLAstroLabelMapVolumeNode&);
   void operator=(const vtkMRMLAstroLabelMapVolumeNode&);
 };
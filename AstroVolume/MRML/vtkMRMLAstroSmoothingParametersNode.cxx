@@ -52,6 +52,7 @@ vtkMRMLAstroSmoothingParametersNode::vtkMRMLAstroSmoothingParametersNode()
   this->SetCores(0);
   this->SetLink(false);
   this->SetAutoRun(false);
+  this->SetRecursive(false);
   this->SetAccuracy(20);
   this->SetTimeStep(0.0325);
   this->SetK(2);
@@ -183,6 +184,12 @@ void vtkMRMLAstroSmoothingParametersNode::ReadXMLAttributes(const char** atts)
       continue;
       }
 
+    if (!strcmp(attName, "Recursive"))
+      {
+      this->Recursive = StringToInt(attValue);
+      continue;
+      }
+
     if (!strcmp(attName, "Rx"))
       {
       this->Rx = StringToInt(attValue);
@@ -292,6 +299,7 @@ void vtkMRMLAstroSmoothingParametersNode::WriteXML(ostream& of, int nIndent)
   of << indent << " Cores=\"" << this->Cores << "\"";
   of << indent << " Link=\"" << this->Link << "\"";
   of << indent << " AutoRun=\"" << this->AutoRun << "\"";
+  of << indent << " Recursive=\"" << this->Recursive << "\"";
   of << indent << " Rx=\"" << this->Rx << "\"";
   of << indent << " Ry=\"" << this->Ry << "\"";
   of << indent << " Rz=\"" << this->Rz << "\"";
@@ -326,6 +334,7 @@ void vtkMRMLAstroSmoothingParametersNode::Copy(vtkMRMLNode *anode)
   this->SetCores(node->GetCores());
   this->SetLink(node->GetLink());
   this->SetAutoRun(node->GetAutoRun());
+  this->SetRecursive(node->GetRecursive());
   this->SetRx(node->GetRx());
   this->SetRy(node->GetRy());
   this->SetRz(node->GetRz());
@@ -593,6 +602,15 @@ void vtkMRMLAstroSmoothingParametersNode::PrintSelf(ostream& os, vtkIndent inden
     os << "Link: Inactive\n";
     }
 
+  if(this->Recursive)
+    {
+    os << "Recursive: Active\n";
+    }
+  else
+    {
+    os << "Recursive: Inactive\n";
+    }
+
   os << "ParameterX: " << this->ParameterX << "\n";
   os << "ParameterY: " << this->ParameterY << "\n";
   os << "ParameterZ: " << this->ParameterZ << "\n";
@@ -91,6 +91,17 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroSmoothingParametersNode : public vtkMRML
   vtkSetMacro(AutoRun,bool);
   vtkGetMacro(AutoRun,bool);
 
+  ///
+  /// Smooth with the recursive Gaussian filter on the CPU: the cost per
+  /// voxel does not depend on the size of the kernel. It is used only if
+  /// there are no rotations and every smoothed axis has a sigma of at
+  /// least 0.75 pixels (FWHM of 1.8 pixels), otherwise the kernel filters
+  /// are used. The recursive filter runs on the CPU only. As for the
+  /// kernel filters, a voxel is blanked (NaN) if the window of the kernel
+  /// (KernelLength voxels along each axis) contains a NaN voxel.
+  vtkSetMacro(Recursive,bool);
+  vtkGetMacro(Recursive,bool);
+
   vtkSetMacro(Accuracy,int);
   vtkGetMacro(Accuracy,int);
 
@@ -153,6 +164,7 @@ protected:
 
   bool Link;
   bool AutoRun;
+  bool Recursive;
 
   int Accuracy;
   int Status;
@@ -25,6 +25,7 @@
 
 // MRML includes
 #include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
 #include <vtkMRMLUnitNode.h>
@@ -1413,10 +1414,27 @@ std::string vtkMRMLAstroVolumeDisplayNode::GetPixelString(double *ijk)
     {
     vtkMRMLUnitNode* unitNode = selectionNode->GetUnitNode("intensity");
 
+    // native integer volumes: show the physical value
+    double bscale = 1., bzero = 0.;
+    vtkMRMLAstroVolumeNode* astroVolumeNode =
+      vtkMRMLAstroVolumeNode::SafeDownCast(this->GetVolumeNode());
+    if (astroVolumeNode)
+      {
+      astroVolumeNode->GetDataScaling(bscale, bzero);
+      }
+
+    // volumes subsampled from a brick cache: show the full resolution value
+    double fullResolutionValue;
+    if (astroVolumeNode && numberOfComponents == 1 &&
+        astroVolumeNode->GetFullResolutionValue(ijk, fullResolutionValue))
+      {
+      return unitNode->GetDisplayStringFromValue(fullResolutionValue);
+      }
+
     for(int i = 0; i < numberOfComponents; i++)
       {
       double component = this->GetVolumeNode()->GetImageData()->
-          GetScalarComponentAsDouble(ijk[0],ijk[1],ijk[2],i);
+          GetScalarComponentAsDouble(ijk[0],ijk[1],ijk[2],i) * bscale + bzero;
       pixel += unitNode->GetDisplayStringFromValue(component);
       pixel += ",";
       }
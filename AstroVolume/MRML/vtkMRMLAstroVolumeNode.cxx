@@ -17,16 +17,35 @@
 
 ==============================================================================*/
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <math.h>
 
+#include "vtkSlicerAstroConfigure.h"
+
 // VTK includes
+#include <vtkCriticalSection.h>
+#include <vtkFloatArray.h>
 #include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
+// vtkFits includes
+#include <vtkFITSBrickCache.h>
+#include <vtkFITSHeader.h>
+#include <vtkFITSHistogram.h>
+
 // MRML includes
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
@@ -40,12 +59,41 @@ vtkMRMLNodeNewMacro(vtkMRMLAstroVolumeNode);
 //----------------------------------------------------------------------------
 vtkMRMLAstroVolumeNode::vtkMRMLAstroVolumeNode()
 {
+  this->AstroHeaderModified = true;
   this->SetAttribute("SlicerAstro.PresetsActive", "0");
+  this->FullResolutionSubsampling[0] = 1;
+  this->FullResolutionSubsampling[1] = 1;
+  this->FullResolutionSubsampling[2] = 1;
+  this->RangeScalarsMTime = 0;
+  this->Range[0] = 0.;
+  this->Range[1] = 0.;
+  this->NoiseScalarsMTime = 0;
+  this->NoiseMean = 0.;
+  this->NoiseRMS = 0.;
+  this->NoiseSpectrumScalarsMTime = 0;
+  this->StatisticsScalarsMTime = 0;
+  this->Histogram = vtkSmartPointer<vtkFITSHistogram>::New();
+  this->HistogramScalarsMTime = 0;
+  this->PyramidScalarsMTime = 0;
+  this->PyramidBuildMinimumDimension = 32;
+  this->PyramidBuildThreader = vtkMultiThreader::New();
+  this->PyramidBuildLock = new vtkSimpleCriticalSection;
+  this->PyramidBuildThreadID = -1;
+  this->PyramidBuildFinished = 0;
+  this->PyramidBuildCancelled = 0;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLAstroVolumeNode::~vtkMRMLAstroVolumeNode()
 {
+  if (this->PyramidBuildThreadID >= 0)
+    {
+    this->CancelPyramidBuild();
+    this->PyramidBuildThreader->TerminateThread(this->PyramidBuildThreadID);
+    this->PyramidBuildThreadID = -1;
+    }
+  this->PyramidBuildThreader->Delete();
+  delete this->PyramidBuildLock;
 }
 
 namespace
@@ -67,305 +115,1612 @@ std::string DoubleToString(double Value)
 }
 
 //----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
+// Number of voxels of the blocks reduced by each thread
+const vtkIdType RangeBlockSize = 1 << 16;
 
 //----------------------------------------------------------------------------
-int StringToInt(const char* str)
+// The comparisons of the inner loop are false for NaN voxels, which are
+// therefore skipped, and compile to vector min/max instructions.
+// Each block is reduced independently and the partial ranges merged at
+// the end: the result does not depend on the number of threads.
+// Returns false if all the voxels are NaN.
+template <typename T> bool UpdateRange(const T *pixels, vtkIdType numElements,
+                                       double &min, double &max)
 {
-  return StringToNumber<int>(str);
+  const int numBlocks = static_cast<int>((numElements + RangeBlockSize - 1) / RangeBlockSize);
+  std::vector<T> blockMin(numBlocks, std::numeric_limits<T>::max());
+  std::vector<T> blockMax(numBlocks, std::numeric_limits<T>::is_integer ?
+                          std::numeric_limits<T>::min() : -std::numeric_limits<T>::max());
+  std::vector<char> blockValid(numBlocks, 0);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int blockCnt = 0; blockCnt < numBlocks; blockCnt++)
+    {
+    const vtkIdType first = blockCnt * RangeBlockSize;
+    const vtkIdType last = std::min(first + RangeBlockSize, numElements);
+    T localMin = blockMin[blockCnt], localMax = blockMax[blockCnt];
+    vtkIdType valid = 0;
+    for (vtkIdType elementCnt = first; elementCnt < last; elementCnt++)
+      {
+      const T value = pixels[elementCnt];
+      localMin = value < localMin ? value : localMin;
+      localMax = value > localMax ? value : localMax;
+      valid += value == value;
+      }
+    blockMin[blockCnt] = localMin;
+    blockMax[blockCnt] = localMax;
+    blockValid[blockCnt] = valid > 0;
+    }
+
+  bool found = false;
+  for (int blockCnt = 0; blockCnt < numBlocks; blockCnt++)
+    {
+    if (!blockValid[blockCnt])
+      {
+      continue;
+      }
+    if (!found || blockMin[blockCnt] < min)
+      {
+      min = blockMin[blockCnt];
+      }
+    if (!found || blockMax[blockCnt] > max)
+      {
+      max = blockMax[blockCnt];
+      }
+    found = true;
+    }
+  return found;
 }
-}// end namespace
 
 //----------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::ReadXMLAttributes(const char** atts)
-{
-  this->Superclass::ReadXMLAttributes(atts);
+// Maximum number of voxels sampled to estimate the noise of the whole
+// cube and of each plane
+const vtkIdType NoiseSampleSize = 1 << 22;
+const vtkIdType NoisePlaneSampleSize = 1 << 16;
 
-  this->WriteXML(std::cout,0);
-}
+// Bins of the histograms used to rank the samples
+const int NoiseHistogramBins = 4096;
+
+// Sigma clipping of the noise estimate
+const double NoiseClipLevel = 3.;
+const int NoiseClipIterations = 5;
+
+// Number of samples of the blocks reduced by each thread
+const int SampleBlockSize = 1 << 16;
 
 //----------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::WriteXML(ostream& of, int nIndent)
+bool IsNaN(float value)
 {
-  this->Superclass::WriteXML(of, nIndent);
+  return value != value;
 }
 
 //----------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::Copy(vtkMRMLNode *anode)
+vtkIdType GreatestCommonDivisor(vtkIdType a, vtkIdType b)
 {
-  vtkMRMLAstroVolumeNode *astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(anode);
-  if (!astroVolumeNode)
+  while (b != 0)
     {
-    return;
+    vtkIdType rest = a % b;
+    a = b;
+    b = rest;
     }
+  return a;
+}
 
-  this->Superclass::Copy(astroVolumeNode);
+//----------------------------------------------------------------------------
+// Stride of a sample of at most sampleSize voxels. The stride is prime
+// with the row length, so that the sample does not fall on the same
+// columns in every row.
+vtkIdType SampleStride(vtkIdType numElements, vtkIdType sampleSize, int rowLength)
+{
+  vtkIdType stride = (numElements + sampleSize - 1) / sampleSize;
+  if (stride <= 1)
+    {
+    return 1;
+    }
+  while (rowLength > 1 && GreatestCommonDivisor(stride, rowLength) != 1)
+    {
+    stride++;
+    }
+  return stride;
 }
 
 //----------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::PrintSelf(ostream& os, vtkIndent indent)
+template <typename T> void SampleVoxels(const T *pixels, vtkIdType numElements,
+                                        vtkIdType stride, std::vector<float> &samples)
 {
-  this->Superclass::PrintSelf(os,indent);
+  const int numSamples = static_cast<int>((numElements + stride - 1) / stride);
+  samples.resize(numSamples);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int sampleCnt = 0; sampleCnt < numSamples; sampleCnt++)
+    {
+    samples[sampleCnt] = static_cast<float>(pixels[sampleCnt * stride]);
+    }
+  samples.erase(std::remove_if(samples.begin(), samples.end(), IsNaN), samples.end());
 }
 
-//---------------------------------------------------------------------------
-vtkMRMLAstroVolumeDisplayNode* vtkMRMLAstroVolumeNode::GetAstroVolumeDisplayNode()
+//----------------------------------------------------------------------------
+// Sample (without the NaN voxels) numElements voxels starting from first
+bool SampleScalars(void *pixels, int dataType, vtkIdType first, vtkIdType numElements,
+                   vtkIdType stride, std::vector<float> &samples)
 {
-  return vtkMRMLAstroVolumeDisplayNode::SafeDownCast(this->GetDisplayNode());
+  switch (dataType)
+    {
+    case VTK_UNSIGNED_CHAR:
+      SampleVoxels(static_cast<unsigned char*>(pixels) + first, numElements, stride, samples);
+      break;
+    case VTK_SHORT:
+      SampleVoxels(static_cast<short*>(pixels) + first, numElements, stride, samples);
+      break;
+    case VTK_INT:
+      SampleVoxels(static_cast<int*>(pixels) + first, numElements, stride, samples);
+      break;
+    case VTK_FLOAT:
+      SampleVoxels(static_cast<float*>(pixels) + first, numElements, stride, samples);
+      break;
+    case VTK_DOUBLE:
+      SampleVoxels(static_cast<double*>(pixels) + first, numElements, stride, samples);
+      break;
+    default:
+      return false;
+    }
+  return true;
 }
 
-//---------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::UpdateRangeAttributes()
+//----------------------------------------------------------------------------
+// Value of the given rank (0 based) of the samples. The histogram of the
+// samples is refined around the bin holding the rank: three passes give
+// a resolution of (max - min) / NoiseHistogramBins^3 without sorting.
+double HistogramRank(const std::vector<float> &samples, double min, double max, int rank)
 {
-  this->GetImageData()->Modified();
-  int *dims = this->GetImageData()->GetDimensions();
-  int numElements = dims[0] * dims[1] * dims[2];
-  const int DataType = this->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  double max = this->GetImageData()->GetScalarTypeMin(), min = this->GetImageData()->GetScalarTypeMax();
-  short *outSPixel = NULL;
-  float *outFPixel = NULL;
-  double *outDPixel = NULL;
+  const int numSamples = static_cast<int>(samples.size());
+  int numThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  std::vector<int> counts(numThreads * NoiseHistogramBins);
 
-  switch (DataType)
+  double low = min, high = max;
+  int below = 0;
+  for (int level = 0; level < 3 && high > low; level++)
     {
-  case VTK_SHORT:
-    outSPixel = static_cast<short*> (this->GetImageData()->GetScalarPointer());
-    for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+    const double scale = NoiseHistogramBins / (high - low);
+    std::fill(counts.begin(), counts.end(), 0);
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    for (int sampleCnt = 0; sampleCnt < numSamples; sampleCnt++)
       {
-      if (*(outSPixel + elementCnt) > max)
+      int thread = 0;
+      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      thread = omp_get_thread_num();
+      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      const double value = samples[sampleCnt];
+      // the upper edge of a refined bin belongs to the next bin
+      if (value < low || value > high || (level > 0 && value == high))
         {
-        max =  *(outSPixel + elementCnt);
+        continue;
         }
-      if (*(outSPixel + elementCnt) < min)
+      int bin = static_cast<int>((value - low) * scale);
+      if (bin >= NoiseHistogramBins)
         {
-        min =  *(outSPixel + elementCnt);
+        bin = NoiseHistogramBins - 1;
         }
+      counts[thread * NoiseHistogramBins + bin]++;
       }
-    break;
-    case VTK_FLOAT:
-      outFPixel = static_cast<float*> (this->GetImageData()->GetScalarPointer());
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+
+    int bin = 0;
+    for (; bin < NoiseHistogramBins - 1; bin++)
+      {
+      int count = 0;
+      for (int thread = 0; thread < numThreads; thread++)
         {
-        if (*(outFPixel + elementCnt) > max)
-          {
-          max =  *(outFPixel + elementCnt);
-          }
-        if (*(outFPixel + elementCnt) < min)
-          {
-          min =  *(outFPixel + elementCnt);
-          }
+        count += counts[thread * NoiseHistogramBins + bin];
         }
-      break;
-    case VTK_DOUBLE:
-      outDPixel = static_cast<double*> (this->GetImageData()->GetScalarPointer());
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+      if (below + count > rank)
         {
-        if (*(outDPixel + elementCnt) > max)
-          {
-          max =  *(outDPixel + elementCnt);
-          }
-        if (*(outDPixel + elementCnt) < min)
-          {
-          min =  *(outDPixel + elementCnt);
-          }
+        break;
         }
-      break;
-    default:
-      vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateRangeAttributes() : Attempt to allocate scalars of type not allowed");
-      return;
+      below += count;
+      }
+
+    const double width = (high - low) / NoiseHistogramBins;
+    low += bin * width;
+    high = low + width;
     }
 
-  this->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(max).c_str());
-  this->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(min).c_str());
+  return 0.5 * (low + high);
+}
 
-  outSPixel = NULL;
-  outFPixel = NULL;
-  outDPixel = NULL;
-  delete outSPixel;
-  delete outFPixel;
-  delete outDPixel;
+//----------------------------------------------------------------------------
+// Median of the samples. The samples of a plane are ranked with
+// nth_element (which reorders them), larger samples with histograms.
+double Median(std::vector<float> &samples)
+{
+  if (samples.empty())
+    {
+    return 0.;
+    }
+  const int rank = static_cast<int>(samples.size() / 2);
+  if (static_cast<vtkIdType>(samples.size()) <= NoisePlaneSampleSize)
+    {
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+    }
+  double min = 0., max = 0.;
+  UpdateRange(&samples[0], static_cast<vtkIdType>(samples.size()), min, max);
+  return HistogramRank(samples, min, max, rank);
 }
 
-//---------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::UpdateNoiseAttributes()
+//----------------------------------------------------------------------------
+// Mean and standard deviation of the samples in [center - halfWidth,
+// center + halfWidth] (all the samples if halfWidth is negative).
+// Returns the number of samples used.
+int MeanAndSigma(const std::vector<float> &samples, double center, double halfWidth,
+                 double &mean, double &sigma)
 {
-  //We calculate the noise as the std of 6 slices of the datacube.
-  int *dims = this->GetImageData()->GetDimensions();
-  const int DataType = this->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  float *outFPixel = NULL;
-  double *outDPixel = NULL;
-  switch (DataType)
+  const int numSamples = static_cast<int>(samples.size());
+  const int numBlocks = (numSamples + SampleBlockSize - 1) / SampleBlockSize;
+  std::vector<double> blockSum(numBlocks, 0.), blockSum2(numBlocks, 0.);
+  std::vector<int> blockCount(numBlocks, 0);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int blockCnt = 0; blockCnt < numBlocks; blockCnt++)
     {
-    case VTK_FLOAT:
-      outFPixel = static_cast<float*> (this->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      outDPixel = static_cast<double*> (this->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateNoiseAttributes : Attempt to allocate scalars of type not allowed");
-      return;
+    const int first = blockCnt * SampleBlockSize;
+    const int last = std::min(first + SampleBlockSize, numSamples);
+    double sum = 0., sum2 = 0.;
+    int count = 0;
+    for (int sampleCnt = first; sampleCnt < last; sampleCnt++)
+      {
+      // accumulate the offsets from center to limit the cancellation
+      const double delta = samples[sampleCnt] - center;
+      if (halfWidth >= 0. && fabs(delta) > halfWidth)
+        {
+        continue;
+        }
+      sum += delta;
+      sum2 += delta * delta;
+      count++;
+      }
+    blockSum[blockCnt] = sum;
+    blockSum2[blockCnt] = sum2;
+    blockCount[blockCnt] = count;
     }
-  double sum = 0., noise1 = 0., noise2 = 0, noise = 0., mean1 = 0., mean2 = 0., mean = 0.;
-  int lowBoundary;
-  int highBoundary;
 
-  if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 3)
+  double sum = 0., sum2 = 0.;
+  int count = 0;
+  for (int blockCnt = 0; blockCnt < numBlocks; blockCnt++)
     {
-    lowBoundary = dims[0] * dims[1] * 2;
-    highBoundary = dims[0] * dims[1] * 4;
+    sum += blockSum[blockCnt];
+    sum2 += blockSum2[blockCnt];
+    count += blockCount[blockCnt];
     }
-  else if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 2)
+  if (count == 0)
+    {
+    return 0;
+    }
+
+  const double meanDelta = sum / count;
+  mean = center + meanDelta;
+  sigma = sqrt(std::max(0., sum2 / count - meanDelta * meanDelta));
+  return count;
+}
+
+//----------------------------------------------------------------------------
+// Noise mean and RMS of the samples: the median and the MAD (scaled to
+// the sigma of a gaussian) are the starting point of a sigma clipping.
+void RobustMeanAndSigma(std::vector<float> &samples, double &mean, double &sigma)
+{
+  mean = 0.;
+  sigma = 0.;
+  const int numSamples = static_cast<int>(samples.size());
+  if (numSamples < 2)
     {
-    lowBoundary = dims[0] * 2;
-    highBoundary = dims[0] * 4;
+    return;
     }
-  else
+
+  const double median = Median(samples);
+  std::vector<float> deviations(numSamples);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int sampleCnt = 0; sampleCnt < numSamples; sampleCnt++)
     {
-    lowBoundary = 2;
-    highBoundary = 4;
+    deviations[sampleCnt] = static_cast<float>(fabs(samples[sampleCnt] - median));
     }
+  mean = median;
+  sigma = 1.4826 * Median(deviations);
 
-  int cont = highBoundary - lowBoundary;
+  // more than half of the voxels have the same value (e.g. blanked
+  // regions or integer data): start from the plain statistics
+  if (sigma <= 0.)
+    {
+    MeanAndSigma(samples, median, -1., mean, sigma);
+    }
 
-  switch (DataType)
+  for (int iteration = 0; iteration < NoiseClipIterations && sigma > 0.; iteration++)
     {
-    case VTK_FLOAT:
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        sum += *(outFPixel + elemCnt);
-        }
-      sum /= cont;
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        noise1 += (*(outFPixel + elemCnt) - sum) * (*(outFPixel+elemCnt) - sum);
-        }
-      noise1 = sqrt(noise1 / cont);
+    double clippedMean = 0., clippedSigma = 0.;
+    if (MeanAndSigma(samples, mean, NoiseClipLevel * sigma, clippedMean, clippedSigma) < 2)
+      {
       break;
-    case VTK_DOUBLE:
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        sum += *(outDPixel + elemCnt);
-        }
-      sum /= cont;
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        noise1 += (*(outDPixel + elemCnt) - sum) * (*(outDPixel+elemCnt) - sum);
-        }
-      noise1 = sqrt(noise1 / cont);
+      }
+    const bool converged = fabs(clippedSigma - sigma) <= 1.E-3 * sigma;
+    mean = clippedMean;
+    sigma = clippedSigma;
+    if (converged)
+      {
       break;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Statistics accumulated on a row, plane or volume
+struct StatisticsAccumulator
+{
+  double Min;
+  double Max;
+  double Sum;
+  double Sum2;
+  double Count;
+  double NaNCount;
+
+  StatisticsAccumulator()
+    {
+    this->Min = VTK_DOUBLE_MAX;
+    this->Max = -VTK_DOUBLE_MAX;
+    this->Sum = 0.;
+    this->Sum2 = 0.;
+    this->Count = 0.;
+    this->NaNCount = 0.;
     }
 
-  mean1 = sum;
+  void Add(const StatisticsAccumulator &other)
+    {
+    this->Min = std::min(this->Min, other.Min);
+    this->Max = std::max(this->Max, other.Max);
+    this->Sum += other.Sum;
+    this->Sum2 += other.Sum2;
+    this->Count += other.Count;
+    this->NaNCount += other.NaNCount;
+    }
 
-  if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 3)
+  void GetStatistics(double *statistics) const
     {
-    lowBoundary = dims[0] * dims[1] * (dims[2] - 4);
-    highBoundary = dims[0] * dims[1] * (dims[2] - 2);
+    if (this->Count == 0.)
+      {
+      const double nan = std::numeric_limits<double>::quiet_NaN();
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMinimum] = nan;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMaximum] = nan;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMean] = nan;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsRMS] = nan;
+      }
+    else
+      {
+      const double mean = this->Sum / this->Count;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMinimum] = this->Min;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMaximum] = this->Max;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsMean] = mean;
+      statistics[vtkMRMLAstroVolumeNode::StatisticsRMS] =
+        sqrt(std::max(0., this->Sum2 / this->Count - mean * mean));
+      }
+    statistics[vtkMRMLAstroVolumeNode::StatisticsNaNCount] = this->NaNCount;
     }
-  else if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 2)
+};
+
+//----------------------------------------------------------------------------
+template <typename T> void AccumulateRow(const T *pixels, int numElements,
+                                         StatisticsAccumulator &row)
+{
+  T min = std::numeric_limits<T>::max();
+  T max = std::numeric_limits<T>::is_integer ?
+    std::numeric_limits<T>::min() : -std::numeric_limits<T>::max();
+  double sum = 0., sum2 = 0.;
+  int count = 0;
+  for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
     {
-    lowBoundary = dims[0] * (dims[1] - 4);
-    highBoundary = dims[0] * (dims[1] - 2);
+    const T value = pixels[elementCnt];
+    if (value != value)
+      {
+      continue;
+      }
+    min = value < min ? value : min;
+    max = value > max ? value : max;
+    sum += value;
+    sum2 += static_cast<double>(value) * value;
+    count++;
     }
-  else
+  if (count > 0)
     {
-    lowBoundary = dims[0] - 4;
-    highBoundary = dims[0] - 2;
+    row.Min = min;
+    row.Max = max;
     }
+  row.Sum = sum;
+  row.Sum2 = sum2;
+  row.Count = count;
+  row.NaNCount = numElements - count;
+}
 
-  sum = 0.;
+//----------------------------------------------------------------------------
+// One pass over the volume, parallel over the planes. Each thread sums
+// the rows of its planes in its own accumulators, merged at the end.
+template <typename T> void AccumulateStatistics(const T *pixels, const int dims[3],
+                                                int numComponents,
+                                                std::vector<StatisticsAccumulator> &planes,
+                                                std::vector<StatisticsAccumulator> &rows)
+{
+  const int rowLength = dims[0] * numComponents;
+  int numThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  std::vector<StatisticsAccumulator> threadRows(numThreads * dims[1]);
+  planes.assign(dims[2], StatisticsAccumulator());
 
-  switch (DataType)
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int k = 0; k < dims[2]; k++)
     {
-    case VTK_FLOAT:
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        sum += *(outFPixel + elemCnt);
-        }
-      sum /= cont;
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        noise2 += (*(outFPixel + elemCnt) - sum) * (*(outFPixel+elemCnt) - sum);
-        }
-      noise2 = sqrt(noise2 / cont);
-      break;
-    case VTK_DOUBLE:
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        sum += *(outDPixel + elemCnt);
-        }
-      sum /= cont;
-      for( int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        noise2 += (*(outDPixel + elemCnt) - sum) * (*(outDPixel+elemCnt) - sum);
-        }
-      noise2 = sqrt(noise2 / cont);
-      break;
+    int thread = 0;
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    thread = omp_get_thread_num();
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    for (int j = 0; j < dims[1]; j++)
+      {
+      StatisticsAccumulator row;
+      AccumulateRow(pixels + (static_cast<vtkIdType>(k) * dims[1] + j) * rowLength,
+                    rowLength, row);
+      planes[k].Add(row);
+      threadRows[thread * dims[1] + j].Add(row);
+      }
     }
 
-  mean2 = sum;
+  rows.assign(dims[1], StatisticsAccumulator());
+  for (int thread = 0; thread < numThreads; thread++)
+    {
+    for (int j = 0; j < dims[1]; j++)
+      {
+      rows[j].Add(threadRows[thread * dims[1] + j]);
+      }
+    }
+}
 
-  noise = (noise1 + noise2) * 0.5;
-  mean = (mean1 + mean2) * 0.5;
+//----------------------------------------------------------------------------
+vtkDoubleArray* StatisticsToArray(const std::vector<StatisticsAccumulator> &accumulators,
+                                  const char *name)
+{
+  vtkDoubleArray *statistics = vtkDoubleArray::New();
+  statistics->SetName(name);
+  statistics->SetNumberOfComponents(vtkMRMLAstroVolumeNode::NumberOfStatisticsComponents);
+  statistics->SetComponentName(vtkMRMLAstroVolumeNode::StatisticsMinimum, "Minimum");
+  statistics->SetComponentName(vtkMRMLAstroVolumeNode::StatisticsMaximum, "Maximum");
+  statistics->SetComponentName(vtkMRMLAstroVolumeNode::StatisticsMean, "Mean");
+  statistics->SetComponentName(vtkMRMLAstroVolumeNode::StatisticsRMS, "RMS");
+  statistics->SetComponentName(vtkMRMLAstroVolumeNode::StatisticsNaNCount, "NaNCount");
+  statistics->SetNumberOfTuples(static_cast<vtkIdType>(accumulators.size()));
+  double *outPixel = statistics->GetPointer(0);
+  for (size_t ii = 0; ii < accumulators.size(); ii++)
+    {
+    accumulators[ii].GetStatistics(outPixel + ii * vtkMRMLAstroVolumeNode::NumberOfStatisticsComponents);
+    }
+  return statistics;
+}
 
-  this->SetAttribute("SlicerAstro.RMS", DoubleToString(noise).c_str());\
-  this->SetAttribute("SlicerAstro.NOISEMEAN", DoubleToString(mean).c_str());
-  outFPixel = NULL;
-  outDPixel = NULL;
-  delete outFPixel;
-  delete outDPixel;
+//----------------------------------------------------------------------------
+template <typename T> void ScaleValues(const T *inPixels, float *outPixels,
+                                       vtkIdType numElements, double bscale, double bzero)
+{
+  for (vtkIdType elementCnt = 0; elementCnt < numElements; elementCnt++)
+    {
+    *(outPixels + elementCnt) = static_cast<float>(*(inPixels + elementCnt) * bscale + bzero);
+    }
 }
 
-//-----------------------------------------------------------
-void vtkMRMLAstroVolumeNode::CreateNoneNode(vtkMRMLScene *scene)
+//----------------------------------------------------------------------------
+bool IsIntegerType(int dataType)
 {
-  // Create a None volume RGBA of 0, 0, 0 so the filters won't complain
-  // about missing input
-  vtkNew<vtkImageData> id;
-  id->SetDimensions(1, 1, 1);
-  id->AllocateScalars(VTK_DOUBLE, 4);
-  id->GetPointData()->GetScalars()->FillComponent(0, 0.0);
-  id->GetPointData()->GetScalars()->FillComponent(1, 125.0);
-  id->GetPointData()->GetScalars()->FillComponent(2, 0.0);
-  id->GetPointData()->GetScalars()->FillComponent(3, 0.0);
+  return dataType == VTK_UNSIGNED_CHAR || dataType == VTK_SHORT || dataType == VTK_INT;
+}
 
-  vtkNew<vtkMRMLAstroVolumeNode> n;
-  n->SetName("None");
-  // the scene will set the id
-  n->SetAndObserveImageData(id.GetPointer());
-  scene->AddNode(n.GetPointer());
+//----------------------------------------------------------------------------
+template <typename T> void DownsamplePlane(const T *inPixels, const int inDims[3],
+                                          float *outPixels, const int outDims[3],
+                                          const int factors[3], int k)
+{
+  const vtkIdType inSliceSize = (vtkIdType) inDims[0] * inDims[1];
+  float *outPixel = outPixels + (vtkIdType) k * outDims[0] * outDims[1];
+  for (int j = 0; j < outDims[1]; j++)
+    {
+    for (int i = 0; i < outDims[0]; i++, outPixel++)
+      {
+      double sum = 0.;
+      int count = 0;
+      for (int kk = k * factors[2]; kk < (k + 1) * factors[2]; kk++)
+        {
+        for (int jj = j * factors[1]; jj < (j + 1) * factors[1]; jj++)
+          {
+          const T *inPixel = inPixels + kk * inSliceSize +
+            (vtkIdType) jj * inDims[0] + i * factors[0];
+          for (int ii = 0; ii < factors[0]; ii++, inPixel++)
+            {
+            const double value = *inPixel;
+            // blank voxels are NaN
+            if (value != value)
+              {
+              continue;
+              }
+            sum += value;
+            count++;
+            }
+          }
+        }
+      *outPixel = count > 0 ? static_cast<float>(sum / count) :
+                              std::numeric_limits<float>::quiet_NaN();
+      }
+    }
 }
 
-//---------------------------------------------------------------------------
-vtkMRMLStorageNode* vtkMRMLAstroVolumeNode::CreateDefaultStorageNode()
+//----------------------------------------------------------------------------
+template <typename T> bool DownsampleVolume(const T *inPixels, const int inDims[3],
+                                            float *outPixels, const int outDims[3],
+                                            const int factors[3], const int *cancelled)
 {
-  return vtkMRMLAstroVolumeStorageNode::New();
+  int aborted = 0;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int k = 0; k < outDims[2]; k++)
+    {
+    if (aborted || (cancelled && *cancelled))
+      {
+      aborted = 1;
+      continue;
+      }
+    DownsamplePlane<T>(inPixels, inDims, outPixels, outDims, factors, k);
+    }
+  return !aborted;
 }
 
-//---------------------------------------------------------------------------
-void vtkMRMLAstroVolumeNode::CreateDefaultDisplayNodes()
+//----------------------------------------------------------------------------
+bool NeedsPyramidLevel(vtkImageData *imageData, int minimumDimension)
 {
-  vtkMRMLAstroVolumeDisplayNode *displayNode = 
-    vtkMRMLAstroVolumeDisplayNode::SafeDownCast(this->GetDisplayNode());
-  if(displayNode == NULL)
+  int *dims = imageData->GetDimensions();
+  for (int i = 0; i < 3; i++)
     {
-    displayNode = vtkMRMLAstroVolumeDisplayNode::New();
-    if(this->GetScene())
+    if (dims[i] >= 2 * minimumDimension)
       {
-      displayNode->SetScene(this->GetScene());
-      this->GetScene()->AddNode(displayNode);
-      displayNode->SetDefaultColorMap();
-      displayNode->Delete();
+      return true;
+      }
+    }
+  return false;
+}
 
-      this->SetAndObserveDisplayNodeID(displayNode->GetID());
-      std::cout << "Display node set and observed" << std::endl;
+//----------------------------------------------------------------------------
+const int MaximumNumberOfPyramidLevels = 12;
+}// end namespace
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::ReadXMLAttributes(const char** atts)
+{
+  this->Superclass::ReadXMLAttributes(atts);
+  this->AstroHeaderModified = true;
+
+  this->WriteXML(std::cout,0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::WriteXML(ostream& of, int nIndent)
+{
+  this->Superclass::WriteXML(of, nIndent);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::Copy(vtkMRMLNode *anode)
+{
+  vtkMRMLAstroVolumeNode *astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(anode);
+  if (!astroVolumeNode)
+    {
+    return;
+    }
+
+  this->Superclass::Copy(astroVolumeNode);
+  this->AstroHeaderModified = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::SetAttribute(const char* name, const char* value)
+{
+  if (name && !strncmp(name, "SlicerAstro.", 12))
+    {
+    const char *oldValue = this->GetAttribute(name);
+    if (!oldValue || !value || strcmp(oldValue, value))
+      {
+      this->AstroHeaderModified = true;
+      }
+    }
+  this->Superclass::SetAttribute(name, value);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "BrickCache: " << (this->BrickCache ? "set" : "none") << "\n";
+  os << indent << "FullResolutionSubsampling: " << this->FullResolutionSubsampling[0] << " "
+     << this->FullResolutionSubsampling[1] << " " << this->FullResolutionSubsampling[2] << "\n";
+  os << indent << "NumberOfPyramidLevels: " << this->GetNumberOfPyramidLevels() << "\n";
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLAstroVolumeDisplayNode* vtkMRMLAstroVolumeNode::GetAstroVolumeDisplayNode()
+{
+  return vtkMRMLAstroVolumeDisplayNode::SafeDownCast(this->GetDisplayNode());
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::UpdateRangeAttributes()
+{
+  // the image data can be binned: the range of the full resolution cube
+  // is known from the statistics of the bricks
+  if (this->BrickCache && this->BrickCache->IsOpen())
+    {
+    double range[2];
+    this->BrickCache->GetRange(range);
+    this->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(range[1]).c_str());
+    this->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(range[0]).c_str());
+    return;
+    }
+
+  // callers rely on this to refresh the pipeline after writing the voxels
+  // in place, even if the range (cached against the scalars) is unchanged
+  if (this->GetImageData())
+    {
+    this->GetImageData()->Modified();
+    }
+  if (!this->ComputeRange())
+    {
+    return;
+    }
+
+  // the attributes are physical values
+  double range[2] = {this->Range[0], this->Range[1]};
+  this->GetPhysicalRange(range);
+  this->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(range[1]).c_str());
+  this->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(range[0]).c_str());
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::ComputeRange()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::ComputeRange : no scalars.");
+    return false;
+    }
+
+  if (this->RangeScalars != scalars || this->RangeScalarsMTime != scalars->GetMTime())
+    {
+    const vtkIdType numElements = scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+    double min = 0., max = 0.;
+    void *outPixel = scalars->GetVoidPointer(0);
+
+    switch (scalars->GetDataType())
+      {
+      case VTK_UNSIGNED_CHAR:
+        UpdateRange(static_cast<unsigned char*>(outPixel), numElements, min, max);
+        break;
+      case VTK_SHORT:
+        UpdateRange(static_cast<short*>(outPixel), numElements, min, max);
+        break;
+      case VTK_INT:
+        UpdateRange(static_cast<int*>(outPixel), numElements, min, max);
+        break;
+      case VTK_FLOAT:
+        UpdateRange(static_cast<float*>(outPixel), numElements, min, max);
+        break;
+      case VTK_DOUBLE:
+        UpdateRange(static_cast<double*>(outPixel), numElements, min, max);
+        break;
+      default:
+        vtkErrorMacro("vtkMRMLAstroVolumeNode::ComputeRange : Attempt to allocate scalars of type not allowed");
+        return false;
+      }
+
+    this->Range[0] = min;
+    this->Range[1] = max;
+    this->RangeScalars = scalars;
+    this->RangeScalarsMTime = scalars->GetMTime();
+    }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::UpdateNoiseAttributes()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateNoiseAttributes : no scalars.");
+    return;
+    }
+
+  if (this->NoiseScalars != scalars || this->NoiseScalarsMTime != scalars->GetMTime())
+    {
+    const vtkIdType numElements = scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+    const vtkIdType stride = SampleStride(numElements, NoiseSampleSize,
+                                          imageData->GetDimensions()[0]);
+    std::vector<float> samples;
+    if (!SampleScalars(scalars->GetVoidPointer(0), scalars->GetDataType(), 0,
+                       numElements, stride, samples))
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateNoiseAttributes : Attempt to allocate scalars of type not allowed");
+      return;
+      }
+
+    RobustMeanAndSigma(samples, this->NoiseMean, this->NoiseRMS);
+    this->NoiseScalars = scalars;
+    this->NoiseScalarsMTime = scalars->GetMTime();
+    }
+
+  // the attributes are physical values
+  double bscale, bzero;
+  this->GetDataScaling(bscale, bzero);
+  this->SetAttribute("SlicerAstro.RMS", DoubleToString(this->NoiseRMS * fabs(bscale)).c_str());
+  this->SetAttribute("SlicerAstro.NOISEMEAN", DoubleToString(this->NoiseMean * bscale + bzero).c_str());
+}
+
+//---------------------------------------------------------------------------
+vtkDoubleArray *vtkMRMLAstroVolumeNode::GetNoiseSpectrum()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars || imageData->GetDimensions()[2] < 2)
+    {
+    return NULL;
+    }
+
+  if (this->NoiseSpectrum && this->NoiseSpectrumScalars == scalars &&
+      this->NoiseSpectrumScalarsMTime == scalars->GetMTime())
+    {
+    return this->NoiseSpectrum;
+    }
+
+  int *dims = imageData->GetDimensions();
+  const int dataType = scalars->GetDataType();
+  void *pixels = scalars->GetVoidPointer(0);
+  const vtkIdType planeSize = static_cast<vtkIdType>(dims[0]) * dims[1] *
+    scalars->GetNumberOfComponents();
+  const vtkIdType stride = SampleStride(planeSize, NoisePlaneSampleSize, dims[0]);
+
+  vtkSmartPointer<vtkDoubleArray> spectrum = vtkSmartPointer<vtkDoubleArray>::New();
+  spectrum->SetName("NoiseSpectrum");
+  spectrum->SetNumberOfComponents(2);
+  spectrum->SetNumberOfTuples(dims[2]);
+  double *outPixel = spectrum->GetPointer(0);
+
+  int failed = 0;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int k = 0; k < dims[2]; k++)
+    {
+    std::vector<float> samples;
+    double mean = 0., sigma = 0.;
+    if (!SampleScalars(pixels, dataType, k * planeSize, planeSize, stride, samples))
+      {
+      failed = 1;
+      continue;
+      }
+    RobustMeanAndSigma(samples, mean, sigma);
+    outPixel[2 * k] = mean;
+    outPixel[2 * k + 1] = sigma;
+    }
+
+  if (failed)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::GetNoiseSpectrum : Attempt to allocate scalars of type not allowed");
+    return NULL;
+    }
+
+  this->NoiseSpectrum = spectrum;
+  this->NoiseSpectrumScalars = scalars;
+  this->NoiseSpectrumScalarsMTime = scalars->GetMTime();
+  return this->NoiseSpectrum;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::UpdateStatistics()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    return false;
+    }
+
+  if (this->PlaneStatistics && this->StatisticsScalars == scalars &&
+      this->StatisticsScalarsMTime == scalars->GetMTime())
+    {
+    return true;
+    }
+
+  int *dims = imageData->GetDimensions();
+  const int numComponents = scalars->GetNumberOfComponents();
+  void *pixels = scalars->GetVoidPointer(0);
+  std::vector<StatisticsAccumulator> planes, rows;
+
+  switch (scalars->GetDataType())
+    {
+    case VTK_UNSIGNED_CHAR:
+      AccumulateStatistics(static_cast<unsigned char*>(pixels), dims, numComponents, planes, rows);
+      break;
+    case VTK_SHORT:
+      AccumulateStatistics(static_cast<short*>(pixels), dims, numComponents, planes, rows);
+      break;
+    case VTK_INT:
+      AccumulateStatistics(static_cast<int*>(pixels), dims, numComponents, planes, rows);
+      break;
+    case VTK_FLOAT:
+      AccumulateStatistics(static_cast<float*>(pixels), dims, numComponents, planes, rows);
+      break;
+    case VTK_DOUBLE:
+      AccumulateStatistics(static_cast<double*>(pixels), dims, numComponents, planes, rows);
+      break;
+    default:
+      vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateStatistics : Attempt to allocate scalars of type not allowed");
+      return false;
+    }
+
+  this->PlaneStatistics.TakeReference(StatisticsToArray(planes, "PlaneStatistics"));
+  this->RowStatistics.TakeReference(StatisticsToArray(rows, "RowStatistics"));
+  this->StatisticsScalars = scalars;
+  this->StatisticsScalarsMTime = scalars->GetMTime();
+
+  // the range of the volume comes for free
+  StatisticsAccumulator volume;
+  for (size_t k = 0; k < planes.size(); k++)
+    {
+    volume.Add(planes[k]);
+    }
+  this->Range[0] = volume.Count > 0. ? volume.Min : 0.;
+  this->Range[1] = volume.Count > 0. ? volume.Max : 0.;
+  this->RangeScalars = scalars;
+  this->RangeScalarsMTime = scalars->GetMTime();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+vtkDoubleArray *vtkMRMLAstroVolumeNode::GetPlaneStatistics()
+{
+  return this->UpdateStatistics() ? this->PlaneStatistics.GetPointer() : NULL;
+}
+
+//---------------------------------------------------------------------------
+vtkDoubleArray *vtkMRMLAstroVolumeNode::GetRowStatistics()
+{
+  return this->UpdateStatistics() ? this->RowStatistics.GetPointer() : NULL;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::GetPlanesRange(int firstPlane, int lastPlane, double range[2])
+{
+  vtkDoubleArray *statistics = this->GetPlaneStatistics();
+  if (!statistics)
+    {
+    return false;
+    }
+
+  const int numPlanes = static_cast<int>(statistics->GetNumberOfTuples());
+  if (lastPlane < 0 || lastPlane >= numPlanes)
+    {
+    lastPlane = numPlanes - 1;
+    }
+  firstPlane = std::max(firstPlane, 0);
+
+  bool found = false;
+  double planesRange[2] = {0., 0.};
+  for (int k = firstPlane; k <= lastPlane; k++)
+    {
+    const double min = statistics->GetComponent(k, StatisticsMinimum);
+    const double max = statistics->GetComponent(k, StatisticsMaximum);
+    // NaN if the plane has only NaN voxels
+    if (min != min)
+      {
+      continue;
+      }
+    planesRange[0] = found ? std::min(planesRange[0], min) : min;
+    planesRange[1] = found ? std::max(planesRange[1], max) : max;
+    found = true;
+    }
+  if (found)
+    {
+    this->GetPhysicalRange(planesRange);
+    range[0] = planesRange[0];
+    range[1] = planesRange[1];
+    }
+  return found;
+}
+
+//---------------------------------------------------------------------------
+vtkFITSHistogram *vtkMRMLAstroVolumeNode::GetHistogram()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    return NULL;
+    }
+
+  // the histogram is in physical values
+  double bscale, bzero;
+  this->GetDataScaling(bscale, bzero);
+  if (this->HistogramScalars == scalars &&
+      this->HistogramScalarsMTime == scalars->GetMTime() &&
+      this->Histogram->GetDataScale() == bscale &&
+      this->Histogram->GetDataOffset() == bzero)
+    {
+    return this->Histogram;
+    }
+
+  this->Histogram->SetDataScale(bscale);
+  this->Histogram->SetDataOffset(bzero);
+  if (!this->ComputeRange() || !this->Histogram->Build(scalars, this->Range))
+    {
+    return NULL;
+    }
+
+  this->HistogramScalars = scalars;
+  this->HistogramScalarsMTime = scalars->GetMTime();
+  return this->Histogram;
+}
+
+//---------------------------------------------------------------------------
+vtkFITSHeader *vtkMRMLAstroVolumeNode::GetAstroHeader()
+{
+  // The MTime of the node changes with properties unrelated to the
+  // header (and not at all between StartModify and EndModify): the
+  // header is parsed again only if a "SlicerAstro." attribute was set.
+  if (this->AstroHeader && !this->AstroHeaderModified)
+    {
+    return this->AstroHeader;
+    }
+
+  const std::string prefix = "SlicerAstro.";
+  std::map<std::string, std::string> keyValues;
+  std::vector<std::string> keys = this->GetAttributeNames();
+  for (std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); ++it)
+    {
+    if (it->compare(0, prefix.size(), prefix) != 0)
+      {
+      continue;
+      }
+    const char *value = this->GetAttribute(it->c_str());
+    if (value)
+      {
+      keyValues[*it] = value;
+      }
+    }
+
+  if (!this->AstroHeader)
+    {
+    this->AstroHeader = vtkSmartPointer<vtkFITSHeader>::New();
+    }
+  this->AstroHeader->Parse(keyValues);
+  this->AstroHeaderModified = false;
+
+  return this->AstroHeader;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::GetDataScaling(double &bscale, double &bzero)
+{
+  bscale = 1.;
+  bzero = 0.;
+
+  if (!this->GetImageData() || !this->GetImageData()->GetPointData()->GetScalars() ||
+      !IsIntegerType(this->GetImageData()->GetPointData()->GetScalars()->GetDataType()))
+    {
+    return false;
+    }
+
+  vtkFITSHeader *header = this->GetAstroHeader();
+  if (header->GetDATATYPE() == "MASK")
+    {
+    return false;
+    }
+
+  bscale = header->GetBSCALE();
+  bzero = header->GetBZERO();
+
+  return fabs(bscale - 1.) > 1.E-12 || fabs(bzero) > 1.E-12;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::GetPhysicalRange(double range[2])
+{
+  double bscale, bzero;
+  if (!this->GetDataScaling(bscale, bzero))
+    {
+    return;
+    }
+
+  const double min = range[0] * bscale + bzero;
+  const double max = range[1] * bscale + bzero;
+  range[0] = std::min(min, max);
+  range[1] = std::max(min, max);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::GetVoxelRange(double range[2])
+{
+  double bscale, bzero;
+  if (!this->GetDataScaling(bscale, bzero) || bscale == 0.)
+    {
+    return;
+    }
+
+  const double min = (range[0] - bzero) / bscale;
+  const double max = (range[1] - bzero) / bscale;
+  range[0] = std::min(min, max);
+  range[1] = std::max(min, max);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetVoxelValue(double value)
+{
+  double bscale, bzero;
+  if (!this->GetDataScaling(bscale, bzero) || bscale == 0.)
+    {
+    return value;
+    }
+
+  return (value - bzero) / bscale;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::ApplyDataScaling()
+{
+  if (!this->GetImageData() || !this->GetImageData()->GetPointData()->GetScalars())
+    {
+    return false;
+    }
+
+  vtkDataArray *scalars = this->GetImageData()->GetPointData()->GetScalars();
+  const int DataType = scalars->GetDataType();
+  if (!IsIntegerType(DataType))
+    {
+    return true;
+    }
+
+  double bscale, bzero;
+  bool scaled = this->GetDataScaling(bscale, bzero);
+
+  const vtkIdType numElements = scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+  vtkNew<vtkFloatArray> physical;
+  physical->SetName(scalars->GetName());
+  physical->SetNumberOfComponents(scalars->GetNumberOfComponents());
+  physical->SetNumberOfTuples(scalars->GetNumberOfTuples());
+  float *outFPixel = physical->GetPointer(0);
+  void *inPixel = scalars->GetVoidPointer(0);
+
+  switch (DataType)
+    {
+    case VTK_UNSIGNED_CHAR:
+      ScaleValues(static_cast<unsigned char*>(inPixel), outFPixel, numElements, bscale, bzero);
+      break;
+    case VTK_SHORT:
+      ScaleValues(static_cast<short*>(inPixel), outFPixel, numElements, bscale, bzero);
+      break;
+    case VTK_INT:
+      ScaleValues(static_cast<int*>(inPixel), outFPixel, numElements, bscale, bzero);
+      break;
+    }
+
+  this->GetImageData()->GetPointData()->SetScalars(physical.GetPointer());
+  this->GetImageData()->Modified();
+
+  // the range and noise attributes are already physical values
+  int wasModifying = this->StartModify();
+  if (scaled)
+    {
+    this->SetAttribute("SlicerAstro.BSCALE", "1.");
+    this->SetAttribute("SlicerAstro.BZERO", "0.");
+    }
+  this->SetAttribute("SlicerAstro.BITPIX", "-32");
+  this->EndModify(wasModifying);
+
+  return true;
+}
+
+//-----------------------------------------------------------
+void vtkMRMLAstroVolumeNode::CreateNoneNode(vtkMRMLScene *scene)
+{
+  // Create a None volume RGBA of 0, 0, 0 so the filters won't complain
+  // about missing input
+  vtkNew<vtkImageData> id;
+  id->SetDimensions(1, 1, 1);
+  id->AllocateScalars(VTK_DOUBLE, 4);
+  id->GetPointData()->GetScalars()->FillComponent(0, 0.0);
+  id->GetPointData()->GetScalars()->FillComponent(1, 125.0);
+  id->GetPointData()->GetScalars()->FillComponent(2, 0.0);
+  id->GetPointData()->GetScalars()->FillComponent(3, 0.0);
+
+  vtkNew<vtkMRMLAstroVolumeNode> n;
+  n->SetName("None");
+  // the scene will set the id
+  n->SetAndObserveImageData(id.GetPointer());
+  scene->AddNode(n.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLStorageNode* vtkMRMLAstroVolumeNode::CreateDefaultStorageNode()
+{
+  return vtkMRMLAstroVolumeStorageNode::New();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::CreateDefaultDisplayNodes()
+{
+  vtkMRMLAstroVolumeDisplayNode *displayNode = 
+    vtkMRMLAstroVolumeDisplayNode::SafeDownCast(this->GetDisplayNode());
+  if(displayNode == NULL)
+    {
+    displayNode = vtkMRMLAstroVolumeDisplayNode::New();
+    if(this->GetScene())
+      {
+      displayNode->SetScene(this->GetScene());
+      this->GetScene()->AddNode(displayNode);
+      displayNode->SetDefaultColorMap();
+      displayNode->Delete();
+
+      this->SetAndObserveDisplayNodeID(displayNode->GetID());
+      std::cout << "Display node set and observed" << std::endl;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::SetBrickCache(vtkFITSBrickCache *brickCache)
+{
+  if (this->BrickCache == brickCache)
+    {
+    return;
+    }
+  this->BrickCache = brickCache;
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+vtkFITSBrickCache *vtkMRMLAstroVolumeNode::GetBrickCache()
+{
+  return this->BrickCache;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::ReadFullResolutionExtent(const int extent[6], vtkImageData *out)
+{
+  if (!out)
+    {
+    return false;
+    }
+
+  out->SetExtent(0, extent[1] - extent[0], 0, extent[3] - extent[2], 0, extent[5] - extent[4]);
+  out->AllocateScalars(VTK_FLOAT, 1);
+  float *outPixel = static_cast<float*>(out->GetScalarPointer());
+
+  if (this->BrickCache && this->BrickCache->IsOpen())
+    {
+    return this->BrickCache->ReadExtent(extent, outPixel);
+    }
+
+  vtkImageData *imageData = this->GetImageData();
+  if (!imageData || !imageData->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::ReadFullResolutionExtent : no data.");
+    return false;
+    }
+
+  int *dims = imageData->GetDimensions();
+  for (int i = 0; i < 3; i++)
+    {
+    if (extent[2 * i] < 0 || extent[2 * i + 1] >= dims[i] || extent[2 * i] > extent[2 * i + 1])
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeNode::ReadFullResolutionExtent : extent out of the volume.");
+      return false;
+      }
+    }
+
+  vtkDataArray *scalars = imageData->GetPointData()->GetScalars();
+  for (int k = extent[4]; k <= extent[5]; k++)
+    {
+    for (int j = extent[2]; j <= extent[3]; j++)
+      {
+      vtkIdType inIndex = ((vtkIdType) k * dims[1] + j) * dims[0] + extent[0];
+      for (int i = extent[0]; i <= extent[1]; i++, inIndex++, outPixel++)
+        {
+        *outPixel = static_cast<float>(scalars->GetComponent(inIndex, 0));
+        }
+      }
+    }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::IsSubsampledFromBrickCache()
+{
+  return this->BrickCache && this->BrickCache->IsOpen() &&
+         (this->FullResolutionSubsampling[0] > 1 ||
+          this->FullResolutionSubsampling[1] > 1 ||
+          this->FullResolutionSubsampling[2] > 1);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::GetFullResolutionValue(const double ijk[3], double &value)
+{
+  if (!this->IsSubsampledFromBrickCache())
+    {
+    return false;
+    }
+
+  int extent[6];
+  int *dims = this->BrickCache->GetDimensions();
+  for (int i = 0; i < 3; i++)
+    {
+    extent[2 * i] = static_cast<int>(ijk[i]) * this->FullResolutionSubsampling[i];
+    extent[2 * i + 1] = extent[2 * i];
+    if (extent[2 * i] < 0 || extent[2 * i] >= dims[i])
+      {
+      return false;
+      }
+    }
+
+  vtkNew<vtkImageData> voxel;
+  if (!this->ReadFullResolutionExtent(extent, voxel.GetPointer()))
+    {
+    return false;
+    }
+  value = voxel->GetScalarComponentAsDouble(0, 0, 0, 0);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+vtkImageData *vtkMRMLAstroVolumeNode::DownsampleLevel(vtkImageData *input, bool fullResolution,
+                                                      int *cancelled)
+{
+  if (!input || !input->GetPointData()->GetScalars())
+    {
+    return NULL;
+    }
+
+  int *inDims = input->GetDimensions();
+  int factors[3], outDims[3];
+  double inSpacing[3] = {1., 1., 1.}, inOrigin[3] = {0., 0., 0.};
+  double outSpacing[3], outOrigin[3];
+  if (!fullResolution)
+    {
+    input->GetSpacing(inSpacing);
+    input->GetOrigin(inOrigin);
+    }
+  for (int i = 0; i < 3; i++)
+    {
+    factors[i] = inDims[i] > 1 ? 2 : 1;
+    outDims[i] = inDims[i] / factors[i];
+    outSpacing[i] = inSpacing[i] * factors[i];
+    // the voxel of the output is at the center of the voxels it averages
+    outOrigin[i] = inOrigin[i] + (factors[i] - 1) * 0.5 * inSpacing[i];
+    }
+
+  vtkImageData *output = vtkImageData::New();
+  output->SetDimensions(outDims);
+  output->SetSpacing(outSpacing);
+  output->SetOrigin(outOrigin);
+  output->AllocateScalars(VTK_FLOAT, 1);
+  float *outPixels = static_cast<float*>(output->GetScalarPointer());
+
+  bool success = false;
+  const void *inPixels = input->GetScalarPointer();
+  switch (input->GetPointData()->GetScalars()->GetDataType())
+    {
+    case VTK_DOUBLE:
+      success = DownsampleVolume<double>(static_cast<const double*>(inPixels), inDims,
+                                         outPixels, outDims, factors, cancelled);
+      break;
+    case VTK_FLOAT:
+      success = DownsampleVolume<float>(static_cast<const float*>(inPixels), inDims,
+                                        outPixels, outDims, factors, cancelled);
+      break;
+    case VTK_INT:
+      success = DownsampleVolume<int>(static_cast<const int*>(inPixels), inDims,
+                                      outPixels, outDims, factors, cancelled);
+      break;
+    case VTK_SHORT:
+      success = DownsampleVolume<short>(static_cast<const short*>(inPixels), inDims,
+                                        outPixels, outDims, factors, cancelled);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      success = DownsampleVolume<unsigned char>(static_cast<const unsigned char*>(inPixels), inDims,
+                                                outPixels, outDims, factors, cancelled);
+      break;
+    default:
+      // static (and run by the build thread): no object to report to
+      vtkGenericWarningMacro("vtkMRMLAstroVolumeNode::DownsampleLevel : "
+                             "attempt to downsample unknown data type.");
+    }
+
+  if (!success)
+    {
+    output->Delete();
+    return NULL;
+    }
+  return output;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::BuildPyramid(int minimumDimension)
+{
+  vtkImageData *imageData = this->GetImageData();
+  if (!imageData || !imageData->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::BuildPyramid : no data.");
+    return false;
+    }
+
+  this->CancelPyramidBuild();
+  this->ClearPyramid();
+
+  vtkSmartPointer<vtkImageData> level = imageData;
+  while (NeedsPyramidLevel(level, minimumDimension) &&
+         (int) this->PyramidLevels.size() < MaximumNumberOfPyramidLevels)
+    {
+    vtkImageData *nextLevel = vtkMRMLAstroVolumeNode::DownsampleLevel
+      (level, this->PyramidLevels.empty(), NULL);
+    if (!nextLevel)
+      {
+      this->ClearPyramid();
+      return false;
+      }
+    level = vtkSmartPointer<vtkImageData>::Take(nextLevel);
+    this->PyramidLevels.push_back(level);
+    }
+
+  this->PyramidScalars = imageData->GetPointData()->GetScalars();
+  this->PyramidScalarsMTime = this->PyramidScalars->GetMTime();
+  this->Modified();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::BuildPyramidAsync(int minimumDimension)
+{
+  if (this->PyramidBuildThreadID >= 0)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::BuildPyramidAsync : "
+                  "the pyramid is already being built.");
+    return false;
+    }
+
+  vtkImageData *imageData = this->GetImageData();
+  if (!imageData || !imageData->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeNode::BuildPyramidAsync : no data.");
+    return false;
+    }
+
+  // the thread works on its own shallow copy of the image data (holding a
+  // reference to the scalars) and never touches the node: the levels are
+  // attached by ProcessPyramidBuild, if the scalars are still the same
+  this->PyramidBuildInput = vtkSmartPointer<vtkImageData>::New();
+  this->PyramidBuildInput->ShallowCopy(imageData);
+  this->PyramidBuildLevels.clear();
+  this->PyramidBuildMinimumDimension = minimumDimension;
+  this->PyramidScalars = imageData->GetPointData()->GetScalars();
+  this->PyramidScalarsMTime = this->PyramidScalars->GetMTime();
+  this->PyramidBuildFinished = 0;
+  this->PyramidBuildCancelled = 0;
+  this->PyramidBuildThreadID = this->PyramidBuildThreader->SpawnThread
+    (&vtkMRMLAstroVolumeNode::PyramidBuildThread, this);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkMRMLAstroVolumeNode::PyramidBuildThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkMRMLAstroVolumeNode *self = static_cast<vtkMRMLAstroVolumeNode*>(info->UserData);
+
+  vtkSmartPointer<vtkImageData> level = self->PyramidBuildInput;
+  while (NeedsPyramidLevel(level, self->PyramidBuildMinimumDimension) &&
+         (int) self->PyramidBuildLevels.size() < MaximumNumberOfPyramidLevels)
+    {
+    vtkImageData *nextLevel = vtkMRMLAstroVolumeNode::DownsampleLevel
+      (level, self->PyramidBuildLevels.empty(), &self->PyramidBuildCancelled);
+    if (!nextLevel)
+      {
+      break;
+      }
+    level = vtkSmartPointer<vtkImageData>::Take(nextLevel);
+    self->PyramidBuildLevels.push_back(level);
+    }
+
+  self->PyramidBuildLock->Lock();
+  self->PyramidBuildFinished = 1;
+  self->PyramidBuildLock->Unlock();
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNode::ProcessPyramidBuild()
+{
+  if (this->PyramidBuildThreadID < 0)
+    {
+    return PyramidBuildIdle;
+    }
+
+  this->PyramidBuildLock->Lock();
+  int finished = this->PyramidBuildFinished;
+  int cancelled = this->PyramidBuildCancelled;
+  this->PyramidBuildLock->Unlock();
+
+  if (!finished)
+    {
+    return PyramidBuildRunning;
+    }
+
+  this->PyramidBuildThreader->TerminateThread(this->PyramidBuildThreadID);
+  this->PyramidBuildThreadID = -1;
+
+  int state = PyramidBuildCancelled;
+  vtkImageData *imageData = this->GetImageData();
+  int *buildDims = this->PyramidBuildInput->GetDimensions();
+  if (!cancelled && imageData && this->IsPyramidUpToDate() &&
+      std::equal(buildDims, buildDims + 3, imageData->GetDimensions()))
+    {
+    this->PyramidLevels = this->PyramidBuildLevels;
+    this->Modified();
+    state = PyramidBuildDone;
+    }
+
+  this->PyramidBuildLevels.clear();
+  this->PyramidBuildInput = NULL;
+
+  return state;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::CancelPyramidBuild()
+{
+  if (this->PyramidBuildThreadID < 0)
+    {
+    return;
+    }
+
+  this->PyramidBuildLock->Lock();
+  this->PyramidBuildCancelled = 1;
+  this->PyramidBuildLock->Unlock();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::ClearPyramid()
+{
+  if (this->PyramidLevels.empty())
+    {
+    return;
+    }
+  this->PyramidLevels.clear();
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::IsPyramidUpToDate()
+{
+  vtkImageData *imageData = this->GetImageData();
+  vtkDataArray *scalars = imageData ? imageData->GetPointData()->GetScalars() : NULL;
+  return scalars && scalars == this->PyramidScalars.GetPointer() &&
+         scalars->GetMTime() == this->PyramidScalarsMTime;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNode::GetNumberOfPyramidLevels()
+{
+  if (this->PyramidLevels.empty())
+    {
+    return 1;
+    }
+  if (!this->IsPyramidUpToDate())
+    {
+    // stale levels are released lazily, they are never shown
+    this->PyramidLevels.clear();
+    return 1;
+    }
+  return (int) this->PyramidLevels.size() + 1;
+}
+
+//---------------------------------------------------------------------------
+vtkImageData *vtkMRMLAstroVolumeNode::GetPyramidLevel(int level)
+{
+  if (level <= 0 || level >= this->GetNumberOfPyramidLevels())
+    {
+    return this->GetImageData();
+    }
+  return this->PyramidLevels[level - 1];
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::GetPyramidLevelIJKToRASMatrix(int level, vtkMatrix4x4 *mat)
+{
+  if (!mat)
+    {
+    return;
+    }
+
+  this->GetIJKToRASMatrix(mat);
+  if (level <= 0 || level >= this->GetNumberOfPyramidLevels())
+    {
+    return;
+    }
+
+  // IJK of the level to IJK of level 0
+  vtkImageData *levelData = this->PyramidLevels[level - 1];
+  double spacing[3], origin[3];
+  levelData->GetSpacing(spacing);
+  levelData->GetOrigin(origin);
+  vtkNew<vtkMatrix4x4> levelToFull;
+  for (int i = 0; i < 3; i++)
+    {
+    levelToFull->SetElement(i, i, spacing[i]);
+    levelToFull->SetElement(i, 3, origin[i]);
+    }
+  vtkMatrix4x4::Multiply4x4(mat, levelToFull.GetPointer(), mat);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNode::GetPyramidLevelForPixelSize(double pixelSize)
+{
+  double *nodeSpacing = this->GetSpacing();
+  int numberOfLevels = this->GetNumberOfPyramidLevels();
+  int selectedLevel = 0;
+  for (int level = 1; level < numberOfLevels; level++)
+    {
+    double spacing[3];
+    this->PyramidLevels[level - 1]->GetSpacing(spacing);
+    // the finest axis decides: the level must not lose detail along it
+    double voxelSize = VTK_DOUBLE_MAX;
+    for (int i = 0; i < 3; i++)
+      {
+      double size = fabs(nodeSpacing[i]) * spacing[i];
+      if (size < voxelSize)
+        {
+        voxelSize = size;
+        }
+      }
+    if (voxelSize > pixelSize)
+      {
+      break;
       }
+    selectedLevel = level;
     }
+  return selectedLevel;
 }
@@ -28,10 +28,20 @@
 
 // VTK includes
 #include <vtkDoubleArray.h>
+#include <vtkMultiThreader.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
 
 #include <vtkSlicerAstroVolumeModuleMRMLExport.h>
 
+class vtkFITSBrickCache;
+class vtkFITSHeader;
+class vtkFITSHistogram;
+class vtkMatrix4x4;
+class vtkSimpleCriticalSection;
 class vtkMRMLAstroVolumeDisplayNode;
 class vtkMRMLAstroLabelMapVolumeNode;
 
@@ -58,6 +68,11 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeNode : public vtkMRMLScalarVolumeN
   /// Copy the node's attributes to this object
   virtual void Copy(vtkMRMLNode *node);
 
+  ///
+  /// Set a name value pair attribute. Changing a "SlicerAstro."
+  /// attribute invalidates the header returned by GetAstroHeader.
+  virtual void SetAttribute(const char* name, const char* value);
+
   ///
   /// Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() {return "AstroVolume";};
@@ -79,12 +94,174 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeNode : public vtkMRMLScalarVolumeN
   virtual vtkMRMLAstroVolumeDisplayNode* GetAstroVolumeDisplayNode();
 
   ///
-  /// Update Max and Min Attributes
+  /// Update Max and Min Attributes. NaN voxels are ignored. The range is
+  /// cached against the MTime of the scalars: after writing the voxels
+  /// through the scalar pointer call Modified on the scalars.
   virtual void UpdateRangeAttributes();
 
   ///
-  /// Update Noise Attribute
-   virtual void UpdateNoiseAttributes();
+  /// Update Noise Attributes (RMS and NOISEMEAN). The noise is estimated
+  /// on a strided sample of the whole cube: median and MAD give a first
+  /// robust estimate which is then refined by sigma clipping, so that
+  /// the emission does not bias it. NaN voxels are ignored. The estimate
+  /// is cached against the MTime of the scalars.
+  virtual void UpdateNoiseAttributes();
+
+  ///
+  /// Robust noise of each plane (channel) of the cube: two components
+  /// per plane, the noise mean and RMS. Cached against the MTime of the
+  /// scalars. Returns NULL if the image data are not a cube.
+  vtkDoubleArray* GetNoiseSpectrum();
+
+  enum StatisticsComponents
+    {
+    StatisticsMinimum = 0,
+    StatisticsMaximum,
+    StatisticsMean,
+    StatisticsRMS,
+    StatisticsNaNCount,
+    NumberOfStatisticsComponents
+    };
+
+  ///
+  /// Statistics of each plane (channel) and of each row (Y index, over
+  /// all the planes) of the image data: one tuple of StatisticsComponents
+  /// (minimum, maximum, mean, RMS around the mean and number of NaN
+  /// voxels) per plane or row. The values of planes and rows made only
+  /// of NaN voxels are NaN. Both are computed in one parallel pass and
+  /// cached against the MTime of the scalars; the pass also updates the
+  /// cached range of UpdateRangeAttributes.
+  vtkDoubleArray* GetPlaneStatistics();
+  vtkDoubleArray* GetRowStatistics();
+
+  ///
+  /// Range of the planes [firstPlane, lastPlane] from the plane
+  /// statistics (lastPlane < 0 means the last plane). Returns false (and
+  /// range is not modified) if the planes contain only NaN voxels.
+  bool GetPlanesRange(int firstPlane, int lastPlane, double range[2]);
+
+  ///
+  /// Histogram of the voxels of the image data (NaN voxels excluded),
+  /// for quantile and "fraction of the voxels above a value" queries.
+  /// Built in one parallel pass and cached against the MTime of the
+  /// scalars. Returns NULL if there are no scalars.
+  vtkFITSHistogram* GetHistogram();
+
+  ///
+  /// Typed header parsed from the "SlicerAstro.*" attributes. The
+  /// attributes remain the serialized form of the header: the header is
+  /// parsed again only when a "SlicerAstro." attribute has been set (or
+  /// the node read or copied) since the last parse.
+  vtkFITSHeader* GetAstroHeader();
+
+  ///
+  /// Integer volumes loaded with their native data type store the values
+  /// of the FITS file: the physical value of a voxel is bscale * voxel + bzero.
+  /// The range and noise attributes (DATAMIN, DATAMAX, RMS and NOISEMEAN),
+  /// GetPlanesRange and GetHistogram are always physical values.
+  /// Returns true if such a scaling has to be applied.
+  bool GetDataScaling(double &bscale, double &bzero);
+
+  ///
+  /// Convert in place a range of voxel values into physical values and
+  /// back (the range stays sorted). Thresholds and transfer functions
+  /// derived from the physical attributes have to be converted into
+  /// voxel units before being applied to the image data.
+  void GetPhysicalRange(double range[2]);
+  void GetVoxelRange(double range[2]);
+  double GetVoxelValue(double value);
+
+  ///
+  /// Convert integer voxels into float physical values, applying
+  /// BSCALE and BZERO. BSCALE and BZERO are reset accordingly.
+  bool ApplyDataScaling();
+
+  ///
+  /// Out-of-core paging layer. For cubes larger than the memory the
+  /// image data of the node is a binned version of the cube, while the
+  /// full resolution voxels are paged in on demand from a bricked copy of
+  /// the cube (see vtkFITSBrickCache and
+  /// vtkMRMLAstroVolumeStorageNode::SetUseBrickCache).
+  /// The range attributes are then taken from the per-brick statistics.
+  void SetBrickCache(vtkFITSBrickCache* brickCache);
+  vtkFITSBrickCache* GetBrickCache();
+
+  ///
+  /// Copy in out the full resolution voxels of extent (IJK of the full
+  /// resolution cube) paging in the bricks that overlap it. out is set
+  /// to a float volume with the dimensions of extent.
+  /// Without brick cache the voxels are copied from the image data.
+  bool ReadFullResolutionExtent(const int extent[6], vtkImageData *out);
+
+  ///
+  /// Subsampling of the image data with respect to the cube of the brick
+  /// cache: voxel ijk of the image data is the voxel ijk * factor of the
+  /// full resolution cube. Default is 1 (not subsampled).
+  vtkSetVector3Macro(FullResolutionSubsampling,int);
+  vtkGetVector3Macro(FullResolutionSubsampling,int);
+
+  ///
+  /// True if the image data is a subsampled view of a brick cache:
+  /// it then can not replace the full resolution data of the file.
+  bool IsSubsampledFromBrickCache();
+
+  ///
+  /// Full resolution value of the voxel under the voxel ijk of the
+  /// (subsampled) image data, paged in from the brick cache.
+  /// Returns false if the image data is not subsampled from a brick cache.
+  bool GetFullResolutionValue(const double ijk[3], double &value);
+
+  ///
+  /// Multi-resolution pyramid of the image data. Level 0 is the image
+  /// data of the node, level n is level n - 1 downsampled by 2 along each
+  /// axis with more than one voxel (mean of the 2x2x2 voxels, blank voxels
+  /// are ignored). Levels are float and are added until all the axes have
+  /// less than 2 * minimumDimension voxels. The pyramid is dropped as soon
+  /// as the scalars of the image data are replaced or modified.
+  bool BuildPyramid(int minimumDimension = 32);
+
+  enum PyramidBuildStates
+    {
+    PyramidBuildIdle = 0,
+    PyramidBuildRunning,
+    PyramidBuildDone,
+    PyramidBuildCancelled
+    };
+
+  ///
+  /// Build the pyramid in a background thread. ProcessPyramidBuild has
+  /// to be polled from the main thread: it returns PyramidBuildRunning
+  /// until the levels are ready, and then attaches them to the node
+  /// (PyramidBuildDone). If the scalars have been modified meanwhile
+  /// the levels are discarded (PyramidBuildCancelled).
+  bool BuildPyramidAsync(int minimumDimension = 32);
+  int ProcessPyramidBuild();
+  void CancelPyramidBuild();
+
+  ///
+  /// Release the levels of the pyramid
+  void ClearPyramid();
+
+  ///
+  /// Number of levels, including level 0 (1 if no pyramid has been built)
+  int GetNumberOfPyramidLevels();
+
+  ///
+  /// Image data of a level. The spacing of the image data is the
+  /// downsampling factor along each axis and the origin is the position
+  /// of its first voxel in the IJK of level 0.
+  vtkImageData* GetPyramidLevel(int level);
+
+  ///
+  /// IJK to RAS matrix of a level
+  void GetPyramidLevelIJKToRASMatrix(int level, vtkMatrix4x4 *mat);
+
+  ///
+  /// Coarsest level whose voxels are not larger than pixelSize
+  /// (in the units of the spacing of the node, e.g. the size of a screen
+  /// pixel of a slice view in RAS). Views showing the volume zoomed out
+  /// can use this level instead of the full resolution data.
+  int GetPyramidLevelForPixelSize(double pixelSize);
 
 protected:
   vtkMRMLAstroVolumeNode();
@@ -92,6 +269,67 @@ protected:
 
   vtkMRMLAstroVolumeNode(const vtkMRMLAstroVolumeNode&);
   void operator=(const vtkMRMLAstroVolumeNode&);
+
+  static VTK_THREAD_RETURN_TYPE PyramidBuildThread(void *arg);
+
+  ///
+  /// Downsample input by 2 along the axes with more than one voxel.
+  /// The spacing and origin of a fullResolution input are ignored (IJK).
+  /// Returns NULL if cancelled is set while building.
+  static vtkImageData* DownsampleLevel(vtkImageData *input, bool fullResolution,
+                                       int *cancelled);
+
+  bool IsPyramidUpToDate();
+
+  ///
+  /// Compute the plane and row statistics if the scalars changed
+  bool UpdateStatistics();
+
+  ///
+  /// Compute the range of the scalars (NaN voxels excluded) if they
+  /// changed, without updating the attributes
+  bool ComputeRange();
+
+  vtkSmartPointer<vtkFITSBrickCache> BrickCache;
+  int FullResolutionSubsampling[3];
+
+  vtkSmartPointer<vtkFITSHeader> AstroHeader;
+  bool AstroHeaderModified;
+
+  vtkWeakPointer<vtkDataArray> RangeScalars;
+  unsigned long RangeScalarsMTime;
+  double Range[2];
+
+  vtkWeakPointer<vtkDataArray> NoiseScalars;
+  unsigned long NoiseScalarsMTime;
+  double NoiseMean;
+  double NoiseRMS;
+
+  vtkSmartPointer<vtkDoubleArray> NoiseSpectrum;
+  vtkWeakPointer<vtkDataArray> NoiseSpectrumScalars;
+  unsigned long NoiseSpectrumScalarsMTime;
+
+  vtkSmartPointer<vtkDoubleArray> PlaneStatistics;
+  vtkSmartPointer<vtkDoubleArray> RowStatistics;
+  vtkWeakPointer<vtkDataArray> StatisticsScalars;
+  unsigned long StatisticsScalarsMTime;
+
+  vtkSmartPointer<vtkFITSHistogram> Histogram;
+  vtkWeakPointer<vtkDataArray> HistogramScalars;
+  unsigned long HistogramScalarsMTime;
+
+  std::vector<vtkSmartPointer<vtkImageData> > PyramidLevels;
+  vtkWeakPointer<vtkDataArray> PyramidScalars;
+  unsigned long PyramidScalarsMTime;
+
+  vtkSmartPointer<vtkImageData> PyramidBuildInput;
+  std::vector<vtkSmartPointer<vtkImageData> > PyramidBuildLevels;
+  int PyramidBuildMinimumDimension;
+  vtkMultiThreader *PyramidBuildThreader;
+  vtkSimpleCriticalSection *PyramidBuildLock;
+  int PyramidBuildThreadID;
+  int PyramidBuildFinished;
+  int PyramidBuildCancelled;
 };
 
 #endif
@@ -24,20 +24,32 @@
 #include <vtkMRMLAstroVolumeNode.h>
 #include <vtkMRMLAstroVolumeStorageNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLStorableNode.h>
 #include <vtkMRMLVolumeNode.h>
 
 //vtkFits includes
+#include <vtkFITSBrickCache.h>
 #include <vtkFITSReader.h>
 #include <vtkFITSWriter.h>
 
 // VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkCriticalSection.h>
+#include <vtkDataArray.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkType.h>
+#include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <cmath>
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLAstroVolumeStorageNode);
@@ -46,12 +58,61 @@ vtkMRMLNodeNewMacro(vtkMRMLAstroVolumeStorageNode);
 vtkMRMLAstroVolumeStorageNode::vtkMRMLAstroVolumeStorageNode()
 {
   this->CenterImage = 2;
+  this->UseNativeDataType = 0;
+  this->Binning[0] = 1;
+  this->Binning[1] = 1;
+  this->Binning[2] = 1;
+  this->Subsample = 0;
+  this->UseBrickCache = 0;
+  this->BrickCacheMemoryBudget = 1024;
+  this->NumberOfReadThreads = 0;
+  this->ReadDeferred = 0;
   this->DefaultWriteFileExtension = "fits";
+  this->AsyncReader = NULL;
+  this->AsyncReadThreader = vtkMultiThreader::New();
+  this->AsyncReadLock = new vtkSimpleCriticalSection;
+  this->AsyncReadThreadID = -1;
+  this->AsyncReadFinished = 0;
+  this->AsyncReadCancelled = 0;
+  this->AsyncBrickCache = NULL;
+  for (int i = 0; i < 3; i++)
+    {
+    this->AsyncBrickCacheSubsampling[i] = 1;
+    }
+  this->WriteInBackground = 0;
+  this->AsyncWriter = NULL;
+  this->AsyncWriteScalars = NULL;
+  this->AsyncWriteLock = new vtkSimpleCriticalSection;
+  this->AsyncWriteThreadID = -1;
+  this->AsyncWriteFinished = 0;
+  this->AsyncWriteProgress = 0.;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLAstroVolumeStorageNode::~vtkMRMLAstroVolumeStorageNode()
 {
+  if (this->AsyncReader)
+    {
+    this->CancelAsyncRead();
+    this->AsyncReadThreader->TerminateThread(this->AsyncReadThreadID);
+    this->AsyncReader->Delete();
+    this->AsyncReader = NULL;
+    }
+  if (this->AsyncBrickCache)
+    {
+    this->AsyncBrickCache->Delete();
+    this->AsyncBrickCache = NULL;
+    }
+  // a write is never cancelled: wait for the file to be completed
+  if (this->AsyncWriter)
+    {
+    this->AsyncReadThreader->TerminateThread(this->AsyncWriteThreadID);
+    this->AsyncWriter->UnRegister(this);
+    this->AsyncWriter = NULL;
+    }
+  this->AsyncReadThreader->Delete();
+  delete this->AsyncReadLock;
+  delete this->AsyncWriteLock;
 }
 
 namespace
@@ -71,6 +132,29 @@ std::string DoubleToString(double Value)
 {
   return NumberToString<double>(Value);
 }
+
+//----------------------------------------------------------------------------
+template <typename T> T StringToNumber(const char* num)
+{
+  std::stringstream ss;
+  ss << num;
+  T result;
+  return ss >> result ? result : 0;
+}
+
+//----------------------------------------------------------------------------
+double StringToDouble(const char* str)
+{
+  return StringToNumber<double>(str);
+}
+
+//----------------------------------------------------------------------------
+// Size (in bytes) of the slabs written by the background writes
+const vtkIdType AsyncWriteSlabSize = 64 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+// see vtkMRMLAstroVolumeStorageNode::SetDeferReadsOnImport
+bool DeferReadsOnImport = false;
 }//end namespace
 
 //----------------------------------------------------------------------------
@@ -82,6 +166,12 @@ void vtkMRMLAstroVolumeStorageNode::WriteXML(ostream& of, int nIndent)
   std::stringstream ss;
   ss << this->CenterImage;
   of << indent << " centerImage=\"" << ss.str() << "\"";
+  of << indent << " useNativeDataType=\"" << this->UseNativeDataType << "\"";
+  of << indent << " binning=\"" << this->Binning[0] << " "
+     << this->Binning[1] << " " << this->Binning[2] << "\"";
+  of << indent << " subsample=\"" << this->Subsample << "\"";
+  of << indent << " useBrickCache=\"" << this->UseBrickCache << "\"";
+  of << indent << " brickCacheMemoryBudget=\"" << this->BrickCacheMemoryBudget << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -103,6 +193,36 @@ void vtkMRMLAstroVolumeStorageNode::ReadXMLAttributes(const char** atts)
       ss << attValue;
       ss >> this->CenterImage;
       }
+    else if (!strcmp(attName, "useNativeDataType"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->UseNativeDataType;
+      }
+    else if (!strcmp(attName, "binning"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->Binning[0] >> this->Binning[1] >> this->Binning[2];
+      }
+    else if (!strcmp(attName, "subsample"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->Subsample;
+      }
+    else if (!strcmp(attName, "useBrickCache"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->UseBrickCache;
+      }
+    else if (!strcmp(attName, "brickCacheMemoryBudget"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->BrickCacheMemoryBudget;
+      }
     }
 
   this->EndModify(disabledModify);
@@ -124,6 +244,13 @@ void vtkMRMLAstroVolumeStorageNode::Copy(vtkMRMLNode *anode)
   vtkMRMLAstroVolumeStorageNode *node = (vtkMRMLAstroVolumeStorageNode *) anode;
 
   this->SetCenterImage(node->CenterImage);
+  this->SetUseNativeDataType(node->UseNativeDataType);
+  this->SetBinning(node->Binning);
+  this->SetSubsample(node->Subsample);
+  this->SetUseBrickCache(node->UseBrickCache);
+  this->SetBrickCacheMemoryBudget(node->BrickCacheMemoryBudget);
+  this->SetNumberOfReadThreads(node->NumberOfReadThreads);
+  this->SetWriteInBackground(node->WriteInBackground);
 
   this->EndModify(disabledModify);
 }
@@ -133,6 +260,15 @@ void vtkMRMLAstroVolumeStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   vtkMRMLStorageNode::PrintSelf(os,indent);
   os << indent << "CenterImage:   " << this->CenterImage << "\n";
+  os << indent << "UseNativeDataType:   " << this->UseNativeDataType << "\n";
+  os << indent << "Binning:   " << this->Binning[0] << " "
+     << this->Binning[1] << " " << this->Binning[2] << "\n";
+  os << indent << "Subsample:   " << this->Subsample << "\n";
+  os << indent << "UseBrickCache:   " << this->UseBrickCache << "\n";
+  os << indent << "BrickCacheMemoryBudget:   " << this->BrickCacheMemoryBudget << "\n";
+  os << indent << "NumberOfReadThreads:   " << this->NumberOfReadThreads << "\n";
+  os << indent << "ReadDeferred:   " << this->ReadDeferred << "\n";
+  os << indent << "WriteInBackground:   " << this->WriteInBackground << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -145,30 +281,44 @@ bool vtkMRMLAstroVolumeStorageNode::CanReadInReferenceNode(vtkMRMLNode *refNode)
 //----------------------------------------------------------------------------
 int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 {
-  vtkMRMLAstroVolumeNode *volNode = NULL;
-  vtkMRMLAstroLabelMapVolumeNode *labvolNode = NULL;
-  vtkMRMLAstroVolumeDisplayNode *disNode = NULL;
-  vtkMRMLAstroLabelMapVolumeDisplayNode *labdisNode = NULL;
+  // scene restore: the data are read concurrently after the import
+  if (DeferReadsOnImport && this->GetScene() && this->GetScene()->IsImporting() &&
+      refNode->GetScene() == this->GetScene())
+    {
+    this->ReadDeferred = 1;
+    return 1;
+    }
+  this->ReadDeferred = 0;
 
-  if ( refNode->IsA("vtkMRMLAstroVolumeNode") )
+  vtkNew<vtkFITSReader> reader;
+  if (!this->ConfigureReader(reader.GetPointer(), refNode))
     {
-    volNode = vtkMRMLAstroVolumeNode::SafeDownCast(refNode);
-    disNode = volNode->GetAstroVolumeDisplayNode();
+    return 0;
     }
-  else if ( refNode->IsA("vtkMRMLAstroLabelMapVolumeNode") )
+  this->SetupBrickCache(reader.GetPointer(), refNode);
+
+  vtkMRMLVolumeNode *volumeNode = vtkMRMLVolumeNode::SafeDownCast(refNode);
+  if (volumeNode->GetImageData())
     {
-    labvolNode = vtkMRMLAstroLabelMapVolumeNode::SafeDownCast(refNode);
-    labdisNode = labvolNode->GetAstroLabelMapVolumeDisplayNode();
+    volumeNode->SetAndObserveImageData (NULL);
     }
-  else
+
+  reader->Update();
+
+  return this->SetReaderOutputInNode(reader.GetPointer(), refNode);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeStorageNode::ConfigureReader(vtkFITSReader *reader, vtkMRMLNode *refNode)
+{
+  if (!refNode->IsA("vtkMRMLAstroVolumeNode") &&
+      !refNode->IsA("vtkMRMLAstroLabelMapVolumeNode"))
     {
-    vtkErrorMacro(<< "vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
+    vtkErrorMacro(<< "vtkMRMLAstroVolumeStorageNode::ConfigureReader : "
                      "Do not recognize node type " << refNode->GetClassName());
-    return 0;
+    return false;
     }
 
-  vtkNew<vtkFITSReader> reader;
-
   // Set Reader member variables
   if (this->CenterImage)
     {
@@ -178,28 +328,17 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     {
     reader->SetUseNativeOriginOn();
     }
-
-  if ( refNode->IsA("vtkMRMLAstroVolumeNode") )
-    {
-    if (volNode->GetImageData())
-      {
-      volNode->SetAndObserveImageData (NULL);
-      }
-    }
-  else if ( refNode->IsA("vtkMRMLAstroLabelMapVolumeNode") )
-    {
-    if (labvolNode->GetImageData())
-      {
-      labvolNode->SetAndObserveImageData (NULL);
-      }
-    }
+  reader->SetUseNativeDataType(this->UseNativeDataType && !this->UseBrickCache);
+  reader->SetBinning(this->Binning);
+  reader->SetSubsample(this->Subsample);
+  reader->SetNumberOfThreads(this->NumberOfReadThreads);
 
   std::string fullName = this->GetFullNameFromFileName();
 
   if (fullName.empty())
     {
-    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : File name not specified");
-    return 0;
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ConfigureReader : File name not specified");
+    return false;
     }
 
   reader->SetFileName(fullName.c_str());
@@ -207,8 +346,8 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   // Check if this is a FITS file that we can read
   if (!reader->CanReadFile(fullName.c_str()))
     {
-    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : This is not a fits file");
-    return 0;
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ConfigureReader : This is not a fits file");
+    return false;
     }
 
   // Read the header to see if the file corresponds to the MRML Node
@@ -219,12 +358,134 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     if (reader->GetPointDataType() != vtkDataSetAttributes::SCALARS &&
          reader->GetNumberOfComponents() > 1 )
       {
-      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : MRMLVolumeNode does not match file kind");
-      return 0;
+      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ConfigureReader : MRMLVolumeNode does not match file kind");
+      return false;
       }
     }
 
-  reader->Update();
+  // Westerbork units are converted to Jy/beam by the reader while decoding
+  // (native integer voxels are left untouched, see SetReaderOutputInNode)
+  if (refNode->IsA("vtkMRMLAstroVolumeNode") &&
+      !strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U.") &&
+      (reader->GetDataType() == VTK_FLOAT || reader->GetDataType() == VTK_DOUBLE))
+    {
+    reader->SetDataScale(0.005);
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::SetupBrickCache(vtkFITSReader *reader, vtkMRMLNode *refNode)
+{
+  if (!vtkMRMLAstroVolumeNode::SafeDownCast(refNode))
+    {
+    return;
+    }
+
+  int subsampling[3] = {1, 1, 1};
+  vtkFITSBrickCache *brickCache = this->UseBrickCache ?
+    this->OpenBrickCache(reader, this->GetFullNameFromFileName(), subsampling) : NULL;
+  this->SetBrickCacheInNode(brickCache, subsampling, refNode);
+  if (brickCache)
+    {
+    brickCache->Delete();
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkFITSBrickCache* vtkMRMLAstroVolumeStorageNode::OpenBrickCache(vtkFITSReader *reader,
+                                                                const std::string &fileName,
+                                                                int subsampling[3])
+{
+  subsampling[0] = subsampling[1] = subsampling[2] = 1;
+
+  std::string sidecarName = vtkFITSBrickCache::GetSidecarFileName(fileName.c_str());
+  vtkFITSBrickCache *brickCache = vtkFITSBrickCache::New();
+  brickCache->SetMemoryBudget(this->BrickCacheMemoryBudget);
+  if (!brickCache->Open(sidecarName.c_str(), fileName.c_str()))
+    {
+    // first load: write the bricks streaming the full resolution cube
+    vtkNew<vtkFITSReader> brickReader;
+    brickReader->SetFileName(fileName.c_str());
+    brickReader->SetDataScale(reader->GetDataScale());
+    if (!brickCache->Build(brickReader.GetPointer(), sidecarName.c_str()) ||
+        !brickCache->Open(sidecarName.c_str(), fileName.c_str()))
+      {
+      vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::OpenBrickCache : "
+                      "could not write the brick cache "<<sidecarName<<
+                      ", the volume is loaded in memory.");
+      brickCache->Delete();
+      return NULL;
+      }
+    }
+
+  // the image data of the node is subsampled (not averaged, to keep the
+  // noise of the voxels) to fit in the memory budget
+  int *dims = brickCache->GetDimensions();
+  const double size = (double) dims[0] * dims[1] * dims[2] * sizeof(float);
+  const double budget = this->BrickCacheMemoryBudget * 1024. * 1024.;
+  if (size > budget)
+    {
+    const int bin = static_cast<int>(ceil(pow(size / budget, 1. / 3.)));
+    for (int i = 0; i < 3; i++)
+      {
+      subsampling[i] = std::max(this->Binning[i], bin);
+      }
+    reader->SetBinning(subsampling);
+    reader->SubsampleOn();
+    reader->UpdateInformation();
+    }
+
+  return brickCache;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::SetBrickCacheInNode(vtkFITSBrickCache *brickCache,
+                                                        const int subsampling[3],
+                                                        vtkMRMLNode *refNode)
+{
+  vtkMRMLAstroVolumeNode *volNode = vtkMRMLAstroVolumeNode::SafeDownCast(refNode);
+  if (!volNode)
+    {
+    return;
+    }
+
+  volNode->SetBrickCache(brickCache);
+  if (brickCache)
+    {
+    volNode->SetFullResolutionSubsampling(subsampling[0], subsampling[1], subsampling[2]);
+    }
+  else
+    {
+    volNode->SetFullResolutionSubsampling(1, 1, 1);
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::SetReaderOutputInNode(vtkFITSReader *reader, vtkMRMLNode *refNode)
+{
+  vtkMRMLAstroVolumeNode *volNode = NULL;
+  vtkMRMLAstroLabelMapVolumeNode *labvolNode = NULL;
+  vtkMRMLAstroVolumeDisplayNode *disNode = NULL;
+  vtkMRMLAstroLabelMapVolumeDisplayNode *labdisNode = NULL;
+
+  if ( refNode->IsA("vtkMRMLAstroVolumeNode") )
+    {
+    volNode = vtkMRMLAstroVolumeNode::SafeDownCast(refNode);
+    disNode = volNode->GetAstroVolumeDisplayNode();
+    }
+  else if ( refNode->IsA("vtkMRMLAstroLabelMapVolumeNode") )
+    {
+    labvolNode = vtkMRMLAstroLabelMapVolumeNode::SafeDownCast(refNode);
+    labdisNode = labvolNode->GetAstroLabelMapVolumeDisplayNode();
+    }
+  else
+    {
+    vtkErrorMacro(<< "vtkMRMLAstroVolumeStorageNode::SetReaderOutputInNode : "
+                     "Do not recognize node type " << refNode->GetClassName());
+    return 0;
+    }
 
   if ( refNode->IsA("vtkMRMLAstroVolumeNode") )
     {
@@ -260,48 +521,22 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
       {
       volNode->SetAttribute("SlicerAstro.BUNIT", "JY/BEAM");
-      vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : the flux unit of Volume "<<volNode->GetName()<<
+      vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::SetReaderOutputInNode : the flux unit of Volume "<<volNode->GetName()<<
                       " is in Westerbork Unit. It will be automatically converted in JY/BEAM"<<endl);
       }
 
-    // rescaling flux
-    if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
+    // rescaling flux: float data have been rescaled by the reader
+    // (see ConfigureReader), native integer data rescale BSCALE and BZERO
+    int vtkType = reader->GetDataType();
+    if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U.") &&
+        (vtkType == VTK_UNSIGNED_CHAR || vtkType == VTK_SHORT || vtkType == VTK_INT))
       {
-      vtkImageData *imageData = reader->GetOutput();
-      int vtkType = reader->GetDataType();
-      int *dims = imageData->GetDimensions();
-      const int numComponents = imageData->GetNumberOfScalarComponents();
-      const int numElements = dims[0] * dims[1] * dims[2] * numComponents;
-      switch (vtkType)
-        {
-        case VTK_DOUBLE:
-          double *dPixel;
-          dPixel = static_cast<double*>(imageData->GetScalarPointer(0,0,0));
-
-          if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
-            {
-            for( int elemCnt = 0; elemCnt < numElements; elemCnt++)
-              {
-              *(dPixel+elemCnt) *= 0.005;
-              }
-            }
-          break;
-        case VTK_FLOAT:
-          float *fPixel;
-          fPixel = static_cast<float*>(imageData->GetScalarPointer(0,0,0));
-          if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
-            {
-            for( int elemCnt = 0; elemCnt < numElements; elemCnt++)
-              {
-              *(fPixel+elemCnt) *= 0.005;
-              }
-            }
-          break;
-        default:
-          vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal :"
-                        "Could not get the data pointer. DataType not allowed.");
-          return 0;
-        }
+      double bscale = reader->GetHeaderValue("SlicerAstro.BSCALE") ?
+        StringToDouble(reader->GetHeaderValue("SlicerAstro.BSCALE")) : 1.;
+      double bzero = reader->GetHeaderValue("SlicerAstro.BZERO") ?
+        StringToDouble(reader->GetHeaderValue("SlicerAstro.BZERO")) : 0.;
+      volNode->SetAttribute("SlicerAstro.BSCALE", DoubleToString(bscale * 0.005).c_str());
+      volNode->SetAttribute("SlicerAstro.BZERO", DoubleToString(bzero * 0.005).c_str());
       }
     }
   else if ( refNode->IsA("vtkMRMLAstroLabelMapVolumeNode") )
@@ -348,12 +583,17 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   if ( refNode->IsA("vtkMRMLAstroVolumeNode") )
     {
     volNode->SetImageDataConnection(ici->GetOutputPort());
-    if(!strcmp(reader->GetHeaderValue("SlicerAstro.DATAMAX"), "0.") ||
+    // the range and noise attributes are physical values: for scaled
+    // native integer volumes the keywords of the file can be in other
+    // units (W.U., see above), compute them from the voxels.
+    double bscale, bzero;
+    bool scaled = volNode->GetDataScaling(bscale, bzero);
+    if(scaled || !strcmp(reader->GetHeaderValue("SlicerAstro.DATAMAX"), "0.") ||
            !strcmp(reader->GetHeaderValue("SlicerAstro.DATAMIN"), "0."))
       {
       volNode->UpdateRangeAttributes();
       }
-    if (!strcmp(reader->GetHeaderValue("SlicerAstro.RMS"), "0."))
+    if (scaled || !strcmp(reader->GetHeaderValue("SlicerAstro.RMS"), "0."))
       {
       volNode->UpdateNoiseAttributes();
       }
@@ -378,6 +618,192 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   return 1;
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::SetDeferReadsOnImport(bool defer)
+{
+  DeferReadsOnImport = defer;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeStorageNode::GetDeferReadsOnImport()
+{
+  return DeferReadsOnImport;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::ReadDataAsync(vtkMRMLNode *refNode)
+{
+  if (this->AsyncReader)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataAsync : "
+                  "an asynchronous read is already running.");
+    return 0;
+    }
+
+  if (!refNode || !refNode->GetID() || !this->GetScene())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataAsync : "
+                  "the node has to be in the scene.");
+    return 0;
+    }
+
+  vtkFITSReader *reader = vtkFITSReader::New();
+  if (!this->ConfigureReader(reader, refNode))
+    {
+    reader->Delete();
+    return 0;
+    }
+
+  // the brick cache is opened (and built on the first load) by the
+  // reading thread, and attached to the node by ProcessAsyncRead
+  this->ReadDeferred = 0;
+  this->AsyncReader = reader;
+  this->AsyncReadNodeID = refNode->GetID();
+  this->AsyncReadFileName = this->UseBrickCache &&
+    vtkMRMLAstroVolumeNode::SafeDownCast(refNode) ? this->GetFullNameFromFileName() : "";
+  this->AsyncReadFinished = 0;
+  this->AsyncReadCancelled = 0;
+  this->AsyncReadThreadID = this->AsyncReadThreader->SpawnThread
+    (&vtkMRMLAstroVolumeStorageNode::AsyncReadThread, this);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkMRMLAstroVolumeStorageNode::AsyncReadThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkMRMLAstroVolumeStorageNode *self =
+    static_cast<vtkMRMLAstroVolumeStorageNode*>(info->UserData);
+
+  // only this thread touches the reader until AsyncReadFinished is set
+  self->AsyncReadLock->Lock();
+  int cancelled = self->AsyncReadCancelled;
+  self->AsyncReadLock->Unlock();
+  if (!cancelled && !self->AsyncReadFileName.empty())
+    {
+    self->AsyncBrickCache = self->OpenBrickCache
+      (self->AsyncReader, self->AsyncReadFileName, self->AsyncBrickCacheSubsampling);
+    }
+
+  self->AsyncReadLock->Lock();
+  cancelled = self->AsyncReadCancelled;
+  self->AsyncReadLock->Unlock();
+  if (!cancelled)
+    {
+    self->AsyncReader->Update();
+    }
+
+  self->AsyncReadLock->Lock();
+  self->AsyncReadFinished = 1;
+  self->AsyncReadLock->Unlock();
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::ProcessAsyncRead()
+{
+  if (!this->AsyncReader)
+    {
+    return AsyncReadIdle;
+    }
+
+  this->AsyncReadLock->Lock();
+  int finished = this->AsyncReadFinished;
+  int cancelled = this->AsyncReadCancelled;
+  this->AsyncReadLock->Unlock();
+
+  if (!finished)
+    {
+    double progress = this->GetAsyncReadProgress();
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    return AsyncReadRunning;
+    }
+
+  this->AsyncReadThreader->TerminateThread(this->AsyncReadThreadID);
+  this->AsyncReadThreadID = -1;
+
+  int state = AsyncReadDone;
+  vtkMRMLNode *refNode = this->GetScene() ?
+    this->GetScene()->GetNodeByID(this->AsyncReadNodeID.c_str()) : NULL;
+  vtkImageData *output = this->AsyncReader->GetOutput();
+  if (cancelled)
+    {
+    state = AsyncReadCancelled;
+    }
+  else if (!refNode || this->AsyncReader->GetReadStatus() ||
+           !output || !output->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ProcessAsyncRead : "
+                  "failed to read "<<this->GetFullNameFromFileName());
+    state = AsyncReadFailed;
+    }
+  else
+    {
+    this->SetBrickCacheInNode(this->AsyncBrickCache, this->AsyncBrickCacheSubsampling, refNode);
+    if (!this->SetReaderOutputInNode(this->AsyncReader, refNode))
+      {
+      state = AsyncReadFailed;
+      }
+    }
+
+  this->AsyncReader->Delete();
+  this->AsyncReader = NULL;
+  this->AsyncReadNodeID.clear();
+  this->AsyncReadFileName.clear();
+  if (this->AsyncBrickCache)
+    {
+    this->AsyncBrickCache->Delete();
+    this->AsyncBrickCache = NULL;
+    }
+
+  if (state == AsyncReadDone)
+    {
+    double progress = 1.;
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    }
+
+  return state;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::CancelAsyncRead()
+{
+  if (!this->AsyncReader)
+    {
+    return;
+    }
+
+  this->AsyncReadLock->Lock();
+  this->AsyncReadCancelled = 1;
+  this->AsyncReadLock->Unlock();
+  // AbortExecute belongs to the reading thread: use the locked abort
+  this->AsyncReader->AbortRead();
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeStorageNode::GetAsyncReadProgress()
+{
+  // Progress is written by the reading thread: use the locked copy
+  return this->AsyncReader ? this->AsyncReader->GetReadProgress() : 0.;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeStorageNode::IsAsyncReadRunning()
+{
+  if (!this->AsyncReader)
+    {
+    return false;
+    }
+
+  this->AsyncReadLock->Lock();
+  int finished = this->AsyncReadFinished;
+  this->AsyncReadLock->Unlock();
+
+  return !finished;
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
 {
@@ -408,6 +834,13 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     {
     vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WriteDataInternal :"
                   " Cannot write NULL ImageData");
+    return 0;
+    }
+
+  // one background write at a time per storage node
+  if (this->AsyncWriter)
+    {
+    this->WaitForAsyncWrite();
     }
 
   std::string fullName = this->GetFullNameFromFileName();
@@ -418,11 +851,28 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
+  vtkMRMLAstroVolumeNode *astroVolNode = vtkMRMLAstroVolumeNode::SafeDownCast(refNode);
+  if (astroVolNode && astroVolNode->IsSubsampledFromBrickCache())
+    {
+    // the subsampled image data must not replace the full resolution cube
+    if (vtksys::SystemTools::SameFile(fullName, astroVolNode->GetBrickCache()->GetFITSFileName()))
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WriteDataInternal : "<<volNode->GetName()<<
+                    " is a subsampled view of "<<fullName<<" (paged from a brick cache):"
+                    " it can not be written over the full resolution file.");
+      return 0;
+      }
+    vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::WriteDataInternal : "<<volNode->GetName()<<
+                    " is paged from a brick cache: the in memory (subsampled) data are written.");
+    }
+
   // Use here the FITS Writer
-  vtkNew<vtkFITSWriter> writer;
+  vtkSmartPointer<vtkFITSWriter> writer = vtkSmartPointer<vtkFITSWriter>::New();
   writer->SetFileName(fullName.c_str());
-  writer->SetInputConnection(volNode->GetImageDataConnection());
-  writer->SetUseCompression(0);
+  // .fz files are written as Rice tile compressed HDUs (fpack format)
+  std::string extension = vtksys::SystemTools::LowerCase(
+    vtksys::SystemTools::GetFilenameLastExtension(fullName));
+  writer->SetUseCompression(extension == ".fz" ? 1 : 0);
 
   // pass down all MRML attributes
   std::vector<std::string> attributeNames = volNode->GetAttributeNames();
@@ -432,6 +882,66 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     writer->SetAttribute((*ait), volNode->GetAttribute((*ait).c_str()));
     }
 
+  // label maps with labels in [0, 255] are written with BITPIX = 8
+  // (half of the size of a BITPIX = 16 file and they are read back as
+  // unsigned char).
+  const char* dataType = volNode->GetAttribute("SlicerAstro.DATATYPE");
+  vtkDataArray* scalars = volNode->GetImageData()->GetPointData() ?
+    volNode->GetImageData()->GetPointData()->GetScalars() : NULL;
+  if (dataType && !strcmp(dataType, "MASK") && scalars &&
+      scalars->GetNumberOfComponents() == 1)
+    {
+    double range[2] = {0., 0.};
+    scalars->GetRange(range);
+    if (scalars->GetDataType() == VTK_UNSIGNED_CHAR ||
+        ((scalars->GetDataType() == VTK_SHORT || scalars->GetDataType() == VTK_INT) &&
+         range[0] >= VTK_UNSIGNED_CHAR_MIN && range[1] <= VTK_UNSIGNED_CHAR_MAX))
+      {
+      writer->SetImageDataType(VTK_UNSIGNED_CHAR);
+      writer->SetAttribute("SlicerAstro.BITPIX", "8");
+      }
+    }
+
+  if (this->WriteInBackground)
+    {
+    // the worker thread writes the image data through its own pipeline.
+    // The snapshot is a pin, not a copy: the worker thread keeps the
+    // scalars of the node alive and reads them while the node can replace
+    // its image data (or be saved again). In place changes of the voxels
+    // have to detach the node from the write first
+    // (DetachFromBackgroundWrite copies the scalars on write).
+    vtkImageData *imageData = volNode->GetImageData();
+    vtkNew<vtkImageData> pinned;
+    pinned->ShallowCopy(imageData);
+    writer->SetInputData(pinned.GetPointer());
+    this->AsyncWriteScalars = pinned->GetPointData() ?
+      pinned->GetPointData()->GetScalars() : NULL;
+
+    // write in slabs of about 64 MB, reporting the progress
+    vtkIdType planeSize = static_cast<vtkIdType>(imageData->GetDimensions()[0]) *
+      imageData->GetDimensions()[1] * imageData->GetScalarSize() *
+      imageData->GetNumberOfScalarComponents();
+    writer->SetSlabPlanes(static_cast<int>(std::max<vtkIdType>
+      (1, AsyncWriteSlabSize / std::max<vtkIdType>(planeSize, 1))));
+
+    // the progress of the algorithm is set by the worker thread:
+    // it is read through AsyncWriteProgress, under AsyncWriteLock
+    vtkNew<vtkCallbackCommand> progressCommand;
+    progressCommand->SetCallback(&vtkMRMLAstroVolumeStorageNode::AsyncWriteProgressCallback);
+    progressCommand->SetClientData(this);
+    writer->AddObserver(vtkCommand::ProgressEvent, progressCommand.GetPointer());
+
+    this->AsyncWriter = writer;
+    this->AsyncWriter->Register(this);
+    this->AsyncWriteNodeID = refNode->GetID() ? refNode->GetID() : "";
+    this->AsyncWriteFinished = 0;
+    this->AsyncWriteProgress = 0.;
+    this->AsyncWriteThreadID = this->AsyncReadThreader->SpawnThread
+      (&vtkMRMLAstroVolumeStorageNode::AsyncWriteThread, this);
+    return 1;
+    }
+
+  writer->SetInputConnection(volNode->GetImageDataConnection());
   writer->Write();
   int writeFlag = 1;
   if (writer->GetWriteError())
@@ -446,16 +956,203 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
   return writeFlag;
 }
 
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkMRMLAstroVolumeStorageNode::AsyncWriteThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkMRMLAstroVolumeStorageNode *self =
+    static_cast<vtkMRMLAstroVolumeStorageNode*>(info->UserData);
+
+  // only this thread touches the writer until AsyncWriteFinished is set
+  self->AsyncWriter->Write();
+
+  self->AsyncWriteLock->Lock();
+  self->AsyncWriteFinished = 1;
+  self->AsyncWriteLock->Unlock();
+
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::AsyncWriteProgressCallback(vtkObject *vtkNotUsed(caller),
+                                                               unsigned long vtkNotUsed(eid),
+                                                               void *clientData,
+                                                               void *callData)
+{
+  vtkMRMLAstroVolumeStorageNode *self =
+    static_cast<vtkMRMLAstroVolumeStorageNode*>(clientData);
+  if (!self || !callData)
+    {
+    return;
+    }
+
+  self->AsyncWriteLock->Lock();
+  self->AsyncWriteProgress = *static_cast<double*>(callData);
+  self->AsyncWriteLock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::ProcessAsyncWrite()
+{
+  if (!this->AsyncWriter)
+    {
+    return AsyncWriteIdle;
+    }
+
+  if (this->IsAsyncWriteRunning())
+    {
+    double progress = this->GetAsyncWriteProgress();
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    return AsyncWriteRunning;
+    }
+
+  if (this->AsyncWriteThreadID >= 0)
+    {
+    this->AsyncReadThreader->TerminateThread(this->AsyncWriteThreadID);
+    this->AsyncWriteThreadID = -1;
+    }
+
+  int state = AsyncWriteDone;
+  if (this->AsyncWriter->GetWriteError())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ProcessAsyncWrite : "
+                  "ERROR writing FITS file " << (this->AsyncWriter->GetFileName() == NULL ?
+                  "null" : this->AsyncWriter->GetFileName()));
+    state = AsyncWriteFailed;
+    }
+
+  vtkMRMLNode *refNode = this->GetScene() && !this->AsyncWriteNodeID.empty() ?
+    this->GetScene()->GetNodeByID(this->AsyncWriteNodeID.c_str()) : NULL;
+  if (refNode && state == AsyncWriteDone)
+    {
+    this->StageWriteData(refNode);
+    }
+  vtkMRMLStorableNode *storableNode = vtkMRMLStorableNode::SafeDownCast(refNode);
+  if (storableNode && state == AsyncWriteFailed)
+    {
+    // WriteData has returned success when the write started:
+    // the node has still to be saved
+    storableNode->StorableModified();
+    }
+
+  this->AsyncWriter->UnRegister(this);
+  this->AsyncWriter = NULL;
+  this->AsyncWriteScalars = NULL;
+  this->AsyncWriteNodeID.clear();
+
+  if (state == AsyncWriteDone)
+    {
+    double progress = 1.;
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    }
+  this->InvokeEvent(AsyncWriteFinishedEvent, &state);
+
+  return state;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::WaitForAsyncWrite()
+{
+  if (!this->AsyncWriter)
+    {
+    return AsyncWriteIdle;
+    }
+
+  // joins the worker thread
+  this->AsyncReadThreader->TerminateThread(this->AsyncWriteThreadID);
+  this->AsyncWriteThreadID = -1;
+  this->AsyncWriteLock->Lock();
+  this->AsyncWriteFinished = 1;
+  this->AsyncWriteLock->Unlock();
+
+  return this->ProcessAsyncWrite();
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeStorageNode::GetAsyncWriteProgress()
+{
+  if (!this->AsyncWriter)
+    {
+    return 0.;
+    }
+
+  this->AsyncWriteLock->Lock();
+  double progress = this->AsyncWriteProgress;
+  this->AsyncWriteLock->Unlock();
+
+  return progress;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeStorageNode::IsAsyncWriteRunning()
+{
+  if (!this->AsyncWriter)
+    {
+    return false;
+    }
+
+  this->AsyncWriteLock->Lock();
+  int finished = this->AsyncWriteFinished;
+  this->AsyncWriteLock->Unlock();
+
+  return !finished;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(vtkMRMLVolumeNode *volumeNode)
+{
+  vtkMRMLAstroVolumeStorageNode *storageNode = volumeNode ?
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(volumeNode->GetStorageNode()) : NULL;
+  if (storageNode && storageNode->AsyncWriter)
+    {
+    storageNode->WaitForAsyncWrite();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeStorageNode::DetachFromBackgroundWrite(vtkMRMLVolumeNode *volumeNode)
+{
+  vtkMRMLAstroVolumeStorageNode *storageNode = volumeNode ?
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(volumeNode->GetStorageNode()) : NULL;
+  if (!storageNode || !storageNode->AsyncWriter)
+    {
+    return;
+    }
+  if (!storageNode->IsAsyncWriteRunning())
+    {
+    storageNode->ProcessAsyncWrite();
+    return;
+    }
+
+  vtkImageData *imageData = volumeNode->GetImageData();
+  vtkDataArray *scalars = imageData && imageData->GetPointData() ?
+    imageData->GetPointData()->GetScalars() : NULL;
+  if (!scalars || scalars != storageNode->AsyncWriteScalars)
+    {
+    return;
+    }
+
+  // the worker thread only reads the pinned scalars:
+  // they can be copied meanwhile
+  vtkSmartPointer<vtkDataArray> copy =
+    vtkSmartPointer<vtkDataArray>::Take(scalars->NewInstance());
+  copy->DeepCopy(scalars);
+  copy->SetName(scalars->GetName());
+  imageData->GetPointData()->SetScalars(copy);
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeStorageNode::InitializeSupportedReadFileTypes()
 {
   this->SupportedReadFileTypes->InsertNextValue("FITS (.fits)");
+  this->SupportedReadFileTypes->InsertNextValue("FITS tile compressed (.fits.fz)");
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeStorageNode::InitializeSupportedWriteFileTypes()
 {
   this->SupportedWriteFileTypes->InsertNextValue("FITS (.fits)");
+  this->SupportedWriteFileTypes->InsertNextValue("FITS tile compressed (.fits.fz)");
 }
 
 //----------------------------------------------------------------------------
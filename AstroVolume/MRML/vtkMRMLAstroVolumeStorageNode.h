@@ -22,8 +22,22 @@
 
 #include "vtkMRMLStorageNode.h"
 
+// VTK includes
+#include <vtkMultiThreader.h>
+
+// STD includes
+#include <string>
+
 #include <vtkSlicerAstroVolumeModuleMRMLExport.h>
 
+class vtkDataArray;
+class vtkFITSBrickCache;
+class vtkFITSReader;
+class vtkFITSWriter;
+class vtkMRMLVolumeNode;
+class vtkObject;
+class vtkSimpleCriticalSection;
+
 /// \brief MRML node for representing a volume storage.
 ///
 /// vtkMRMLAstroVolumeStorageNode nodes describe the archetybe based volume storage
@@ -58,9 +72,160 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeStorageNode : public vtkMRMLStorag
   vtkGetMacro(CenterImage, int);
   vtkSetMacro(CenterImage, int);
 
+  ///
+  /// Keep integer FITS data in their native type on read
+  /// (see vtkFITSReader::SetUseNativeDataType)
+  vtkGetMacro(UseNativeDataType, int);
+  vtkSetMacro(UseNativeDataType, int);
+
+  ///
+  /// Bin the FITS data by these factors along X, Y and Z on read
+  /// (see vtkFITSReader::SetBinning). Default is (1, 1, 1).
+  vtkGetVector3Macro(Binning, int);
+  vtkSetVector3Macro(Binning, int);
+
+  ///
+  /// Subsample instead of averaging the bins on read
+  /// (see vtkFITSReader::SetSubsample)
+  vtkGetMacro(Subsample, int);
+  vtkSetMacro(Subsample, int);
+
+  ///
+  /// Out-of-core mode for cubes larger than the memory. A bricked copy of
+  /// the cube (<file>.bricks, see vtkFITSBrickCache) is written on the
+  /// first load and reused afterwards. The node pages the full resolution
+  /// bricks in under BrickCacheMemoryBudget (in MB, default 1024), while
+  /// its image data is a subsampled version of the cube that fits in the
+  /// budget. Integer data are converted to float. Default is off.
+  /// The bricks are built in the reading thread for asynchronous reads.
+  /// The data probe shows the full resolution values; a subsampled
+  /// volume can not be written over its full resolution file.
+  vtkGetMacro(UseBrickCache, int);
+  vtkSetMacro(UseBrickCache, int);
+  vtkBooleanMacro(UseBrickCache, int);
+  vtkGetMacro(BrickCacheMemoryBudget, int);
+  vtkSetMacro(BrickCacheMemoryBudget, int);
+
+  ///
+  /// Number of threads used to decode the data on read
+  /// (see vtkFITSReader::SetNumberOfThreads). 0 (default) uses all the
+  /// processors: lower it when several files are read concurrently.
+  vtkGetMacro(NumberOfReadThreads, int);
+  vtkSetMacro(NumberOfReadThreads, int);
+
   /// Return true if the node can be read in.
   virtual bool CanReadInReferenceNode(vtkMRMLNode *refNode);
 
+  enum AsyncReadStates
+    {
+    AsyncReadIdle = 0,
+    AsyncReadRunning,
+    AsyncReadDone,
+    AsyncReadCancelled,
+    AsyncReadFailed
+    };
+
+  ///
+  /// Read the data of refNode (which has to be in the scene) on a worker
+  /// thread. The header is parsed here, the voxels are read and decoded
+  /// in the background: the current image data of refNode are kept
+  /// until the read is completed. Returns 0 if the read can not start.
+  int ReadDataAsync(vtkMRMLNode *refNode);
+
+  ///
+  /// When on, the storage nodes of this class do not read the data during
+  /// a scene import (scene restore): ReadData only sets ReadDeferred, so
+  /// that the application reads the deferred volumes of the scene
+  /// concurrently once the import ends. qSlicerAstroVolumeReader turns it
+  /// on for a single import only (see setDeferSceneReads).
+  /// Default is off.
+  static void SetDeferReadsOnImport(bool defer);
+  static bool GetDeferReadsOnImport();
+  vtkGetMacro(ReadDeferred, int);
+  vtkSetMacro(ReadDeferred, int);
+
+  ///
+  /// Poll the asynchronous read. It has to be called periodically from
+  /// the main thread: while the read is running it invokes
+  /// vtkCommand::ProgressEvent (call data is the progress, 0 to 1),
+  /// once the read is over it sets the data in the node and returns
+  /// AsyncReadDone (or AsyncReadCancelled, AsyncReadFailed).
+  int ProcessAsyncRead();
+
+  ///
+  /// Stop the asynchronous read. ProcessAsyncRead then returns
+  /// AsyncReadCancelled and the node is left untouched.
+  void CancelAsyncRead();
+
+  ///
+  /// Progress (0 to 1) of the asynchronous read
+  double GetAsyncReadProgress();
+
+  ///
+  /// True while the worker thread of the asynchronous read is reading.
+  /// A finished read is attached to the node by ProcessAsyncRead.
+  bool IsAsyncReadRunning();
+
+  ///
+  /// Write the data on a worker thread. WriteData returns once the header
+  /// is set up and the write is started: the image data are not copied,
+  /// the worker thread pins the scalars of the node. The node can replace
+  /// its image data meanwhile, code changing the voxels in place has to
+  /// call DetachFromBackgroundWrite (or WaitForBackgroundWrite) first.
+  /// The file is written slab by slab, so
+  /// the write reports its progress; the outcome is reported by
+  /// AsyncWriteFinishedEvent. Default is off.
+  vtkGetMacro(WriteInBackground, int);
+  vtkSetMacro(WriteInBackground, int);
+  vtkBooleanMacro(WriteInBackground, int);
+
+  enum AsyncWriteStates
+    {
+    AsyncWriteIdle = 0,
+    AsyncWriteRunning,
+    AsyncWriteDone,
+    AsyncWriteFailed
+    };
+
+  enum
+    {
+    /// Invoked by ProcessAsyncWrite when the background write is over.
+    /// Call data is the state (int*): AsyncWriteDone or AsyncWriteFailed.
+    AsyncWriteFinishedEvent = 20100
+    };
+
+  ///
+  /// Poll the background write from the main thread: while the write is
+  /// running it invokes vtkCommand::ProgressEvent (call data is the
+  /// progress, 0 to 1), once it is over it reports the errors and returns
+  /// AsyncWriteDone (or AsyncWriteFailed).
+  int ProcessAsyncWrite();
+
+  ///
+  /// Block until the background write is over, then process it
+  int WaitForAsyncWrite();
+
+  ///
+  /// Progress (0 to 1) of the background write
+  double GetAsyncWriteProgress();
+
+  ///
+  /// True while the worker thread of the background write is writing
+  bool IsAsyncWriteRunning();
+
+  ///
+  /// Block until the background write of the storage node of volumeNode
+  /// (if any) is over. Call it from the main thread before changing the
+  /// voxels of a volume in place.
+  static void WaitForBackgroundWrite(vtkMRMLVolumeNode *volumeNode);
+
+  ///
+  /// Copy on write: if the background write of the storage node of
+  /// volumeNode is still reading the scalars of the node, give the node
+  /// a copy of them, so that the voxels can be changed in place while the
+  /// write goes on with the original ones. Call it from the main thread.
+  static void DetachFromBackgroundWrite(vtkMRMLVolumeNode *volumeNode);
+
   ///
   /// Configure the storage node for data exchange. This is an
   /// opportunity to optimize the storage node's settings, for
@@ -82,10 +247,66 @@ protected:
   /// Read data and set it in the referenced node
   virtual int ReadDataInternal(vtkMRMLNode *refNode);
 
+  ///
+  /// Set the storage options and the file name in reader and read the header
+  bool ConfigureReader(vtkFITSReader *reader, vtkMRMLNode *refNode);
+
+  ///
+  /// Set the output (and the header) of an updated reader in refNode
+  int SetReaderOutputInNode(vtkFITSReader *reader, vtkMRMLNode *refNode);
+
+  ///
+  /// Open (or build) the brick cache of the file and attach it to refNode,
+  /// then subsample reader to fit in the memory budget.
+  void SetupBrickCache(vtkFITSReader *reader, vtkMRMLNode *refNode);
+
+  ///
+  /// The two halves of SetupBrickCache. OpenBrickCache opens (building it
+  /// on the first load) the brick cache of fileName, subsamples reader and
+  /// returns the cache (the caller owns it) or NULL. It touches no node:
+  /// asynchronous reads run it in the reading thread.
+  vtkFITSBrickCache* OpenBrickCache(vtkFITSReader *reader, const std::string &fileName,
+                                    int subsampling[3]);
+  void SetBrickCacheInNode(vtkFITSBrickCache *brickCache, const int subsampling[3],
+                           vtkMRMLNode *refNode);
+
+  static VTK_THREAD_RETURN_TYPE AsyncReadThread(void *arg);
+  static VTK_THREAD_RETURN_TYPE AsyncWriteThread(void *arg);
+  static void AsyncWriteProgressCallback(vtkObject *caller, unsigned long eid,
+                                         void *clientData, void *callData);
+
   /// Write data from a  referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode);
 
   int CenterImage;
+  int UseNativeDataType;
+  int Binning[3];
+  int Subsample;
+  int UseBrickCache;
+  int BrickCacheMemoryBudget;
+  int NumberOfReadThreads;
+  int ReadDeferred;
+
+  vtkFITSReader *AsyncReader;
+  vtkMultiThreader *AsyncReadThreader;
+  vtkSimpleCriticalSection *AsyncReadLock;
+  int AsyncReadThreadID;
+  int AsyncReadFinished;
+  int AsyncReadCancelled;
+  std::string AsyncReadNodeID;
+  std::string AsyncReadFileName;
+  vtkFITSBrickCache *AsyncBrickCache;
+  int AsyncBrickCacheSubsampling[3];
+
+  int WriteInBackground;
+  vtkFITSWriter *AsyncWriter;
+  /// scalars pinned by the background write (compared only)
+  vtkDataArray *AsyncWriteScalars;
+  vtkSimpleCriticalSection *AsyncWriteLock;
+  int AsyncWriteThreadID;
+  int AsyncWriteFinished;
+  double AsyncWriteProgress;
+  std::string AsyncWriteNodeID;
 
 };
 
@@ -0,0 +1,135 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// vtkFits includes
+#include <vtkFITSCatalog.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+int FindTestEntry(vtkFITSCatalog *catalog, const std::string &fileName)
+{
+  for (int i = 0; i < catalog->GetNumberOfEntries(); i++)
+    {
+    const std::string &path = catalog->GetEntry(i)->Path;
+    if (path.size() >= fileName.size() &&
+        !path.compare(path.size() - fileName.size(), fileName.size(), fileName))
+      {
+      return i;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+bool Overlaps(vtkFITSCatalog *catalog, int index, double raMin, double raMax,
+              double decMin, double decMax, double spectralMin, double spectralMax)
+{
+  std::vector<int> entries;
+  catalog->FindOverlapping(raMin, raMax, decMin, decMax, spectralMin, spectralMax, entries,
+                           catalog->GetEntry(index)->SpectralType.c_str());
+  return std::find(entries.begin(), entries.end(), index) != entries.end();
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkFITSCatalogTest1(int argc, char * argv[] )
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: vtkFITSCatalogTest1 /path/to/fits/directory /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkFITSCatalog> catalog;
+  catalog->Update(argv[1], false);
+  const int index = FindTestEntry(catalog.GetPointer(), "WEIN069.fits");
+  if (index < 0)
+    {
+    std::cerr << "WEIN069.fits not found in the catalog of " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const vtkFITSCatalog::Entry *entry = catalog->GetEntry(index);
+  if (entry->Dimensions[0] != 134 || entry->Dimensions[1] != 70 || entry->Dimensions[2] != 83)
+    {
+    std::cerr << "Dimensions of the entry : " << entry->Dimensions[0] << " "
+              << entry->Dimensions[1] << " " << entry->Dimensions[2] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // a box inside the footprint and a box away from it
+  const double ra = (entry->RAMin + entry->RAMax) / 2.;
+  const double dec = (entry->DecMin + entry->DecMax) / 2.;
+  const double spectral = (entry->SpectralMin + entry->SpectralMax) / 2.;
+  if (!Overlaps(catalog.GetPointer(), index, ra - 0.01, ra + 0.01,
+                dec - 0.01, dec + 0.01, spectral, spectral))
+    {
+    std::cerr << "The entry does not overlap a box inside its footprint" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (Overlaps(catalog.GetPointer(), index, ra - 0.01, ra + 0.01,
+               -dec - 0.01, -dec + 0.01, spectral, spectral) ||
+      Overlaps(catalog.GetPointer(), index, ra - 0.01, ra + 0.01, dec - 0.01, dec + 0.01,
+               entry->SpectralMax + fabs(entry->SpectralMax - entry->SpectralMin) + 1.,
+               entry->SpectralMax + 2. * fabs(entry->SpectralMax - entry->SpectralMin) + 2.))
+    {
+    std::cerr << "The entry overlaps a box outside its footprint" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // the saved index gives the same answers
+  const std::string indexFileName = std::string(argv[2]) + "/vtkFITSCatalogTest1.idx";
+  if (!catalog->Save(indexFileName.c_str()))
+    {
+    std::cerr << "Error saving " << indexFileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkFITSCatalog> loadedCatalog;
+  if (!loadedCatalog->Load(indexFileName.c_str()) ||
+      loadedCatalog->GetNumberOfEntries() != catalog->GetNumberOfEntries())
+    {
+    std::cerr << "Error loading " << indexFileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int loadedIndex = FindTestEntry(loadedCatalog.GetPointer(), "WEIN069.fits");
+  if (loadedIndex < 0 ||
+      !Overlaps(loadedCatalog.GetPointer(), loadedIndex, ra - 0.01, ra + 0.01,
+                dec - 0.01, dec + 0.01, spectral, spectral))
+    {
+    std::cerr << "The loaded entry does not overlap a box inside its footprint" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
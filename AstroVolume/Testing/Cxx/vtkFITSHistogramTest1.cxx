@@ -0,0 +1,120 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// vtkFits includes
+#include <vtkFITSHistogram.h>
+
+// VTK includes
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <limits>
+
+//----------------------------------------------------------------------------
+int vtkFITSHistogramTest1(int , char * [] )
+{
+  const int numValues = 100000;
+  const int numNaNs = 100;
+
+  // uniform values in [0, 1] and NaN voxels, in the linear bins
+  vtkNew<vtkFloatArray> uniform;
+  uniform->SetNumberOfTuples(numValues + numNaNs);
+  for (int i = 0; i < numValues; i++)
+    {
+    uniform->SetValue(i, (i + 0.5f) / numValues);
+    }
+  for (int i = numValues; i < numValues + numNaNs; i++)
+    {
+    uniform->SetValue(i, std::numeric_limits<float>::quiet_NaN());
+    }
+
+  vtkNew<vtkFITSHistogram> histogram;
+  histogram->SetNumberOfBins(1000);
+  double range[2];
+  range[0] = 0.5 / numValues;
+  range[1] = (numValues - 0.5) / numValues;
+  if (!histogram->Build(uniform.GetPointer(), range))
+    {
+    std::cerr << "Build of the uniform histogram failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (histogram->GetTotal() != numValues || histogram->GetNaNCount() != numNaNs)
+    {
+    std::cerr << "Uniform histogram : " << histogram->GetTotal() << " voxels and "
+              << histogram->GetNaNCount() << " NaN instead of " << numValues
+              << " and " << numNaNs << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double quantiles[5] = {0.01, 0.25, 0.5, 0.75, 0.99};
+  for (int i = 0; i < 5; i++)
+    {
+    const double value = histogram->GetQuantile(quantiles[i]);
+    if (fabs(value - quantiles[i]) > 2.E-3)
+      {
+      std::cerr << "Uniform histogram : quantile " << quantiles[i] << " is "
+                << value << std::endl;
+      return EXIT_FAILURE;
+      }
+    const double fraction = histogram->GetFractionAbove(quantiles[i]);
+    if (fabs(fraction - (1. - quantiles[i])) > 2.E-3)
+      {
+      std::cerr << "Uniform histogram : fraction above " << quantiles[i] << " is "
+                << fraction << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // log-uniform values over four decades: the faint quantiles fall in the
+  // first linear bin and are resolved by the log bins
+  vtkNew<vtkFloatArray> logUniform;
+  logUniform->SetNumberOfTuples(numValues);
+  for (int i = 0; i < numValues; i++)
+    {
+    logUniform->SetValue(i, static_cast<float>(pow(10., -4. * (numValues - i - 0.5) / numValues)));
+    }
+  histogram->SetNumberOfLogBins(1000);
+  histogram->SetNumberOfDecades(5.);
+  range[0] = logUniform->GetValue(0);
+  range[1] = logUniform->GetValue(numValues - 1);
+  if (!histogram->Build(logUniform.GetPointer(), range))
+    {
+    std::cerr << "Build of the log-uniform histogram failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for (int i = 0; i < 5; i++)
+    {
+    const double expected = pow(10., -4. * (1. - quantiles[i]));
+    const double value = histogram->GetQuantile(quantiles[i]);
+    if (fabs(value - expected) > 0.02 * expected)
+      {
+      std::cerr << "Log-uniform histogram : quantile " << quantiles[i] << " is "
+                << value << " instead of " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// vtkFits includes
+#include <vtkFITSReader.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+double HeaderValue(vtkFITSReader *reader, const char *key, int axis)
+{
+  std::string name = std::string("SlicerAstro.") + key;
+  name += static_cast<char>('1' + axis);
+  const char *value = reader->GetHeaderValue(name.c_str());
+  return value ? atof(value) : 0.;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkFITSReaderTest1(int argc, char * argv[] )
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: vtkFITSReaderTest1 /path/to/file.fits" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkFITSReader> reader;
+  reader->UseHeaderCacheOff();
+  reader->SetFileName(argv[1]);
+  reader->Update();
+  vtkNew<vtkImageData> fullImage;
+  fullImage->DeepCopy(reader->GetOutput());
+  double naxis[3], cdelt[3], crpix[3];
+  for (int axis = 0; axis < 3; axis++)
+    {
+    naxis[axis] = HeaderValue(reader.GetPointer(), "NAXIS", axis);
+    cdelt[axis] = HeaderValue(reader.GetPointer(), "CDELT", axis);
+    crpix[axis] = HeaderValue(reader.GetPointer(), "CRPIX", axis);
+    }
+
+  const int bin[3] = {2, 3, 4};
+  vtkNew<vtkFITSReader> binnedReader;
+  binnedReader->UseHeaderCacheOff();
+  binnedReader->SetFileName(argv[1]);
+  binnedReader->SetBinning(bin[0], bin[1], bin[2]);
+  binnedReader->Update();
+
+  // the first binned pixel covers the pixels 0.5 .. bin + 0.5 of the file
+  for (int axis = 0; axis < 3; axis++)
+    {
+    const int binnedNaxis = static_cast<int>(HeaderValue(binnedReader.GetPointer(), "NAXIS", axis));
+    const double binnedCdelt = HeaderValue(binnedReader.GetPointer(), "CDELT", axis);
+    const double binnedCrpix = HeaderValue(binnedReader.GetPointer(), "CRPIX", axis);
+    const double expectedCrpix = (crpix[axis] - 0.5) / bin[axis] + 0.5;
+    if (binnedNaxis != static_cast<int>(naxis[axis]) / bin[axis] ||
+        fabs(binnedCdelt - cdelt[axis] * bin[axis]) > 1.E-6 * fabs(cdelt[axis] * bin[axis]) ||
+        fabs(binnedCrpix - expectedCrpix) > 1.E-6 * (1. + fabs(expectedCrpix)))
+      {
+      std::cerr << "Binning of axis " << axis + 1 << " : NAXIS " << binnedNaxis
+                << ", CDELT " << binnedCdelt << ", CRPIX " << binnedCrpix
+                << " instead of " << static_cast<int>(naxis[axis]) / bin[axis] << ", "
+                << cdelt[axis] * bin[axis] << ", " << expectedCrpix << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  vtkImageData *binnedImage = binnedReader->GetOutput();
+  if (fullImage->GetScalarType() != VTK_FLOAT || binnedImage->GetScalarType() != VTK_FLOAT)
+    {
+    std::cerr << "The test file is expected to be read as float" << std::endl;
+    return EXIT_FAILURE;
+    }
+  int *fullDims = fullImage->GetDimensions();
+  int *binnedDims = binnedImage->GetDimensions();
+  for (int axis = 0; axis < 3; axis++)
+    {
+    if (binnedDims[axis] != fullDims[axis] / bin[axis])
+      {
+      std::cerr << "Binned dimension " << axis << " is " << binnedDims[axis]
+                << " instead of " << fullDims[axis] / bin[axis] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // the binned voxels are the average of their bin, NaN excluded
+  const float *fullPixels = static_cast<float*>(fullImage->GetScalarPointer());
+  const float *binnedPixels = static_cast<float*>(binnedImage->GetScalarPointer());
+  for (int z = 0; z < binnedDims[2]; z += 5)
+    {
+    for (int y = 0; y < binnedDims[1]; y += 3)
+      {
+      for (int x = 0; x < binnedDims[0]; x += 7)
+        {
+        double sum = 0., maximum = 0.;
+        int count = 0;
+        for (int k = z * bin[2]; k < (z + 1) * bin[2]; k++)
+          {
+          for (int j = y * bin[1]; j < (y + 1) * bin[1]; j++)
+            {
+            for (int i = x * bin[0]; i < (x + 1) * bin[0]; i++)
+              {
+              const float value = fullPixels[(k * fullDims[1] + j) * fullDims[0] + i];
+              if (value == value)
+                {
+                sum += value;
+                maximum = std::max(maximum, fabs(static_cast<double>(value)));
+                count++;
+                }
+              }
+            }
+          }
+
+        const float value = binnedPixels[(z * binnedDims[1] + y) * binnedDims[0] + x];
+        if ((count == 0 && value == value) ||
+            (count > 0 && fabs(value - sum / count) > 1.E-5 * maximum))
+          {
+          std::cerr << "Binned voxel (" << x << ", " << y << ", " << z << ") is "
+                    << value << " instead of " << (count ? sum / count : 0.) << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
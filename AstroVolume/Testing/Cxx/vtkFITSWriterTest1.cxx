@@ -0,0 +1,141 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// vtkFits includes
+#include <vtkFITSReader.h>
+#include <vtkFITSWriter.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool WriteFile(vtkFITSReader *reader, const std::string &fileName, int slabPlanes)
+{
+  vtkNew<vtkFITSWriter> writer;
+  writer->SetFileName(fileName.c_str());
+  writer->SetSlabPlanes(slabPlanes);
+  // the header is passed to the writer as the storage node does
+  std::vector<std::string> keys = reader->GetHeaderKeysVector();
+  for (std::vector<std::string>::iterator kit = keys.begin(); kit != keys.end(); ++kit)
+    {
+    writer->SetAttribute(*kit, reader->GetHeaderValue((*kit).c_str()));
+    }
+  writer->SetInputConnection(reader->GetOutputPort());
+  writer->Write();
+  if (writer->GetWriteError())
+    {
+    std::cerr << "Error writing " << fileName << " with " << slabPlanes
+              << " planes per slab" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool ReadFile(const std::string &fileName, vtkImageData *imageData)
+{
+  vtkNew<vtkFITSReader> reader;
+  reader->UseHeaderCacheOff();
+  reader->SetFileName(fileName.c_str());
+  reader->Update();
+  if (!reader->GetOutput() || !reader->GetOutput()->GetPointData()->GetScalars())
+    {
+    std::cerr << "Error reading " << fileName << std::endl;
+    return false;
+    }
+  imageData->DeepCopy(reader->GetOutput());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool SameVoxels(vtkImageData *image1, vtkImageData *image2)
+{
+  int *dims1 = image1->GetDimensions();
+  int *dims2 = image2->GetDimensions();
+  if (dims1[0] != dims2[0] || dims1[1] != dims2[1] || dims1[2] != dims2[2] ||
+      image1->GetScalarType() != image2->GetScalarType())
+    {
+    return false;
+    }
+  const size_t size = static_cast<size_t>(dims1[0]) * dims1[1] * dims1[2] *
+    image1->GetScalarSize() * image1->GetNumberOfScalarComponents();
+  return !memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), size);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkFITSWriterTest1(int argc, char * argv[] )
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: vtkFITSWriterTest1 /path/to/file.fits /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkFITSReader> reader;
+  reader->UseHeaderCacheOff();
+  reader->ReadUpdateExtentOn();
+  reader->SetFileName(argv[1]);
+  reader->Update();
+  vtkNew<vtkImageData> original;
+  original->DeepCopy(reader->GetOutput());
+
+  // the number of planes of the test file is not a multiple of the slab
+  const std::string wholeFileName = std::string(argv[2]) + "/vtkFITSWriterTest1_whole.fits";
+  const std::string slabFileName = std::string(argv[2]) + "/vtkFITSWriterTest1_slabs.fits";
+  if (!WriteFile(reader.GetPointer(), wholeFileName, 0) ||
+      !WriteFile(reader.GetPointer(), slabFileName, 7))
+    {
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkImageData> whole;
+  vtkNew<vtkImageData> slabs;
+  if (!ReadFile(wholeFileName, whole.GetPointer()) ||
+      !ReadFile(slabFileName, slabs.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  if (!SameVoxels(original.GetPointer(), whole.GetPointer()))
+    {
+    std::cerr << "The file written at once differs from the input" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!SameVoxels(whole.GetPointer(), slabs.GetPointer()))
+    {
+    std::cerr << "The file written in slabs differs from the file written at once" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
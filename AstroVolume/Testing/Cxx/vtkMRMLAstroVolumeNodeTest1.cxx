@@ -0,0 +1,139 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLAstroVolumeNode.h"
+
+// vtkFits includes
+#include <vtkFITSHeader.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Robust noise of a synthetic Gaussian cube with a bright source
+bool TestNoise()
+{
+  const double mean = 0.5;
+  const double sigma = 2.;
+  const int dims[3] = {48, 48, 48};
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+  float *pixels = static_cast<float*>(imageData->GetScalarPointer(0,0,0));
+  vtkMath::RandomSeed(8775070);
+  for (int z = 0; z < dims[2]; z++)
+    {
+    for (int y = 0; y < dims[1]; y++)
+      {
+      for (int x = 0; x < dims[0]; x++, pixels++)
+        {
+        *pixels = static_cast<float>(vtkMath::Gaussian(mean, sigma));
+        // the source covers less than 2% of the voxels
+        if (x >= 18 && x < 30 && y >= 18 && y < 30 && z >= 18 && z < 30)
+          {
+          *pixels += 100.f;
+          }
+        }
+      }
+    }
+
+  vtkNew<vtkMRMLAstroVolumeNode> volume;
+  volume->SetAndObserveImageData(imageData.GetPointer());
+  volume->UpdateNoiseAttributes();
+
+  const double rms = atof(volume->GetAttribute("SlicerAstro.RMS"));
+  const double noiseMean = atof(volume->GetAttribute("SlicerAstro.NOISEMEAN"));
+  if (fabs(rms - sigma) > 0.05 * sigma || fabs(noiseMean - mean) > 0.05)
+    {
+    std::cerr << "Noise : RMS " << rms << " and mean " << noiseMean
+              << " instead of " << sigma << " and " << mean << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// The header is parsed again only when a "SlicerAstro." attribute changes
+bool TestHeaderCache()
+{
+  vtkNew<vtkMRMLAstroVolumeNode> volume;
+  volume->SetAttribute("SlicerAstro.NAXIS", "3");
+  volume->SetAttribute("SlicerAstro.CDELT1", "0.5");
+
+  vtkFITSHeader *header = volume->GetAstroHeader();
+  if (!header || header->GetCDELT(0) != 0.5)
+    {
+    std::cerr << "Header cache : CDELT1 not parsed" << std::endl;
+    return false;
+    }
+
+  volume->SetAttribute("Other.Attribute", "1");
+  volume->SetAttribute("SlicerAstro.CDELT1", "0.5");
+  if (volume->GetAstroHeader() != header || header->GetCDELT(0) != 0.5)
+    {
+    std::cerr << "Header cache : header changed without a new header value" << std::endl;
+    return false;
+    }
+
+  volume->SetAttribute("SlicerAstro.CDELT1", "0.25");
+  if (volume->GetAstroHeader()->GetCDELT(0) != 0.25)
+    {
+    std::cerr << "Header cache : CDELT1 is " << volume->GetAstroHeader()->GetCDELT(0)
+              << " after setting the attribute to 0.25" << std::endl;
+    return false;
+    }
+
+  // the copy of a node gets the header of the source node
+  vtkNew<vtkMRMLAstroVolumeNode> copy;
+  copy->SetAttribute("SlicerAstro.CDELT2", "1.");
+  copy->GetAstroHeader();
+  volume->SetAttribute("SlicerAstro.CDELT2", "2.");
+  copy->Copy(volume.GetPointer());
+  if (copy->GetAstroHeader()->GetCDELT(1) != 2.)
+    {
+    std::cerr << "Header cache : CDELT2 of the copy is "
+              << copy->GetAstroHeader()->GetCDELT(1) << " instead of 2" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNodeTest1(int , char * [] )
+{
+  if (!TestNoise() || !TestHeaderCache())
+    {
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
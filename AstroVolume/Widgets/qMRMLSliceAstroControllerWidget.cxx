@@ -17,6 +17,9 @@
 
 ==============================================================================*/
 
+// STD includes
+#include <algorithm>
+
 // Qt includes
 #include <QDebug>
 #include <QGridLayout>
@@ -58,6 +61,8 @@
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 
 // VTK includes
+#include <vtkImageData.h>
+#include <vtkImageReslice.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtksys/SystemTools.hxx>
@@ -107,6 +112,7 @@ void qMRMLSliceAstroControllerWidgetPrivate::init()
   this->BarLayout->addWidget(this->WCSDisplay);
   this->app = 0;
   this->col = vtkSmartPointer<vtkCollection>::New();
+  this->PyramidLevel = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -144,6 +150,7 @@ void qMRMLSliceAstroControllerWidgetPrivate::updateCoordinateWidgetFromMRMLSlice
     }
 
   q->setWCSDisplay();
+  q->updatePyramidLevel();
 }
 
 // --------------------------------------------------------------------------
@@ -364,3 +371,62 @@ void qMRMLSliceAstroControllerWidget::setWCSDisplay()
       d->WCSDisplay->setFixedWidth(10);
       }
 }
+
+// --------------------------------------------------------------------------
+void qMRMLSliceAstroControllerWidget::updatePyramidLevel()
+{
+  Q_D(qMRMLSliceAstroControllerWidget);
+
+  vtkMRMLSliceNode* sliceNode = this->mrmlSliceNode();
+  vtkMRMLSliceLogic* sliceLogic = this->sliceLogic();
+  vtkMRMLSliceLayerLogic* layerLogic = sliceLogic ? sliceLogic->GetBackgroundLayer() : 0;
+  vtkMRMLAstroVolumeNode* astroVolume = layerLogic ?
+    vtkMRMLAstroVolumeNode::SafeDownCast(layerLogic->GetVolumeNode()) : 0;
+
+  // the layer resets the input of its reslice when it is updated, and
+  // the levels are attached to the volume when a build completes
+  if (layerLogic != d->PyramidLayerLogic.GetPointer())
+    {
+    d->qvtkReconnect(d->PyramidLayerLogic, layerLogic, vtkCommand::ModifiedEvent,
+                     this, SLOT(updatePyramidLevel()));
+    d->PyramidLayerLogic = layerLogic;
+    d->PyramidLevel = 0;
+    }
+  if (astroVolume != d->PyramidVolume.GetPointer())
+    {
+    d->qvtkReconnect(d->PyramidVolume, astroVolume, vtkCommand::ModifiedEvent,
+                     this, SLOT(updatePyramidLevel()));
+    d->PyramidVolume = astroVolume;
+    d->PyramidLevel = 0;
+    }
+
+  if (!sliceNode || !astroVolume || !astroVolume->GetImageData() ||
+      !layerLogic->GetReslice())
+    {
+    return;
+    }
+
+  // size (in RAS) of a pixel of the view
+  const double pixelSize = sliceNode->GetFieldOfView()[0] /
+    std::max(sliceNode->GetDimensions()[0], 1);
+  const int level = astroVolume->GetPyramidLevelForPixelSize(pixelSize);
+
+  // the spacing and origin of a level place its voxels in the IJK of
+  // level 0, so the reslice transform of the layer is still valid
+  vtkImageReslice* reslice = layerLogic->GetReslice();
+  if (level > 0)
+    {
+    vtkImageData* levelData = astroVolume->GetPyramidLevel(level);
+    if (reslice->GetInput() != levelData)
+      {
+      reslice->SetInputData(levelData);
+      emit renderRequested();
+      }
+    }
+  else if (d->PyramidLevel > 0 && reslice->GetInput() != astroVolume->GetImageData())
+    {
+    reslice->SetInputConnection(astroVolume->GetImageDataConnection());
+    emit renderRequested();
+    }
+  d->PyramidLevel = level;
+}
@@ -48,6 +48,12 @@ public slots:
   /// Set the display of the WCS coordinate on the slice.
   void setWCSDisplay();
 
+  /// Reslice the coarsest pyramid level of the background AstroVolume
+  /// (see vtkMRMLAstroVolumeNode::BuildPyramid) whose voxels are not
+  /// larger than a pixel of the view, i.e. the full resolution data
+  /// unless the view is zoomed out.
+  void updatePyramidLevel();
+
 protected:
   qMRMLSliceAstroControllerWidget(qMRMLSliceAstroControllerWidgetPrivate* pimpl, QWidget* parent = 0);
 
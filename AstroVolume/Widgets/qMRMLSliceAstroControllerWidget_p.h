@@ -45,8 +45,11 @@
 // vtk includes
 #include <vtkCollection.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 class qSlicerApplication;
+class vtkMRMLAstroVolumeNode;
+class vtkMRMLSliceLayerLogic;
 
 //-----------------------------------------------------------------------------
 class qMRMLSliceAstroControllerWidgetPrivate
@@ -73,6 +76,11 @@ public:
   QLabel*     WCSDisplay;
   qSlicerApplication* app;
   vtkSmartPointer<vtkCollection> col;
+
+  // pyramid level resliced by the background layer (0 is the image data)
+  int PyramidLevel;
+  vtkWeakPointer<vtkMRMLAstroVolumeNode> PyramidVolume;
+  vtkWeakPointer<vtkMRMLSliceLayerLogic> PyramidLayerLogic;
 };
 
 #endif
@@ -209,13 +209,23 @@ void qSlicerAstroScalarVolumeDisplayWidget::updateTransferFunction()
   double range[2] = {0,255};
   vtkMRMLAstroVolumeDisplayNode* displayNode =
     this->volumeDisplayNode();
-  if (displayNode)
+  // the cached statistics of the planes avoid a scan of the voxels
+  vtkMRMLAstroVolumeNode* astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(volumeNode);
+  if (astroVolumeNode && astroVolumeNode->GetPlanesRange(0, -1, range))
     {
-    displayNode->GetDisplayScalarRange(range);
+    // the transfer function maps voxel values
+    astroVolumeNode->GetVoxelRange(range);
     }
   else
     {
-    imageData->GetScalarRange(range);
+    if (displayNode)
+      {
+      displayNode->GetDisplayScalarRange(range);
+      }
+    else
+      {
+      imageData->GetScalarRange(range);
+      }
     }
   // AdjustRange call will take out points that are outside of the new
   // range, but it needs the points to be there in order to work, so call
@@ -38,6 +38,13 @@
 #include "vtkMRMLVolumeArchetypeStorageNode.h"
 #include "vtkSlicerApplicationLogic.h"
 
+namespace
+{
+//----------------------------------------------------------------------------
+// Single files larger than this (in bytes) are loaded in batch mode
+const qint64 BatchLoadSize = 256 * 1024 * 1024;
+}
+
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_AstroVolume
 class qSlicerAstroVolumeIOOptionsWidgetPrivate
@@ -45,6 +52,9 @@ class qSlicerAstroVolumeIOOptionsWidgetPrivate
   , public Ui_qSlicerAstroVolumeIOOptionsWidget
 {
 public:
+  /// several files, or a large one: read the full resolution data
+  /// in the background (see qSlicerAstroVolumeReader::loadBatch)
+  bool Batch;
 };
 
 //-----------------------------------------------------------------------------
@@ -52,6 +62,7 @@ qSlicerAstroVolumeIOOptionsWidget::qSlicerAstroVolumeIOOptionsWidget(QWidget* pa
   : qSlicerIOOptionsWidget(new qSlicerAstroVolumeIOOptionsWidgetPrivate, parentWidget)
 {
   Q_D(qSlicerAstroVolumeIOOptionsWidget);
+  d->Batch = false;
   d->setupUi(this);
 
   ctkFlowLayout::replaceLayout(this);
@@ -85,6 +96,16 @@ qSlicerAstroVolumeIOOptionsWidget::qSlicerAstroVolumeIOOptionsWidget(QWidget* pa
           this, SLOT(updateProperties()));
   connect(d->SingleFileCheckBox, SIGNAL(toggled(bool)),
           this, SLOT(updateProperties()));
+  connect(d->NativeDataTypeCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+  connect(d->ProgressiveCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+  connect(d->PyramidCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+  connect(d->BinningXYSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(updateProperties()));
+  connect(d->BinningZSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(updateProperties()));
   connect(d->ColorTableComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
           this, SLOT(updateProperties()));
 
@@ -123,6 +144,12 @@ void qSlicerAstroVolumeIOOptionsWidget::updateProperties()
   d->Properties["labelmap"] = d->LabelMapCheckBox->isChecked();
   d->Properties["center"] = d->CenteredCheckBox->isChecked();
   d->Properties["singleFile"] = d->SingleFileCheckBox->isChecked();
+  d->Properties["nativeDataType"] = d->NativeDataTypeCheckBox->isChecked();
+  d->Properties["progressive"] = d->ProgressiveCheckBox->isChecked();
+  d->Properties["pyramid"] = d->PyramidCheckBox->isChecked();
+  d->Properties["batch"] = d->Batch;
+  d->Properties["binningXY"] = d->BinningXYSpinBox->value();
+  d->Properties["binningZ"] = d->BinningZSpinBox->value();
   d->Properties["colorNodeID"] = d->ColorTableComboBox->currentNodeID();
 }
 
@@ -140,11 +167,16 @@ void qSlicerAstroVolumeIOOptionsWidget::setFileNames(const QStringList& fileName
   bool onlyNumberInName = false;
   bool onlyNumberInExtension = false;
   bool hasLabelMapName = false;
+  d->Batch = fileNames.count() > 1;
 
   vtkNew<vtkMRMLVolumeArchetypeStorageNode> snode;
   foreach(const QString& fileName, fileNames)
     {
     QFileInfo fileInfo(fileName);
+    if (fileInfo.size() > BatchLoadSize)
+      {
+      d->Batch = true;
+      }
     QString fileBaseName = fileInfo.baseName();
     if (fileInfo.isFile())
       {
@@ -173,6 +205,7 @@ void qSlicerAstroVolumeIOOptionsWidget::setFileNames(const QStringList& fileName
   d->NameLineEdit->setText( names.join("; ") );
   d->SingleFileCheckBox->setChecked(!onlyNumberInName && !onlyNumberInExtension);
   d->LabelMapCheckBox->setChecked(hasLabelMapName);
+  this->updateProperties();
   this->qSlicerIOOptionsWidget::setFileNames(fileNames);
 
   // update the color selector since the label map check box may not
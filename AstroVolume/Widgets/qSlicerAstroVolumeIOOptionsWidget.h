@@ -46,7 +46,8 @@ public slots:
 
 protected slots:
   /// Update the name, labelmap, center, singleFile, discardOrientation,
-  /// colorNodeID properties
+  /// colorNodeID properties. The batch property is set for several files
+  /// or for a file larger than 256 MB.
   void updateProperties();
   /// Update the color node selection to the default label map
   /// or volume color node depending on the label map checkbox state.
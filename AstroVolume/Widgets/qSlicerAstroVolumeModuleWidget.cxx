@@ -28,6 +28,8 @@
 #include <ctkUtils.h>
 
 // VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkImageReslice.h>
 #include <vtkImageThreshold.h>
@@ -58,6 +60,7 @@
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroLabelMapVolumeDisplayNode.h>
 #include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
 #include <vtkMRMLCameraNode.h>
 #include <vtkMRMLSegmentationDisplayNode.h>
 #include <vtkMRMLLayoutLogic.h>
@@ -699,8 +702,15 @@ void qSlicerAstroVolumeModuleWidget::resetOffset(vtkMRMLNode* node)
   if (node->IsA("vtkMRMLAstroVolumeNode") ||
       node->IsA("vtkMRMLAstroLabelMapVolumeNode"))
     {
-    width = StringToDouble(node->GetAttribute("SlicerAstro.DATAMAX")) -
-        StringToDouble(node->GetAttribute("SlicerAstro.DATAMIN"));
+    // the offset shifts the transfer functions: voxel units
+    double range[2] = {StringToDouble(node->GetAttribute("SlicerAstro.DATAMIN")),
+                       StringToDouble(node->GetAttribute("SlicerAstro.DATAMAX"))};
+    vtkMRMLAstroVolumeNode *astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(node);
+    if (astroVolumeNode)
+      {
+      astroVolumeNode->GetVoxelRange(range);
+      }
+    width = range[1] - range[0];
     }
 
   d->PresetOffsetSlider->setValue(0.);
@@ -919,13 +929,25 @@ void qSlicerAstroVolumeModuleWidget::onPushButtonCovertLabelMapToSegmentationCli
 
   // Add a segment of 4 voxels to ensure the segmentation Bounds are the same of the LabelMap
   // (however, it will be present a segement more which it is not ideal)
-  int* dims = labelMapNode->GetImageData()->GetDimensions();
-  const int numElements = dims[0] * dims[1] * dims[2];
-  short* voxelPtr = static_cast<short*>(labelMapNode->GetImageData()->GetScalarPointer());
+  // (the labels can be short or unsigned char)
+  // a background write of the label map may still read the voxels
+  vtkMRMLAstroVolumeStorageNode::DetachFromBackgroundWrite(labelMapNode);
+  if (labelMapNode->GetImageData()->GetScalarType() == VTK_UNSIGNED_CHAR &&
+      StringToShort(labelMapNode->GetAttribute("SlicerAstro.DATAMAX")) >= VTK_UNSIGNED_CHAR_MAX)
+    {
+    vtkNew<vtkImageCast> cast;
+    cast->SetInputData(labelMapNode->GetImageData());
+    cast->SetOutputScalarTypeToShort();
+    cast->Update();
+    labelMapNode->GetImageData()->DeepCopy(cast->GetOutput());
+    }
+  vtkDataArray* voxels = labelMapNode->GetImageData()->GetPointData()->GetScalars();
+  const vtkIdType numElements = voxels->GetNumberOfTuples();
   short val = StringToShort(labelMapNode->GetAttribute("SlicerAstro.DATAMAX")) + 1;
 
-  *(voxelPtr) = val;
-  *(voxelPtr + numElements - 1) = val;
+  voxels->SetComponent(0, 0, val);
+  voxels->SetComponent(numElements - 1, 0, val);
+  voxels->Modified();
 
   labelMapNode->UpdateRangeAttributes();
 
@@ -943,8 +965,9 @@ void qSlicerAstroVolumeModuleWidget::onPushButtonCovertLabelMapToSegmentationCli
       }
     }
 
-  *(voxelPtr) = 0;
-  *(voxelPtr + numElements - 1) = 0;
+  voxels->SetComponent(0, 0, 0);
+  voxels->SetComponent(numElements - 1, 0, 0);
+  voxels->Modified();
 
   labelMapNode->UpdateRangeAttributes();
 
@@ -1155,6 +1178,9 @@ void qSlicerAstroVolumeModuleWidget::onPushButtonConvertSegmentationToLabelMapCl
   storedOrigin[1] -= Origin[1];
   storedOrigin[2] -= Origin[2];
 
+  // the voxels of the label map are rewritten in place
+  vtkMRMLAstroVolumeStorageNode::WaitForBackgroundWrite(labelMapNode);
+
   vtkNew<vtkImageData> tempVolumeData;
   tempVolumeData->Initialize();
   tempVolumeData->DeepCopy(labelMapNode->GetImageData());
@@ -1205,7 +1231,10 @@ void qSlicerAstroVolumeModuleWidget::onPushButtonConvertSegmentationToLabelMapCl
     *(voxelPtr + shift) = *(tempVoxelPtr + elemCnt);
     }
 
+  labelMapNode->GetImageData()->GetPointData()->GetScalars()->Modified();
   labelMapNode->UpdateRangeAttributes();
+  // less than 256 segments: store the labels as unsigned char
+  labelMapNode->ConvertToCompactLabels();
 
   d->pushButtonConvertSegmentationToLabelMap->blockSignals(true);
   d->pushButtonConvertSegmentationToLabelMap->setChecked(false);
@@ -1477,10 +1506,13 @@ void qSlicerAstroVolumeModuleWidget::setComparative3DViews(const char* volumeNod
     double min, max;
     min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS")) * 3.;
     max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeOne->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1507,10 +1539,13 @@ void qSlicerAstroVolumeModuleWidget::setComparative3DViews(const char* volumeNod
     double min, max;
     min = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.RMS")) * 3.;
     max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeTwo->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1761,10 +1796,13 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
     double min, max;
     min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS")) * ContourLevel;
     max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeOne->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1791,10 +1829,13 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
     double min, max;
     min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS")) * ContourLevel;
     max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeTwo->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1818,12 +1859,12 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
 
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeTwo->GetImageData());
-    double max;
-    max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(1.E-6 , max);
+    double range[2] = {1.E-6, StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"))};
+    volumeTwo->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1882,7 +1923,8 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     }
 
   double rms = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS"));
-  d->PresetOffsetSlider->setValue((rms * ContourLevel) - (rms * 3.));
+  d->PresetOffsetSlider->setValue(volumeOne->GetVoxelValue(rms * ContourLevel) -
+                                  volumeOne->GetVoxelValue(rms * 3.));
 
   if (!d->segmentEditorNode)
     {
@@ -1917,10 +1959,13 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     double min, max;
     min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS")) * ContourLevel;
     max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeOne->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
@@ -1952,10 +1997,13 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     double min, max;
     min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.RMS")) * ContourLevel;
     max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
-    imageThreshold->ThresholdBetween(min, max);
+    // physical values: convert them in voxel units
+    double range[2] = {min, max};
+    volumeTwo->GetVoxelRange(range);
+    imageThreshold->ThresholdBetween(range[0], range[1]);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
-    imageThreshold->SetOutputScalarType(VTK_SHORT);
+    imageThreshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
     imageThreshold->Update();
     vtkNew<vtkOrientedImageData> modifierLabelmap;
     modifierLabelmap->DeepCopy(imageThreshold->GetOutput());
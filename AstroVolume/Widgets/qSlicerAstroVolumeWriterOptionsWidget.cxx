@@ -0,0 +1,83 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// AstroVolume includes
+#include <qSlicerIOOptions_p.h>
+#include <qSlicerAstroVolumeWriterOptionsWidget.h>
+#include <ui_qSlicerAstroVolumeWriterOptionsWidget.h>
+
+// MRML includes
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLStorableNode.h>
+
+//-----------------------------------------------------------------------------
+/// \ingroup Slicer_QtModules_AstroVolume
+class qSlicerAstroVolumeWriterOptionsWidgetPrivate
+  : public qSlicerIOOptionsPrivate
+  , public Ui_qSlicerAstroVolumeWriterOptionsWidget
+{
+public:
+};
+
+//-----------------------------------------------------------------------------
+qSlicerAstroVolumeWriterOptionsWidget::qSlicerAstroVolumeWriterOptionsWidget(QWidget* parentWidget)
+  : Superclass(new qSlicerAstroVolumeWriterOptionsWidgetPrivate, parentWidget)
+{
+  Q_D(qSlicerAstroVolumeWriterOptionsWidget);
+  d->setupUi(this);
+
+  connect(d->UseCompressionCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+  connect(d->BackgroundCheckBox, SIGNAL(toggled(bool)),
+          this, SLOT(updateProperties()));
+
+  this->updateProperties();
+}
+
+//-----------------------------------------------------------------------------
+qSlicerAstroVolumeWriterOptionsWidget::~qSlicerAstroVolumeWriterOptionsWidget()
+{
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeWriterOptionsWidget::setObject(vtkObject* object)
+{
+  Q_D(qSlicerAstroVolumeWriterOptionsWidget);
+  vtkMRMLStorableNode* storableNode = vtkMRMLStorableNode::SafeDownCast(object);
+  vtkMRMLStorageNode* storageNode = storableNode ? storableNode->GetStorageNode() : 0;
+  if (storageNode)
+    {
+    d->UseCompressionCheckBox->setChecked(storageNode->GetUseCompression());
+    }
+  vtkMRMLAstroVolumeStorageNode* astroStorageNode =
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(storageNode);
+  if (astroStorageNode)
+    {
+    d->BackgroundCheckBox->setChecked(astroStorageNode->GetWriteInBackground());
+    }
+  this->Superclass::setObject(object);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeWriterOptionsWidget::updateProperties()
+{
+  Q_D(qSlicerAstroVolumeWriterOptionsWidget);
+  d->Properties["useCompression"] = d->UseCompressionCheckBox->isChecked();
+  d->Properties["background"] = d->BackgroundCheckBox->isChecked();
+}
@@ -0,0 +1,61 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __qSlicerAstroVolumeWriterOptionsWidget_h
+#define __qSlicerAstroVolumeWriterOptionsWidget_h
+
+// CTK includes
+#include <ctkPimpl.h>
+
+// SlicerQt includes
+#include "qSlicerFileWriterOptionsWidget.h"
+
+// AstroVolume includes
+#include "qSlicerAstroVolumeModuleWidgetsExport.h"
+
+class qSlicerAstroVolumeWriterOptionsWidgetPrivate;
+
+/// \ingroup Slicer_QtModules_AstroVolume_Widgets
+///
+/// Options of the AstroVolume writer in the save dialog: compression
+/// (useCompression) and background write (background, see
+/// vtkMRMLAstroVolumeStorageNode::SetWriteInBackground).
+class Q_SLICER_QTMODULES_ASTROVOLUME_WIDGETS_EXPORT qSlicerAstroVolumeWriterOptionsWidget :
+  public qSlicerFileWriterOptionsWidget
+{
+  Q_OBJECT
+public:
+  typedef qSlicerFileWriterOptionsWidget Superclass;
+  qSlicerAstroVolumeWriterOptionsWidget(QWidget *parent=0);
+  virtual ~qSlicerAstroVolumeWriterOptionsWidget();
+
+public slots:
+  /// Initialize the options from the storage node of the volume
+  virtual void setObject(vtkObject* object);
+
+protected slots:
+  /// Update the useCompression and background properties
+  void updateProperties();
+
+private:
+  Q_DECLARE_PRIVATE_D(qGetPtrHelper(qSlicerIOOptions::d_ptr), qSlicerAstroVolumeWriterOptionsWidget);
+  Q_DISABLE_COPY(qSlicerAstroVolumeWriterOptionsWidget);
+};
+
+#endif
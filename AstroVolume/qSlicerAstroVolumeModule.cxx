@@ -53,7 +53,6 @@
 #include <qSlicerLayoutManager.h>
 #include <qSlicerModuleFactoryManager.h>
 #include <qSlicerModuleManager.h>
-#include <qSlicerNodeWriter.h>
 #include <qSlicerPresetComboBox.h>
 #include <qSlicerScriptedLoadableModuleWidget.h>
 #include <qSlicerUtils.h>
@@ -67,6 +66,7 @@
 #include <qSlicerAstroVolumeModule.h>
 #include <qSlicerAstroVolumeModuleWidget.h>
 #include <qSlicerAstroVolumeReader.h>
+#include <qSlicerAstroVolumeWriter.h>
 
 // AstroVolume MRML includes
 #include <vtkMRMLAstroTwoDAxesDisplayableManager.h>
@@ -232,7 +232,7 @@ void qSlicerAstroVolumeModule::setup()
   logic->RegisterArchetypeVolumeNodeSetFactory( volumesLogic );
   qSlicerCoreIOManager* ioManager = d->app->coreIOManager();
   ioManager->registerIO(new qSlicerAstroVolumeReader(volumesLogic,this));
-  ioManager->registerIO(new qSlicerNodeWriter(
+  ioManager->registerIO(new qSlicerAstroVolumeWriter(
     "AstroVolume", QString("AstroVolumeFile"),
     QStringList() << "vtkMRMLVolumeNode", true, this));
 
@@ -18,31 +18,74 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QDebug>
+#include <QEventLoop>
 #include <QFileInfo>
+#include <QMainWindow>
+#include <QStatusBar>
+#include <QTimer>
 
 // SlicerQt includes
+#include "qSlicerApplication.h"
 #include "qSlicerAstroVolumeIOOptionsWidget.h"
 #include "qSlicerAstroVolumeReader.h"
 
 // Logic includes
 #include <vtkSlicerApplicationLogic.h>
+#include <vtkSlicerAstroVolumeLogic.h>
 #include <vtkSlicerVolumesLogic.h>
 
 // MRML includes
 #include <vtkMRMLAstroVolumeNode.h>
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
 
 // VTK includes
+#include <vtkMultiThreader.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Files larger than this (in bytes) are first loaded as a subsampled preview
+// of roughly this size when the progressive load is requested.
+const qint64 ProgressivePreviewSize = 64 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+// Default number of full resolution reads running at the same time
+const int DefaultMaximumConcurrentReads = 4;
+}
 
 //-----------------------------------------------------------------------------
 class qSlicerAstroVolumeReaderPrivate
 {
   public:
   vtkSmartPointer<vtkSlicerVolumesLogic> Logic;
+  /// storage nodes reading full resolution data in the background
+  QList<vtkWeakPointer<vtkMRMLAstroVolumeStorageNode> > AsyncReads;
+  /// volumes waiting for a free slot to read their full resolution data
+  QList<vtkWeakPointer<vtkMRMLVolumeNode> > QueuedReads;
+  int MaximumConcurrentReads;
+  int DecodeThreadsPerRead;
+  /// loadBatch in progress: every file is loaded from a preview first
+  bool BatchLoading;
+  /// defer the reads of the next scene import (see setDeferSceneReads)
+  bool DeferSceneReads;
+  /// volumes waiting for their full resolution data to build the pyramid
+  QList<vtkWeakPointer<vtkMRMLAstroVolumeNode> > PendingPyramids;
+  /// volumes building their pyramid in the background
+  QList<vtkWeakPointer<vtkMRMLAstroVolumeNode> > PyramidBuilds;
+  QTimer AsyncReadTimer;
 };
 
 //-----------------------------------------------------------------------------
@@ -50,6 +93,13 @@ qSlicerAstroVolumeReader::qSlicerAstroVolumeReader(QObject* _parent)
   : Superclass(_parent)
   , d_ptr(new qSlicerAstroVolumeReaderPrivate)
 {
+  Q_D(qSlicerAstroVolumeReader);
+  d->MaximumConcurrentReads = DefaultMaximumConcurrentReads;
+  d->DecodeThreadsPerRead = 0;
+  d->BatchLoading = false;
+  d->DeferSceneReads = false;
+  d->AsyncReadTimer.setInterval(200);
+  this->connect(&d->AsyncReadTimer, SIGNAL(timeout()), this, SLOT(processAsyncReads()));
 }
 
 //-----------------------------------------------------------------------------
@@ -57,12 +107,34 @@ qSlicerAstroVolumeReader::qSlicerAstroVolumeReader(vtkSlicerVolumesLogic* logic,
   : Superclass(_parent)
   , d_ptr(new qSlicerAstroVolumeReaderPrivate)
 {
+  Q_D(qSlicerAstroVolumeReader);
+  d->MaximumConcurrentReads = DefaultMaximumConcurrentReads;
+  d->DecodeThreadsPerRead = 0;
+  d->BatchLoading = false;
+  d->DeferSceneReads = false;
+  d->AsyncReadTimer.setInterval(200);
+  this->connect(&d->AsyncReadTimer, SIGNAL(timeout()), this, SLOT(processAsyncReads()));
   this->setLogic(logic);
 }
 
 //-----------------------------------------------------------------------------
 qSlicerAstroVolumeReader::~qSlicerAstroVolumeReader()
 {
+  Q_D(qSlicerAstroVolumeReader);
+  foreach(vtkMRMLAstroVolumeStorageNode* storageNode, d->AsyncReads)
+    {
+    if (storageNode)
+      {
+      storageNode->CancelAsyncRead();
+      }
+    }
+  foreach(vtkMRMLAstroVolumeNode* volumeNode, d->PyramidBuilds)
+    {
+    if (volumeNode)
+      {
+      volumeNode->CancelPyramidBuild();
+      }
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -95,8 +167,8 @@ qSlicerIO::IOFileType qSlicerAstroVolumeReader::fileType()const
 QStringList qSlicerAstroVolumeReader::extensions()const
 {
   return QStringList()
-    << "Volume (*.fits)"
-    << "Image (*.fits)"
+    << "Volume (*.fits *.fits.fz)"
+    << "Image (*.fits *.fits.fz)"
     << "All Files (*)";
 }
 
@@ -139,6 +211,54 @@ bool qSlicerAstroVolumeReader::load(const IOProperties& properties)
     {
     options |= properties["autoWindowLevel"].toBool() ? 0x8: 0x0;
     }
+  if (properties.contains("nativeDataType"))
+    {
+    options |= properties["nativeDataType"].toBool() ?
+      vtkSlicerAstroVolumeLogic::NativeDataType : 0x0;
+    }
+  if (properties.contains("binningXY"))
+    {
+    options |= (properties["binningXY"].toInt() & vtkSlicerAstroVolumeLogic::BinningMask)
+      << vtkSlicerAstroVolumeLogic::BinningXYShift;
+    }
+  if (properties.contains("binningZ"))
+    {
+    options |= (properties["binningZ"].toInt() & vtkSlicerAstroVolumeLogic::BinningMask)
+      << vtkSlicerAstroVolumeLogic::BinningZShift;
+    }
+  // progressive load: a subsampled preview is loaded (and rendered) first,
+  // then the full resolution data replace it in the same node
+  int previewBinning = 1;
+  bool binningRequested =
+    (options & (vtkSlicerAstroVolumeLogic::BinningMask << vtkSlicerAstroVolumeLogic::BinningXYShift)) ||
+    (options & (vtkSlicerAstroVolumeLogic::BinningMask << vtkSlicerAstroVolumeLogic::BinningZShift));
+  const bool batched = d->BatchLoading ||
+    (properties.contains("batch") && properties["batch"].toBool());
+  if (batched && !binningRequested)
+    {
+    // batched loads only create the nodes here, with the coarsest
+    // preview: the full resolution data are read concurrently afterwards
+    previewBinning = vtkSlicerAstroVolumeLogic::BinningMask;
+    }
+  else if (properties.contains("progressive") && properties["progressive"].toBool() &&
+           !binningRequested)
+    {
+    qint64 fileSize = QFileInfo(fileName).size();
+    if (fileSize > ProgressivePreviewSize)
+      {
+      previewBinning = static_cast<int>(ceil(pow(static_cast<double>(fileSize) /
+                                                 ProgressivePreviewSize, 1. / 3.)));
+      previewBinning = std::min(previewBinning,
+                                static_cast<int>(vtkSlicerAstroVolumeLogic::BinningMask));
+      }
+    }
+  if (previewBinning > 1)
+    {
+    options |= vtkSlicerAstroVolumeLogic::Subsample;
+    options |= previewBinning << vtkSlicerAstroVolumeLogic::BinningXYShift;
+    options |= previewBinning << vtkSlicerAstroVolumeLogic::BinningZShift;
+    }
+
   vtkSmartPointer<vtkStringArray> fileList;
   if (properties.contains("fileNames"))
     {
@@ -185,6 +305,36 @@ bool qSlicerAstroVolumeReader::load(const IOProperties& properties)
         appLogic->PropagateVolumeSelection(); // includes FitSliceToAll by default
         }
       }
+
+    vtkMRMLAstroVolumeStorageNode* storageNode =
+      vtkMRMLAstroVolumeStorageNode::SafeDownCast(node->GetStorageNode());
+    if (previewBinning > 1 && storageNode)
+      {
+      // the full resolution data are read in the background and
+      // replace the preview once the read is over
+      storageNode->SetSubsample(0);
+      storageNode->SetBinning(1, 1, 1);
+      d->QueuedReads.append(node);
+      this->startQueuedReads();
+      d->AsyncReadTimer.start();
+      }
+
+    // the pyramid is built from the full resolution data
+    vtkMRMLAstroVolumeNode* volumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(node);
+    if (properties.contains("pyramid") && properties["pyramid"].toBool() && volumeNode)
+      {
+      if (storageNode && (d->AsyncReads.contains(storageNode) ||
+                          d->QueuedReads.contains(node)))
+        {
+        d->PendingPyramids.append(volumeNode);
+        }
+      else if (volumeNode->BuildPyramidAsync())
+        {
+        d->PyramidBuilds.append(volumeNode);
+        d->AsyncReadTimer.start();
+        }
+      }
+
     this->setLoadedNodes(QStringList(QString(node->GetID())));
     }
   else
@@ -194,3 +344,289 @@ bool qSlicerAstroVolumeReader::load(const IOProperties& properties)
 
   return node != 0;
 }
+
+//-----------------------------------------------------------------------------
+bool qSlicerAstroVolumeReader::loadBatch(const QList<IOProperties>& propertiesList,
+                                         int maximumConcurrentReads,
+                                         int decodeThreadsPerRead)
+{
+  Q_D(qSlicerAstroVolumeReader);
+
+  int previousMaximumConcurrentReads = d->MaximumConcurrentReads;
+  int previousDecodeThreadsPerRead = d->DecodeThreadsPerRead;
+  d->MaximumConcurrentReads = std::max(maximumConcurrentReads, 1);
+  d->DecodeThreadsPerRead = std::max(decodeThreadsPerRead, 0);
+
+  // create the nodes, in order, from the previews
+  bool success = true;
+  QStringList loadedNodes;
+  d->BatchLoading = true;
+  foreach(const IOProperties& properties, propertiesList)
+    {
+    if (this->load(properties))
+      {
+      loadedNodes << this->loadedNodes();
+      }
+    else
+      {
+      success = false;
+      }
+    }
+  d->BatchLoading = false;
+
+  // wait for the full resolution reads: processAsyncReads attaches
+  // them in order and keeps the read slots busy meanwhile
+  this->waitForAsyncReads();
+
+  d->MaximumConcurrentReads = previousMaximumConcurrentReads;
+  d->DecodeThreadsPerRead = previousDecodeThreadsPerRead;
+  this->setLoadedNodes(loadedNodes);
+
+  return success;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::waitForAsyncReads()
+{
+  Q_D(qSlicerAstroVolumeReader);
+
+  if (d->AsyncReads.isEmpty() && d->QueuedReads.isEmpty())
+    {
+    return;
+    }
+
+  QEventLoop loop;
+  this->connect(this, SIGNAL(asyncReadsFinished()), &loop, SLOT(quit()));
+  d->AsyncReadTimer.start();
+  loop.exec(QEventLoop::ExcludeUserInputEvents);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::setMRMLScene(vtkMRMLScene* scene)
+{
+  this->qvtkReconnect(this->mrmlScene(), scene, vtkMRMLScene::StartImportEvent,
+                      this, SLOT(onSceneImportStarted()));
+  this->qvtkReconnect(this->mrmlScene(), scene, vtkMRMLScene::EndImportEvent,
+                      this, SLOT(onSceneImportEnded()));
+  this->Superclass::setMRMLScene(scene);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::setDeferSceneReads(bool defer)
+{
+  Q_D(qSlicerAstroVolumeReader);
+  d->DeferSceneReads = defer;
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerAstroVolumeReader::deferSceneReads()const
+{
+  Q_D(const qSlicerAstroVolumeReader);
+  return d->DeferSceneReads;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::onSceneImportStarted()
+{
+  Q_D(qSlicerAstroVolumeReader);
+  vtkMRMLAstroVolumeStorageNode::SetDeferReadsOnImport(d->DeferSceneReads);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::onSceneImportEnded()
+{
+  Q_D(qSlicerAstroVolumeReader);
+
+  // the deferral applies to one import only
+  vtkMRMLAstroVolumeStorageNode::SetDeferReadsOnImport(false);
+  d->DeferSceneReads = false;
+
+  vtkMRMLScene* scene = this->mrmlScene();
+  if (!scene)
+    {
+    return;
+    }
+
+  std::vector<vtkMRMLNode*> volumeNodes;
+  scene->GetNodesByClass("vtkMRMLVolumeNode", volumeNodes);
+  for (size_t i = 0; i < volumeNodes.size(); i++)
+    {
+    vtkMRMLVolumeNode* node = vtkMRMLVolumeNode::SafeDownCast(volumeNodes[i]);
+    vtkMRMLAstroVolumeStorageNode* storageNode = node ?
+      vtkMRMLAstroVolumeStorageNode::SafeDownCast(node->GetStorageNode()) : 0;
+    if (storageNode && storageNode->GetReadDeferred())
+      {
+      storageNode->SetReadDeferred(0);
+      d->QueuedReads.append(node);
+      }
+    }
+
+  // the reads are attached by processAsyncReads, asyncReadsFinished
+  // is emitted once all the deferred volumes have their data
+  this->startQueuedReads();
+  if (!d->AsyncReads.isEmpty() || !d->QueuedReads.isEmpty())
+    {
+    d->AsyncReadTimer.start();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::startQueuedReads()
+{
+  Q_D(qSlicerAstroVolumeReader);
+
+  int runningReads = 0;
+  foreach(vtkMRMLAstroVolumeStorageNode* storageNode, d->AsyncReads)
+    {
+    if (storageNode && storageNode->IsAsyncReadRunning())
+      {
+      runningReads++;
+      }
+    }
+
+  while (runningReads < d->MaximumConcurrentReads && !d->QueuedReads.isEmpty())
+    {
+    vtkMRMLVolumeNode* node = d->QueuedReads.takeFirst();
+    vtkMRMLAstroVolumeStorageNode* storageNode = node ?
+      vtkMRMLAstroVolumeStorageNode::SafeDownCast(node->GetStorageNode()) : 0;
+    if (!storageNode)
+      {
+      continue;
+      }
+
+    // by default the processors are shared among the concurrent reads
+    int decodeThreads = d->DecodeThreadsPerRead;
+    if (decodeThreads <= 0)
+      {
+      decodeThreads = std::max(vtkMultiThreader::GetGlobalDefaultNumberOfThreads() /
+                               d->MaximumConcurrentReads, 1);
+      }
+    storageNode->SetNumberOfReadThreads(decodeThreads);
+    if (storageNode->ReadDataAsync(node))
+      {
+      d->AsyncReads.append(storageNode);
+      runningReads++;
+      }
+    else
+      {
+      qCritical() << Q_FUNC_INFO << ": failed to read the full resolution data of "
+                  << storageNode->GetFileName();
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeReader::processAsyncReads()
+{
+  Q_D(qSlicerAstroVolumeReader);
+
+  QStringList messages;
+  const bool readsRunning = !d->AsyncReads.isEmpty() || !d->QueuedReads.isEmpty();
+  bool refitViews = false;
+  // finished reads are attached in the order they were started, so that
+  // batched loads fill the nodes in a deterministic order
+  bool attach = true;
+  QMutableListIterator<vtkWeakPointer<vtkMRMLAstroVolumeStorageNode> > it(d->AsyncReads);
+  while (it.hasNext())
+    {
+    vtkMRMLAstroVolumeStorageNode* storageNode = it.next();
+    if (!storageNode)
+      {
+      it.remove();
+      continue;
+      }
+
+    QString fileName = QFileInfo(storageNode->GetFileName()).fileName();
+    if (storageNode->IsAsyncReadRunning())
+      {
+      attach = false;
+      messages << QString("Loading %1 : %2%").arg(fileName)
+                  .arg(static_cast<int>(storageNode->GetAsyncReadProgress() * 100.));
+      continue;
+      }
+    if (!attach)
+      {
+      continue;
+      }
+    int state = storageNode->ProcessAsyncRead();
+    // later reads of the node decode with all the processors again
+    storageNode->SetNumberOfReadThreads(0);
+    if (state == vtkMRMLAstroVolumeStorageNode::AsyncReadFailed)
+      {
+      qCritical() << Q_FUNC_INFO << ": failed to read the full resolution data of "
+                  << fileName;
+      }
+    else if (state == vtkMRMLAstroVolumeStorageNode::AsyncReadDone)
+      {
+      // the binned preview has unit spacing, hence the views were fitted
+      // to a volume smaller than the full resolution one
+      refitViews = true;
+      }
+    QMutableListIterator<vtkWeakPointer<vtkMRMLAstroVolumeNode> > pendingIt(d->PendingPyramids);
+    while (pendingIt.hasNext())
+      {
+      vtkMRMLAstroVolumeNode* volumeNode = pendingIt.next();
+      if (!volumeNode || volumeNode->GetStorageNode() != storageNode)
+        {
+        continue;
+        }
+      if (state == vtkMRMLAstroVolumeStorageNode::AsyncReadDone &&
+          volumeNode->BuildPyramidAsync())
+        {
+        d->PyramidBuilds.append(volumeNode);
+        }
+      pendingIt.remove();
+      }
+    it.remove();
+    }
+
+  vtkSlicerApplicationLogic* appLogic =
+    d->Logic ? d->Logic->GetApplicationLogic() : 0;
+  if (refitViews && appLogic)
+    {
+    appLogic->FitSliceToAll();
+    }
+
+  this->startQueuedReads();
+  if (!d->QueuedReads.isEmpty())
+    {
+    messages << QString("%1 files queued").arg(d->QueuedReads.size());
+    }
+
+  QMutableListIterator<vtkWeakPointer<vtkMRMLAstroVolumeNode> > pyramidIt(d->PyramidBuilds);
+  while (pyramidIt.hasNext())
+    {
+    vtkMRMLAstroVolumeNode* volumeNode = pyramidIt.next();
+    if (!volumeNode)
+      {
+      pyramidIt.remove();
+      continue;
+      }
+    if (volumeNode->ProcessPyramidBuild() == vtkMRMLAstroVolumeNode::PyramidBuildRunning)
+      {
+      messages << QString("Building the pyramid of %1").arg(volumeNode->GetName());
+      continue;
+      }
+    pyramidIt.remove();
+    }
+
+  if (d->AsyncReads.isEmpty() && d->QueuedReads.isEmpty() && d->PyramidBuilds.isEmpty())
+    {
+    d->AsyncReadTimer.stop();
+    }
+  if (readsRunning && d->AsyncReads.isEmpty() && d->QueuedReads.isEmpty())
+    {
+    emit asyncReadsFinished();
+    }
+
+  qSlicerApplication* app = qSlicerApplication::application();
+  QMainWindow* mainWindow = app ? app->mainWindow() : 0;
+  if (mainWindow && messages.isEmpty())
+    {
+    mainWindow->statusBar()->clearMessage();
+    }
+  else if (mainWindow)
+    {
+    mainWindow->statusBar()->showMessage(messages.join("; "));
+    }
+}
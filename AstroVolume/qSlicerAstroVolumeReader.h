@@ -20,12 +20,16 @@
 #ifndef __qSlicerAstroVolumeReader_h
 #define __qSlicerAstroVolumeReader_h
 
+// CTK includes
+#include <ctkVTKObject.h>
+
 // SlicerQt includes
 #include "qSlicerFileReader.h"
 
 #include "qSlicerAstroVolumeModuleExport.h"
 
 class qSlicerAstroVolumeReaderPrivate;
+class vtkMRMLScene;
 class vtkSlicerVolumesLogic;
 
 /// \ingroup Slicer_QtModules_AstroVolume
@@ -33,6 +37,7 @@ class Q_SLICER_QTMODULES_ASTROVOLUME_EXPORT qSlicerAstroVolumeReader
   : public qSlicerFileReader
 {
   Q_OBJECT
+  QVTK_OBJECT
 public:
   typedef qSlicerFileReader Superclass;
   qSlicerAstroVolumeReader(QObject* parent = 0);
@@ -47,8 +52,61 @@ public:
   virtual QStringList extensions()const;
   virtual qSlicerIOOptions* options()const;
 
+  /// Load a file. With the "batch" property (set by the options widget,
+  /// i.e. for the files of the Add Data dialog and of drag and drop) the
+  /// file joins the batched loads of loadBatch: the node is created from
+  /// a coarse preview and the full resolution data are read concurrently
+  /// with the other files of the request.
   virtual bool load(const IOProperties& properties);
+
+  /// Load several files in one request. The nodes are created in the
+  /// order of propertiesList from a coarse preview of each file, then the
+  /// full resolution data are read concurrently: at most
+  /// maximumConcurrentReads files at a time (I/O), each one decoded with
+  /// decodeThreadsPerRead threads (0 shares the processors among the
+  /// concurrent reads). The data
+  /// are attached to the nodes in the order of propertiesList and the
+  /// method returns once all the reads are over.
+  Q_INVOKABLE bool loadBatch(const QList<IOProperties>& propertiesList,
+                             int maximumConcurrentReads = 4,
+                             int decodeThreadsPerRead = 0);
+
+  /// Observe the imports of the scene (see setDeferSceneReads)
+  virtual void setMRMLScene(vtkMRMLScene* scene);
+
+  /// Batch the next scene import: the AstroVolume storage nodes do not
+  /// read during the import (see
+  /// vtkMRMLAstroVolumeStorageNode::SetDeferReadsOnImport) and the
+  /// deferred volumes are read concurrently once it ends. The volumes
+  /// have no image data until asyncReadsFinished is emitted. The option
+  /// is reset when the import ends. Default is false.
+  Q_INVOKABLE void setDeferSceneReads(bool defer);
+  bool deferSceneReads()const;
+
+signals:
+  /// Emitted when the last running or queued full resolution read
+  /// has been attached to its node
+  void asyncReadsFinished();
+
+protected slots:
+  /// Poll the background reads started by progressive loads
+  /// and the background builds of the pyramids
+  void processAsyncReads();
+
+  /// Enable the deferred reads for the import if requested
+  void onSceneImportStarted();
+
+  /// Queue the reads deferred by a scene import and start them
+  void onSceneImportEnded();
+
 protected:
+  /// Start the queued full resolution reads, up to the concurrency limit
+  void startQueuedReads();
+
+  /// Run an event loop (without user input) until the running
+  /// and queued full resolution reads are over
+  void waitForAsyncReads();
+
   QScopedPointer<qSlicerAstroVolumeReaderPrivate> d_ptr;
 
 private:
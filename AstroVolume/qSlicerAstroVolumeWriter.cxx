@@ -0,0 +1,181 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QFileInfo>
+#include <QMainWindow>
+#include <QStatusBar>
+#include <QTimer>
+
+// SlicerQt includes
+#include "qSlicerApplication.h"
+#include "qSlicerAstroVolumeWriter.h"
+
+// AstroVolume includes
+#include "qSlicerAstroVolumeWriterOptionsWidget.h"
+
+// MRML includes
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLStorableNode.h>
+
+// VTK includes
+#include <vtkWeakPointer.h>
+
+//-----------------------------------------------------------------------------
+class qSlicerAstroVolumeWriterPrivate
+{
+  public:
+  /// storage nodes writing in the background
+  QList<vtkWeakPointer<vtkMRMLAstroVolumeStorageNode> > AsyncWrites;
+  QTimer AsyncWriteTimer;
+};
+
+//-----------------------------------------------------------------------------
+qSlicerAstroVolumeWriter::qSlicerAstroVolumeWriter(const QString& description,
+                                                   const qSlicerIO::IOFileType& fileType,
+                                                   const QStringList& nodeTags,
+                                                   bool useCompression,
+                                                   QObject* _parent)
+  : Superclass(description, fileType, nodeTags, useCompression, _parent)
+  , d_ptr(new qSlicerAstroVolumeWriterPrivate)
+{
+  Q_D(qSlicerAstroVolumeWriter);
+  d->AsyncWriteTimer.setInterval(200);
+  this->connect(&d->AsyncWriteTimer, SIGNAL(timeout()), this, SLOT(processAsyncWrites()));
+}
+
+//-----------------------------------------------------------------------------
+qSlicerAstroVolumeWriter::~qSlicerAstroVolumeWriter()
+{
+  this->waitForBackgroundWrites();
+}
+
+//-----------------------------------------------------------------------------
+qSlicerIOOptions* qSlicerAstroVolumeWriter::options()const
+{
+  return new qSlicerAstroVolumeWriterOptionsWidget;
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerAstroVolumeWriter::write(const qSlicerIO::IOProperties& properties)
+{
+  Q_D(qSlicerAstroVolumeWriter);
+
+  vtkMRMLStorableNode* node = vtkMRMLStorableNode::SafeDownCast(
+    this->getNodeByID(properties["nodeID"].toString().toLatin1().data()));
+  bool background = properties.value("background", false).toBool();
+
+  vtkMRMLAstroVolumeStorageNode* storageNode = NULL;
+  if (node)
+    {
+    if (!node->GetStorageNode() && background)
+      {
+      node->AddDefaultStorageNode();
+      }
+    storageNode = vtkMRMLAstroVolumeStorageNode::SafeDownCast(node->GetStorageNode());
+    }
+  if (storageNode)
+    {
+    storageNode->SetWriteInBackground(background);
+    }
+
+  bool res = this->Superclass::write(properties);
+
+  if (storageNode)
+    {
+    storageNode->SetWriteInBackground(0);
+    if (storageNode->IsAsyncWriteRunning() && !d->AsyncWrites.contains(storageNode))
+      {
+      d->AsyncWrites.append(storageNode);
+      }
+    if (!d->AsyncWrites.isEmpty() && !d->AsyncWriteTimer.isActive())
+      {
+      d->AsyncWriteTimer.start();
+      }
+    }
+
+  return res;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeWriter::waitForBackgroundWrites()
+{
+  Q_D(qSlicerAstroVolumeWriter);
+
+  foreach(vtkMRMLAstroVolumeStorageNode* storageNode, d->AsyncWrites)
+    {
+    if (storageNode &&
+        storageNode->WaitForAsyncWrite() == vtkMRMLAstroVolumeStorageNode::AsyncWriteFailed)
+      {
+      qCritical() << Q_FUNC_INFO << ": failed to write "
+                  << QFileInfo(storageNode->GetFileName()).fileName();
+      }
+    }
+  d->AsyncWrites.clear();
+  d->AsyncWriteTimer.stop();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeWriter::processAsyncWrites()
+{
+  Q_D(qSlicerAstroVolumeWriter);
+
+  QStringList messages;
+  QMutableListIterator<vtkWeakPointer<vtkMRMLAstroVolumeStorageNode> > it(d->AsyncWrites);
+  while (it.hasNext())
+    {
+    vtkMRMLAstroVolumeStorageNode* storageNode = it.next();
+    if (!storageNode)
+      {
+      it.remove();
+      continue;
+      }
+
+    QString fileName = QFileInfo(storageNode->GetFileName()).fileName();
+    int state = storageNode->ProcessAsyncWrite();
+    if (state == vtkMRMLAstroVolumeStorageNode::AsyncWriteRunning)
+      {
+      messages << QString("Saving %1 : %2%").arg(fileName)
+                  .arg(static_cast<int>(storageNode->GetAsyncWriteProgress() * 100.));
+      continue;
+      }
+    if (state == vtkMRMLAstroVolumeStorageNode::AsyncWriteFailed)
+      {
+      qCritical() << Q_FUNC_INFO << ": failed to write " << fileName;
+      }
+    it.remove();
+    }
+
+  if (d->AsyncWrites.isEmpty())
+    {
+    d->AsyncWriteTimer.stop();
+    }
+
+  qSlicerApplication* app = qSlicerApplication::application();
+  QMainWindow* mainWindow = app ? app->mainWindow() : 0;
+  if (mainWindow && messages.isEmpty())
+    {
+    mainWindow->statusBar()->clearMessage();
+    }
+  else if (mainWindow)
+    {
+    mainWindow->statusBar()->showMessage(messages.join("; "));
+    }
+}
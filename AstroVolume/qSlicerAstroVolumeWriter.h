@@ -0,0 +1,70 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __qSlicerAstroVolumeWriter_h
+#define __qSlicerAstroVolumeWriter_h
+
+// SlicerQt includes
+#include "qSlicerNodeWriter.h"
+
+#include "qSlicerAstroVolumeModuleExport.h"
+
+class qSlicerAstroVolumeWriterPrivate;
+
+/// \ingroup Slicer_QtModules_AstroVolume
+///
+/// Node writer of the AstroVolumes. If the "background" property is true
+/// (the Background option of the save dialog) the FITS file is written on
+/// a worker thread (see vtkMRMLAstroVolumeStorageNode::SetWriteInBackground):
+/// write returns once the write is started, the progress of the write is
+/// shown in the status bar and its failure is reported when it is over.
+class Q_SLICER_QTMODULES_ASTROVOLUME_EXPORT qSlicerAstroVolumeWriter
+  : public qSlicerNodeWriter
+{
+  Q_OBJECT
+public:
+  typedef qSlicerNodeWriter Superclass;
+  qSlicerAstroVolumeWriter(const QString& description,
+                           const qSlicerIO::IOFileType& fileType,
+                           const QStringList& nodeTags,
+                           bool useCompression,
+                           QObject* parent = 0);
+  virtual ~qSlicerAstroVolumeWriter();
+
+  /// Compression and background write options
+  virtual qSlicerIOOptions* options()const;
+
+  virtual bool write(const qSlicerIO::IOProperties& properties);
+
+  /// Block until all the background writes are over
+  Q_INVOKABLE void waitForBackgroundWrites();
+
+protected slots:
+  /// Poll the background writes
+  void processAsyncWrites();
+
+protected:
+  QScopedPointer<qSlicerAstroVolumeWriterPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qSlicerAstroVolumeWriter);
+  Q_DISABLE_COPY(qSlicerAstroVolumeWriter);
+};
+
+#endif
@@ -0,0 +1,563 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// vtkFits includes
+#include <vtkFITSBrickCache.h>
+#include <vtkFITSReader.h>
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtksys/SystemTools.hxx>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkFITSBrickCache);
+
+namespace
+{
+//----------------------------------------------------------------------------
+const char SidecarMagic[8] = {'S', 'A', 'B', 'R', 'I', 'C', 'K', '1'};
+const int SidecarByteOrder = 0x01020304;
+
+//----------------------------------------------------------------------------
+// Upper bound (in bytes) of the slab read by Build at once
+const size_t BuildSlabSize = 256 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+struct SidecarHeader
+{
+  char Magic[8];
+  int ByteOrder;
+  int Dimensions[3];
+  int BrickSize;
+  int Reserved;
+  long long SourceSize;
+  long long SourceTime;
+};
+
+//----------------------------------------------------------------------------
+void GetSourceStamp(const char *fileName, long long &size, long long &time)
+{
+  size = static_cast<long long>(vtksys::SystemTools::FileLength(fileName));
+  time = static_cast<long long>(vtksys::SystemTools::ModifiedTime(fileName));
+}
+
+//----------------------------------------------------------------------------
+// Copy the brick with corner (origin[0], origin[1]) of a slab of
+// slabDims voxels in brick, padding with NaN outside of the slab.
+template <typename T> void CopyBrick(const T *slab, const int slabDims[3],
+                                     const int origin[2], int brickSize,
+                                     float *brick, double &min, double &max,
+                                     vtkIdType &nanCount)
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::fill(brick, brick + (size_t) brickSize * brickSize * brickSize, nan);
+  min = std::numeric_limits<double>::max();
+  max = -std::numeric_limits<double>::max();
+  nanCount = 0;
+
+  const int nx = std::min(brickSize, slabDims[0] - origin[0]);
+  const int ny = std::min(brickSize, slabDims[1] - origin[1]);
+  const int nz = std::min(brickSize, slabDims[2]);
+  for (int k = 0; k < nz; k++)
+    {
+    for (int j = 0; j < ny; j++)
+      {
+      const T *row = slab + ((vtkIdType) k * slabDims[1] + origin[1] + j) * slabDims[0] + origin[0];
+      float *brickRow = brick + ((vtkIdType) k * brickSize + j) * brickSize;
+      for (int i = 0; i < nx; i++)
+        {
+        const float value = static_cast<float>(*(row + i));
+        *(brickRow + i) = value;
+        if (value != value)
+          {
+          nanCount++;
+          continue;
+          }
+        min = std::min(min, (double) value);
+        max = std::max(max, (double) value);
+        }
+      }
+    }
+}
+}//end namespace
+
+//----------------------------------------------------------------------------
+vtkFITSBrickCache::vtkFITSBrickCache()
+{
+  this->BrickSize = 64;
+  this->MemoryBudget = 1024;
+  this->DataOffset = 0;
+  this->UseCounter = 0;
+  for (int i = 0; i < 3; i++)
+    {
+    this->Dimensions[i] = 0;
+    this->BrickDimensions[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkFITSBrickCache::~vtkFITSBrickCache()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkFITSBrickCache::GetSidecarFileName(const char *fitsFileName)
+{
+  return std::string(fitsFileName ? fitsFileName : "") + ".bricks";
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSBrickCache::SetMemoryBudget(int memoryBudget)
+{
+  memoryBudget = std::max(memoryBudget, 1);
+  if (this->MemoryBudget == memoryBudget)
+    {
+    return;
+    }
+  this->MemoryBudget = memoryBudget;
+  this->EvictBricks(0);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSBrickCache::Build(vtkFITSReader *reader, const char *sidecarFileName)
+{
+  if (!reader || !reader->GetFileName() || !sidecarFileName)
+    {
+    vtkErrorMacro("vtkFITSBrickCache::Build : reader or file names not set.");
+    return false;
+    }
+
+  int *binning = reader->GetBinning();
+  if (binning[0] > 1 || binning[1] > 1 || binning[2] > 1)
+    {
+    vtkErrorMacro("vtkFITSBrickCache::Build : the reader can not be binned.");
+    return false;
+    }
+
+  // the reader outputs only the slab of planes requested
+  int readUpdateExtent = reader->GetReadUpdateExtent();
+  reader->ReadUpdateExtentOn();
+  reader->UpdateInformation();
+
+  int wholeExtent[6];
+  reader->GetOutputInformation(0)->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+
+  SidecarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.Magic, SidecarMagic, sizeof(SidecarMagic));
+  header.ByteOrder = SidecarByteOrder;
+  header.BrickSize = this->BrickSize;
+  GetSourceStamp(reader->GetFileName(), header.SourceSize, header.SourceTime);
+
+  int brickDims[3];
+  for (int i = 0; i < 3; i++)
+    {
+    header.Dimensions[i] = wholeExtent[2 * i + 1] - wholeExtent[2 * i] + 1;
+    brickDims[i] = (header.Dimensions[i] + this->BrickSize - 1) / this->BrickSize;
+    }
+  const int numBricks = brickDims[0] * brickDims[1] * brickDims[2];
+
+  std::string tempFileName = std::string(sidecarFileName) + ".tmp";
+  std::ofstream out(tempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out)
+    {
+    vtkErrorMacro("vtkFITSBrickCache::Build : could not write " << tempFileName);
+    reader->SetReadUpdateExtent(readUpdateExtent);
+    return false;
+    }
+
+  std::vector<BrickInfo> bricks(numBricks);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(&bricks[0]), numBricks * sizeof(BrickInfo));
+
+  // The slab read at once is BrickSize planes by as many rows of bricks
+  // as fit in BuildSlabSize (at least one row of bricks, i.e. BrickSize
+  // rows of each plane): the Y-limited extents are read through
+  // fits_read_subset, so the memory used does not grow with the planes.
+  const int brickSize = this->BrickSize;
+  const size_t brickRowSize = (size_t) header.Dimensions[0] * brickSize *
+                              brickSize * sizeof(double);
+  const int slabBrickRows = static_cast<int>(std::max<size_t>(1, std::min<size_t>
+    (brickDims[1], BuildSlabSize / std::max<size_t>(brickRowSize, 1))));
+  std::vector<float> brick((size_t) brickSize * brickSize * brickSize);
+  bool failed = false;
+  for (int kz = 0; kz < brickDims[2] && !failed; kz++)
+    {
+    for (int kySlab = 0; kySlab < brickDims[1] && !failed; kySlab += slabBrickRows)
+      {
+      const int kyLast = std::min(kySlab + slabBrickRows, brickDims[1]) - 1;
+      int slabExtent[6] = {wholeExtent[0], wholeExtent[1],
+                           wholeExtent[2] + kySlab * brickSize,
+                           std::min(wholeExtent[2] + (kyLast + 1) * brickSize - 1, wholeExtent[3]),
+                           wholeExtent[4] + kz * brickSize,
+                           std::min(wholeExtent[4] + (kz + 1) * brickSize - 1, wholeExtent[5])};
+      reader->UpdateExtent(slabExtent);
+      vtkDataArray *scalars = reader->GetOutput()->GetPointData()->GetScalars();
+      if (!scalars)
+        {
+        failed = true;
+        break;
+        }
+
+      int slabDims[3];
+      reader->GetOutput()->GetDimensions(slabDims);
+      for (int ky = kySlab; ky <= kyLast && !failed; ky++)
+        {
+        for (int kx = 0; kx < brickDims[0]; kx++)
+          {
+          const int origin[2] = {kx * brickSize, (ky - kySlab) * brickSize};
+          BrickInfo &info = bricks[(kz * brickDims[1] + ky) * brickDims[0] + kx];
+          switch (scalars->GetDataType())
+            {
+            case VTK_DOUBLE:
+              CopyBrick(static_cast<double*>(scalars->GetVoidPointer(0)), slabDims, origin,
+                        brickSize, &brick[0], info.Minimum, info.Maximum, info.NaNCount);
+              break;
+            case VTK_FLOAT:
+              CopyBrick(static_cast<float*>(scalars->GetVoidPointer(0)), slabDims, origin,
+                        brickSize, &brick[0], info.Minimum, info.Maximum, info.NaNCount);
+              break;
+            case VTK_INT:
+              CopyBrick(static_cast<int*>(scalars->GetVoidPointer(0)), slabDims, origin,
+                        brickSize, &brick[0], info.Minimum, info.Maximum, info.NaNCount);
+              break;
+            case VTK_SHORT:
+              CopyBrick(static_cast<short*>(scalars->GetVoidPointer(0)), slabDims, origin,
+                        brickSize, &brick[0], info.Minimum, info.Maximum, info.NaNCount);
+              break;
+            case VTK_UNSIGNED_CHAR:
+              CopyBrick(static_cast<unsigned char*>(scalars->GetVoidPointer(0)), slabDims, origin,
+                        brickSize, &brick[0], info.Minimum, info.Maximum, info.NaNCount);
+              break;
+            default:
+              vtkErrorMacro("vtkFITSBrickCache::Build : data type not allowed.");
+              failed = true;
+              break;
+            }
+          if (failed)
+            {
+            break;
+            }
+          out.write(reinterpret_cast<const char*>(&brick[0]), brick.size() * sizeof(float));
+          }
+        }
+
+      double progress = static_cast<double>(kz * brickDims[1] + kyLast + 1) /
+                        ((double) brickDims[2] * brickDims[1]);
+      this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+      }
+    }
+
+  // the statistics are known only at the end
+  out.seekp(sizeof(header));
+  out.write(reinterpret_cast<const char*>(&bricks[0]), numBricks * sizeof(BrickInfo));
+  failed = failed || !out.good();
+  out.close();
+
+  reader->SetReadUpdateExtent(readUpdateExtent);
+
+  if (failed || !vtksys::SystemTools::RenameFile(tempFileName.c_str(), sidecarFileName))
+    {
+    vtkErrorMacro("vtkFITSBrickCache::Build : failed to write " << sidecarFileName);
+    vtksys::SystemTools::RemoveFile(tempFileName);
+    return false;
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSBrickCache::Open(const char *sidecarFileName, const char *fitsFileName)
+{
+  this->Close();
+
+  if (!sidecarFileName || !vtksys::SystemTools::FileExists(sidecarFileName, true))
+    {
+    return false;
+    }
+
+  this->File.open(sidecarFileName, std::ios::in | std::ios::binary);
+  SidecarHeader header;
+  if (!this->File.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      memcmp(header.Magic, SidecarMagic, sizeof(SidecarMagic)) ||
+      header.ByteOrder != SidecarByteOrder || header.BrickSize < 1)
+    {
+    vtkWarningMacro("vtkFITSBrickCache::Open : " << sidecarFileName << " is not a valid sidecar.");
+    this->Close();
+    return false;
+    }
+
+  if (fitsFileName)
+    {
+    long long size, time;
+    GetSourceStamp(fitsFileName, size, time);
+    if (size != header.SourceSize || time != header.SourceTime)
+      {
+      vtkDebugMacro("vtkFITSBrickCache::Open : " << sidecarFileName << " is out of date.");
+      this->Close();
+      return false;
+      }
+    }
+
+  this->BrickSize = header.BrickSize;
+  for (int i = 0; i < 3; i++)
+    {
+    this->Dimensions[i] = header.Dimensions[i];
+    this->BrickDimensions[i] = (header.Dimensions[i] + header.BrickSize - 1) / header.BrickSize;
+    }
+
+  this->Bricks.resize(this->GetNumberOfBricks());
+  if (this->Bricks.empty() ||
+      !this->File.read(reinterpret_cast<char*>(&this->Bricks[0]),
+                       this->Bricks.size() * sizeof(BrickInfo)))
+    {
+    vtkWarningMacro("vtkFITSBrickCache::Open : " << sidecarFileName << " is truncated.");
+    this->Close();
+    return false;
+    }
+  this->DataOffset = sizeof(header) + this->Bricks.size() * sizeof(BrickInfo);
+  this->FITSFileName = fitsFileName ? fitsFileName : "";
+
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSBrickCache::Close()
+{
+  if (this->File.is_open())
+    {
+    this->File.close();
+    }
+  this->File.clear();
+  this->FITSFileName.clear();
+  this->Bricks.clear();
+  this->ResidentBricks.clear();
+  this->DataOffset = 0;
+  for (int i = 0; i < 3; i++)
+    {
+    this->Dimensions[i] = 0;
+    this->BrickDimensions[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSBrickCache::IsOpen()
+{
+  return this->File.is_open() && !this->Bricks.empty();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkFITSBrickCache::GetFITSFileName()
+{
+  return this->FITSFileName.c_str();
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSBrickCache::GetNumberOfBricks()
+{
+  return this->BrickDimensions[0] * this->BrickDimensions[1] * this->BrickDimensions[2];
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSBrickCache::GetBrickMinimum(int brick)
+{
+  return brick >= 0 && brick < (int) this->Bricks.size() ? this->Bricks[brick].Minimum : 0.;
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSBrickCache::GetBrickMaximum(int brick)
+{
+  return brick >= 0 && brick < (int) this->Bricks.size() ? this->Bricks[brick].Maximum : 0.;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkFITSBrickCache::GetBrickNaNCount(int brick)
+{
+  return brick >= 0 && brick < (int) this->Bricks.size() ? this->Bricks[brick].NaNCount : 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSBrickCache::GetRange(double range[2])
+{
+  range[0] = std::numeric_limits<double>::max();
+  range[1] = -std::numeric_limits<double>::max();
+  for (size_t brick = 0; brick < this->Bricks.size(); brick++)
+    {
+    // bricks made only of blank voxels have an empty range
+    if (this->Bricks[brick].Minimum > this->Bricks[brick].Maximum)
+      {
+      continue;
+      }
+    range[0] = std::min(range[0], this->Bricks[brick].Minimum);
+    range[1] = std::max(range[1], this->Bricks[brick].Maximum);
+    }
+
+  if (range[0] > range[1])
+    {
+    range[0] = 0.;
+    range[1] = 0.;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkFITSBrickCache::GetBrickVoxels()
+{
+  return (vtkIdType) this->BrickSize * this->BrickSize * this->BrickSize;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkFITSBrickCache::GetResidentMemory()
+{
+  return (vtkIdType) this->ResidentBricks.size() * this->GetBrickVoxels() * sizeof(float);
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSBrickCache::EvictBricks(vtkIdType reserve)
+{
+  const double budget = this->MemoryBudget * 1024. * 1024.;
+  while (!this->ResidentBricks.empty() && this->GetResidentMemory() + reserve > budget)
+    {
+    std::map<int, ResidentBrick>::iterator oldest = this->ResidentBricks.begin();
+    for (std::map<int, ResidentBrick>::iterator it = this->ResidentBricks.begin();
+         it != this->ResidentBricks.end(); ++it)
+      {
+      if (it->second.LastUse < oldest->second.LastUse)
+        {
+        oldest = it;
+        }
+      }
+    this->ResidentBricks.erase(oldest);
+    }
+}
+
+//----------------------------------------------------------------------------
+const float* vtkFITSBrickCache::GetBrick(int i, int j, int k)
+{
+  if (!this->IsOpen() ||
+      i < 0 || i >= this->BrickDimensions[0] ||
+      j < 0 || j >= this->BrickDimensions[1] ||
+      k < 0 || k >= this->BrickDimensions[2])
+    {
+    return NULL;
+    }
+
+  const int index = (k * this->BrickDimensions[1] + j) * this->BrickDimensions[0] + i;
+  std::map<int, ResidentBrick>::iterator it = this->ResidentBricks.find(index);
+  if (it != this->ResidentBricks.end())
+    {
+    it->second.LastUse = ++this->UseCounter;
+    return &it->second.Voxels[0];
+    }
+
+  const vtkIdType numVoxels = this->GetBrickVoxels();
+  this->EvictBricks(numVoxels * sizeof(float));
+
+  ResidentBrick &brick = this->ResidentBricks[index];
+  brick.LastUse = ++this->UseCounter;
+  brick.Voxels.resize(numVoxels);
+  this->File.seekg(this->DataOffset + (std::streamoff) index * numVoxels * sizeof(float));
+  if (!this->File.read(reinterpret_cast<char*>(&brick.Voxels[0]), numVoxels * sizeof(float)))
+    {
+    vtkErrorMacro("vtkFITSBrickCache::GetBrick : failed to read brick " << index);
+    this->File.clear();
+    this->ResidentBricks.erase(index);
+    return NULL;
+    }
+
+  return &brick.Voxels[0];
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSBrickCache::ReadExtent(const int extent[6], float *out)
+{
+  for (int i = 0; i < 3; i++)
+    {
+    if (extent[2 * i] < 0 || extent[2 * i + 1] >= this->Dimensions[i] ||
+        extent[2 * i] > extent[2 * i + 1])
+      {
+      vtkErrorMacro("vtkFITSBrickCache::ReadExtent : extent out of the cube.");
+      return false;
+      }
+    }
+
+  const int brickSize = this->BrickSize;
+  const int outDims[2] = {extent[1] - extent[0] + 1, extent[3] - extent[2] + 1};
+  for (int bk = extent[4] / brickSize; bk <= extent[5] / brickSize; bk++)
+    {
+    for (int bj = extent[2] / brickSize; bj <= extent[3] / brickSize; bj++)
+      {
+      for (int bi = extent[0] / brickSize; bi <= extent[1] / brickSize; bi++)
+        {
+        const float *brick = this->GetBrick(bi, bj, bk);
+        if (!brick)
+          {
+          return false;
+          }
+
+        // overlap of the brick with the extent
+        const int x0 = std::max(extent[0], bi * brickSize);
+        const int x1 = std::min(extent[1], (bi + 1) * brickSize - 1);
+        const int y0 = std::max(extent[2], bj * brickSize);
+        const int y1 = std::min(extent[3], (bj + 1) * brickSize - 1);
+        const int z0 = std::max(extent[4], bk * brickSize);
+        const int z1 = std::min(extent[5], (bk + 1) * brickSize - 1);
+        for (int z = z0; z <= z1; z++)
+          {
+          for (int y = y0; y <= y1; y++)
+            {
+            const float *brickRow = brick +
+              (((vtkIdType) (z - bk * brickSize) * brickSize + y - bj * brickSize) * brickSize +
+               x0 - bi * brickSize);
+            float *outRow = out +
+              (((vtkIdType) (z - extent[4]) * outDims[1] + y - extent[2]) * outDims[0] + x0 - extent[0]);
+            memcpy(outRow, brickRow, (x1 - x0 + 1) * sizeof(float));
+            }
+          }
+        }
+      }
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSBrickCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "BrickSize: " << this->BrickSize << "\n";
+  os << indent << "MemoryBudget: " << this->MemoryBudget << " MB\n";
+  os << indent << "Dimensions: " << this->Dimensions[0] << " "
+     << this->Dimensions[1] << " " << this->Dimensions[2] << "\n";
+  os << indent << "NumberOfBricks: " << this->GetNumberOfBricks() << "\n";
+  os << indent << "ResidentBricks: " << this->ResidentBricks.size() << "\n";
+}
@@ -0,0 +1,160 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkFITSBrickCache_h
+#define __vtkFITSBrickCache_h
+
+// std includes
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// VTK includes
+#include "vtkObject.h"
+
+#include "vtkFitsWin32Header.h"
+
+class vtkFITSReader;
+
+/// \brief Out-of-core bricked copy of a FITS cube.
+///
+/// The cube is stored in a sidecar file (by default <file>.bricks) as
+/// float bricks of BrickSize^3 voxels (edge bricks are padded with NaN),
+/// together with the minimum, maximum and number of blank voxels of each
+/// brick. The sidecar is written once (Build) streaming the cube through
+/// a vtkFITSReader, in slabs of BrickSize planes limited in Y to the rows
+/// of bricks that fit in 256 MB, so neither the cube nor its planes have
+/// to fit in memory. Afterwards the bricks are paged in on demand and kept
+/// resident in a LRU list under MemoryBudget.
+///
+/// The sidecar is in the byte order of the machine that wrote it and it is
+/// rejected (and rebuilt) if it is older than, or does not match, the FITS
+/// file. The class is not thread safe.
+///
+/// \sa vtkFITSReader
+class VTK_FITS_EXPORT vtkFITSBrickCache : public vtkObject
+{
+public:
+  static vtkFITSBrickCache *New();
+  vtkTypeMacro(vtkFITSBrickCache,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Default sidecar file name of a FITS file
+  static std::string GetSidecarFileName(const char *fitsFileName);
+
+  ///
+  /// Edge (in voxels) of the bricks written by Build. Default is 64.
+  vtkSetClampMacro(BrickSize,int,8,512);
+  vtkGetMacro(BrickSize,int);
+
+  ///
+  /// Memory (in MB) that the resident bricks can use. Default is 1024.
+  void SetMemoryBudget(int memoryBudget);
+  vtkGetMacro(MemoryBudget,int);
+
+  ///
+  /// Write the sidecar of the file of reader. The reader has to be
+  /// configured (scaling, ...) and not binned: its output is the data
+  /// stored in the bricks. The sidecar is written in a temporary file
+  /// and renamed when completed. ProgressEvent is invoked after each
+  /// slab read.
+  bool Build(vtkFITSReader *reader, const char *sidecarFileName);
+
+  ///
+  /// Open the sidecar of fitsFileName. Returns false if it does not
+  /// exist, is not valid or is out of date.
+  bool Open(const char *sidecarFileName, const char *fitsFileName);
+  void Close();
+  bool IsOpen();
+
+  ///
+  /// FITS file passed to Open (empty if none)
+  const char* GetFITSFileName();
+
+  ///
+  /// Dimensions of the cube and number of bricks along each axis
+  vtkGetVector3Macro(Dimensions,int);
+  vtkGetVector3Macro(BrickDimensions,int);
+  int GetNumberOfBricks();
+
+  ///
+  /// Statistics of a brick (index i + j * nbx + k * nbx * nby),
+  /// available without paging the brick in.
+  double GetBrickMinimum(int brick);
+  double GetBrickMaximum(int brick);
+  vtkIdType GetBrickNaNCount(int brick);
+
+  ///
+  /// Range of the whole cube from the brick statistics
+  void GetRange(double range[2]);
+
+  ///
+  /// Page in the brick (i, j, k) and return its voxels (x fastest).
+  /// The pointer is valid until the next call that pages a brick in.
+  const float* GetBrick(int i, int j, int k);
+
+  ///
+  /// Copy the voxels of extent (in IJK of the full cube) in out,
+  /// paging in the bricks that overlap it.
+  bool ReadExtent(const int extent[6], float *out);
+
+  ///
+  /// Memory (in bytes) used by the resident bricks
+  vtkIdType GetResidentMemory();
+
+protected:
+  vtkFITSBrickCache();
+  ~vtkFITSBrickCache();
+
+  struct BrickInfo
+    {
+    double Minimum;
+    double Maximum;
+    vtkIdType NaNCount;
+    };
+
+  struct ResidentBrick
+    {
+    std::vector<float> Voxels;
+    unsigned long LastUse;
+    };
+
+  vtkIdType GetBrickVoxels();
+  void EvictBricks(vtkIdType reserve);
+
+  int BrickSize;
+  int MemoryBudget;
+  int Dimensions[3];
+  int BrickDimensions[3];
+  std::streamoff DataOffset;
+
+  std::ifstream File;
+  std::string FITSFileName;
+  std::vector<BrickInfo> Bricks;
+  std::map<int, ResidentBrick> ResidentBricks;
+  unsigned long UseCounter;
+
+private:
+  vtkFITSBrickCache(const vtkFITSBrickCache&);  /// Not implemented.
+  void operator=(const vtkFITSBrickCache&);  /// Not implemented.
+};
+
+#endif
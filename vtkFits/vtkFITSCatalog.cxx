@@ -0,0 +1,694 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <sstream>
+
+// vtkFits includes
+#include <vtkFITSCatalog.h>
+#include <vtkFITSReader.h>
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkObjectFactory.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkFITSCatalog);
+
+namespace
+{
+//----------------------------------------------------------------------------
+const char IndexMagic[8] = {'S', 'A', 'C', 'A', 'T', 'L', 'G', '2'};
+const int IndexByteOrder = 0x01020304;
+
+//----------------------------------------------------------------------------
+// Number of samples along X and Y used to trace the sky footprint
+const int FootprintSamples = 5;
+
+//----------------------------------------------------------------------------
+template <typename T> T StringToNumber(const char* num)
+{
+  std::stringstream ss;
+  ss << num;
+  T result;
+  return ss >> result ? result : 0;
+}
+
+//----------------------------------------------------------------------------
+std::string IntToString(int Value)
+{
+  std::stringstream strstream;
+  strstream << Value;
+  return strstream.str();
+}
+
+//----------------------------------------------------------------------------
+double HeaderDouble(vtkFITSReader *reader, const std::string &key)
+{
+  const char *value = reader->GetHeaderValue(("SlicerAstro." + key).c_str());
+  return value ? StringToNumber<double>(value) : std::numeric_limits<double>::quiet_NaN();
+}
+
+//----------------------------------------------------------------------------
+std::string HeaderString(vtkFITSReader *reader, const std::string &key)
+{
+  const char *value = reader->GetHeaderValue(("SlicerAstro." + key).c_str());
+  return value ? std::string(value) : std::string();
+}
+
+//----------------------------------------------------------------------------
+void GetSourceStamp(const std::string &fileName, long long &size, long long &time)
+{
+  size = static_cast<long long>(vtksys::SystemTools::FileLength(fileName.c_str()));
+  time = static_cast<long long>(vtksys::SystemTools::ModifiedTime(fileName.c_str()));
+}
+
+//----------------------------------------------------------------------------
+bool IsFITSFile(const std::string &fileName)
+{
+  std::string extension = vtksys::SystemTools::LowerCase
+    (vtksys::SystemTools::GetFilenameLastExtension(fileName));
+  return extension == ".fits" || extension == ".fz";
+}
+
+//----------------------------------------------------------------------------
+// Copy wcs into footprintWCS with the spectral axis converted to optical
+// velocity, the common frame of the spectral footprints. The axis keeps
+// its native type if it can not be converted (e.g. no rest frequency).
+bool CopyFootprintWCS(struct wcsprm *wcs, struct wcsprm *footprintWCS)
+{
+  footprintWCS->flag = -1;
+  if (wcssub(1, wcs, 0x0, 0x0, footprintWCS))
+    {
+    return false;
+    }
+  if (wcsset(footprintWCS))
+    {
+    wcsfree(footprintWCS);
+    return false;
+    }
+
+  int index = footprintWCS->spec;
+  if (index >= 0 && strncmp(footprintWCS->ctype[index], "VOPT", 4))
+    {
+    // wcssptr leaves the axis untouched if it fails
+    char ctypeS[9];
+    strcpy(ctypeS, "VOPT-???");
+    wcssptr(footprintWCS, &index, ctypeS);
+    if (wcsset(footprintWCS))
+      {
+      wcsfree(footprintWCS);
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool IntervalsOverlap(double a0, double a1, double b0, double b1)
+{
+  return a0 <= b1 && b0 <= a1;
+}
+
+//----------------------------------------------------------------------------
+// Intervals in RA can cross 0 (min > max): split them in two
+bool RAOverlap(double a0, double a1, double b0, double b1)
+{
+  double as[2][2] = {{a0, a1}, {0., -1.}};
+  double bs[2][2] = {{b0, b1}, {0., -1.}};
+  if (a0 > a1)
+    {
+    as[0][1] = 360.;
+    as[1][0] = 0.;
+    as[1][1] = a1;
+    }
+  if (b0 > b1)
+    {
+    bs[0][1] = 360.;
+    bs[1][0] = 0.;
+    bs[1][1] = b1;
+    }
+  for (int i = 0; i < 2; i++)
+    {
+    for (int j = 0; j < 2; j++)
+      {
+      if (as[i][0] <= as[i][1] && bs[j][0] <= bs[j][1] &&
+          IntervalsOverlap(as[i][0], as[i][1], bs[j][0], bs[j][1]))
+        {
+        return true;
+        }
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// Smallest RA interval containing all the values: the complement of the
+// largest gap between them on the circle.
+void RARange(std::vector<double> &ras, double &raMin, double &raMax)
+{
+  std::sort(ras.begin(), ras.end());
+  double largestGap = ras.front() + 360. - ras.back();
+  raMin = ras.front();
+  raMax = ras.back();
+  for (size_t i = 1; i < ras.size(); i++)
+    {
+    double gap = ras[i] - ras[i - 1];
+    if (gap > largestGap)
+      {
+      largestGap = gap;
+      raMin = ras[i];
+      raMax = ras[i - 1];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template <typename T> void WriteValue(std::ofstream &out, const T &value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//----------------------------------------------------------------------------
+template <typename T> void ReadValue(std::ifstream &in, T &value)
+{
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+//----------------------------------------------------------------------------
+void WriteString(std::ofstream &out, const std::string &value)
+{
+  unsigned int length = static_cast<unsigned int>(value.size());
+  WriteValue(out, length);
+  out.write(value.data(), length);
+}
+
+//----------------------------------------------------------------------------
+void ReadString(std::ifstream &in, std::string &value)
+{
+  unsigned int length = 0;
+  ReadValue(in, length);
+  if (!in || length > 65536)
+    {
+    in.setstate(std::ios::failbit);
+    return;
+    }
+  value.resize(length);
+  if (length > 0)
+    {
+    in.read(&value[0], length);
+    }
+}
+}//end namespace
+
+//----------------------------------------------------------------------------
+vtkFITSCatalog::vtkFITSCatalog()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkFITSCatalog::~vtkFITSCatalog()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSCatalog::Clear()
+{
+  this->Entries.clear();
+  this->EntryIndex.clear();
+  this->Footprints.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSCatalog::GetNumberOfEntries()
+{
+  return static_cast<int>(this->Entries.size());
+}
+
+//----------------------------------------------------------------------------
+const vtkFITSCatalog::Entry *vtkFITSCatalog::GetEntry(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfEntries())
+    {
+    return NULL;
+    }
+  return &this->Entries[index];
+}
+
+//----------------------------------------------------------------------------
+const vtkFITSCatalog::Entry *vtkFITSCatalog::FindEntry(const char *path)
+{
+  if (!path)
+    {
+    return NULL;
+    }
+  std::map<std::string, int>::iterator it =
+    this->EntryIndex.find(vtksys::SystemTools::CollapseFullPath(path));
+  return it != this->EntryIndex.end() ? &this->Entries[it->second] : NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSCatalog::RebuildIndex()
+{
+  this->EntryIndex.clear();
+  this->Footprints.resize(this->Entries.size() * 6);
+  for (size_t i = 0; i < this->Entries.size(); i++)
+    {
+    const Entry &entry = this->Entries[i];
+    this->EntryIndex[entry.Path] = static_cast<int>(i);
+    double *footprint = &this->Footprints[i * 6];
+    footprint[0] = entry.RAMin;
+    footprint[1] = entry.RAMax;
+    footprint[2] = entry.DecMin;
+    footprint[3] = entry.DecMax;
+    footprint[4] = entry.SpectralMin;
+    footprint[5] = entry.SpectralMax;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSCatalog::ListFiles(const std::string &directory, bool recursive,
+                               std::vector<std::string> &files)
+{
+  vtksys::Directory dir;
+  if (!dir.Load(directory.c_str()))
+    {
+    return;
+    }
+
+  for (unsigned long i = 0; i < dir.GetNumberOfFiles(); i++)
+    {
+    std::string name = dir.GetFile(i);
+    if (name == "." || name == "..")
+      {
+      continue;
+      }
+    std::string path = directory + "/" + name;
+    if (vtksys::SystemTools::FileIsDirectory(path.c_str()))
+      {
+      // symbolic links to directories can make loops
+      if (recursive && !vtksys::SystemTools::FileIsSymlink(path.c_str()))
+        {
+        this->ListFiles(path, recursive, files);
+        }
+      continue;
+      }
+    if (IsFITSFile(name))
+      {
+      files.push_back(path);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSCatalog::ReadEntry(const std::string &path, Entry &entry)
+{
+  vtkFITSReader *reader = vtkFITSReader::New();
+  // a scan parses each file once: do not fill the header cache
+  reader->UseHeaderCacheOff();
+  if (!reader->CanReadFile(path.c_str()))
+    {
+    reader->Delete();
+    return false;
+    }
+  reader->SetFileName(path.c_str());
+  reader->UpdateInformation();
+  if (reader->GetReadStatus() || !reader->GetHeaderValue("SlicerAstro.NAXIS"))
+    {
+    vtkWarningMacro("vtkFITSCatalog::ReadEntry : could not read the header of " << path);
+    reader->Delete();
+    return false;
+    }
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  entry.Path = path;
+  GetSourceStamp(path, entry.Size, entry.MTime);
+  entry.BITPIX = static_cast<int>(HeaderDouble(reader, "BITPIX"));
+  entry.Object = HeaderString(reader, "OBJECT");
+  const int naxis = static_cast<int>(HeaderDouble(reader, "NAXIS"));
+  for (int i = 0; i < 3; i++)
+    {
+    const std::string axis = IntToString(i + 1);
+    entry.Dimensions[i] = i < naxis ? static_cast<int>(HeaderDouble(reader, "NAXIS" + axis)) : 1;
+    entry.CTYPE[i] = HeaderString(reader, "CTYPE" + axis);
+    entry.CUNIT[i] = HeaderString(reader, "CUNIT" + axis);
+    entry.CRPIX[i] = HeaderDouble(reader, "CRPIX" + axis);
+    entry.CRVAL[i] = HeaderDouble(reader, "CRVAL" + axis);
+    entry.CDELT[i] = HeaderDouble(reader, "CDELT" + axis);
+    }
+  entry.BMAJ = HeaderDouble(reader, "BMAJ");
+  entry.BMIN = HeaderDouble(reader, "BMIN");
+  entry.BPA = HeaderDouble(reader, "BPA");
+  entry.RESTFREQ = HeaderDouble(reader, "RESTFREQ");
+  entry.RAMin = entry.RAMax = entry.DecMin = entry.DecMax = nan;
+  entry.SpectralMin = entry.SpectralMax = nan;
+  entry.SpectralType.clear();
+
+  // footprint: world coordinates of a grid of points on the edges of the
+  // voxels of the first and last plane (pixel coordinates are 1 based)
+  struct wcsprm *readerWCS = reader->GetWCSStruct();
+  struct wcsprm footprintWCS;
+  if (readerWCS && !reader->GetWCSStatus() && readerWCS->naxis > 0 &&
+      CopyFootprintWCS(readerWCS, &footprintWCS))
+    {
+    struct wcsprm *wcs = &footprintWCS;
+    if (wcs->spec >= 0)
+      {
+      entry.SpectralType = std::string(wcs->ctype[wcs->spec]).substr(0, 4);
+      }
+    const int nelem = wcs->naxis;
+    const int ncoord = FootprintSamples * FootprintSamples * 2;
+    std::vector<double> pixcrd(ncoord * nelem, 1.), imgcrd(ncoord * nelem), world(ncoord * nelem);
+    std::vector<double> phi(ncoord), theta(ncoord);
+    std::vector<int> stat(ncoord);
+    int n = 0;
+    for (int k = 0; k < 2; k++)
+      {
+      for (int j = 0; j < FootprintSamples; j++)
+        {
+        for (int i = 0; i < FootprintSamples; i++, n++)
+          {
+          const double fractions[3] = {(double) i / (FootprintSamples - 1),
+                                       (double) j / (FootprintSamples - 1), (double) k};
+          for (int axii = 0; axii < 3 && axii < nelem; axii++)
+            {
+            pixcrd[n * nelem + axii] = 0.5 + fractions[axii] * entry.Dimensions[axii];
+            }
+          }
+        }
+      }
+
+    // status 8: some of the points have no world coordinates
+    const int status = wcsp2s(wcs, ncoord, nelem, &pixcrd[0], &imgcrd[0],
+                              &phi[0], &theta[0], &world[0], &stat[0]);
+    if (status == 0 || status == 8)
+      {
+      std::vector<double> ras;
+      bool first = true;
+      for (n = 0; n < ncoord; n++)
+        {
+        if (stat[n])
+          {
+          continue;
+          }
+        if (wcs->lng >= 0 && wcs->lat >= 0)
+          {
+          double ra = fmod(world[n * nelem + wcs->lng], 360.);
+          ras.push_back(ra < 0. ? ra + 360. : ra);
+          const double dec = world[n * nelem + wcs->lat];
+          entry.DecMin = first ? dec : std::min(entry.DecMin, dec);
+          entry.DecMax = first ? dec : std::max(entry.DecMax, dec);
+          }
+        if (wcs->spec >= 0)
+          {
+          const double spectral = world[n * nelem + wcs->spec];
+          entry.SpectralMin = first ? spectral : std::min(entry.SpectralMin, spectral);
+          entry.SpectralMax = first ? spectral : std::max(entry.SpectralMax, spectral);
+          }
+        first = false;
+        }
+      if (!ras.empty())
+        {
+        RARange(ras, entry.RAMin, entry.RAMax);
+        }
+      }
+    wcsfree(wcs);
+    }
+
+  reader->Delete();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSCatalog::Update(const char *directory, bool recursive)
+{
+  if (!directory || !vtksys::SystemTools::FileIsDirectory(directory))
+    {
+    vtkErrorMacro("vtkFITSCatalog::Update : " << (directory ? directory : "NULL")
+                  << " is not a directory.");
+    return 0;
+    }
+
+  std::string root = vtksys::SystemTools::CollapseFullPath(directory);
+  std::vector<std::string> files;
+  this->ListFiles(root, recursive, files);
+  std::set<std::string> present(files.begin(), files.end());
+
+  // drop the entries of the files of this tree that have been removed
+  const std::string prefix = root + "/";
+  std::vector<Entry> entries;
+  entries.reserve(this->Entries.size());
+  for (size_t i = 0; i < this->Entries.size(); i++)
+    {
+    const std::string &path = this->Entries[i].Path;
+    bool inTree = path.compare(0, prefix.size(), prefix) == 0;
+    if (inTree && (!recursive && path.find('/', prefix.size()) != std::string::npos))
+      {
+      inTree = false;
+      }
+    if (!inTree || present.count(path))
+      {
+      entries.push_back(this->Entries[i]);
+      }
+    }
+  this->Entries.swap(entries);
+  this->RebuildIndex();
+
+  // parse only the new and modified files
+  int parsed = 0;
+  for (size_t i = 0; i < files.size(); i++)
+    {
+    long long size, mtime;
+    GetSourceStamp(files[i], size, mtime);
+    std::map<std::string, int>::iterator it = this->EntryIndex.find(files[i]);
+    if (it != this->EntryIndex.end() &&
+        this->Entries[it->second].Size == size && this->Entries[it->second].MTime == mtime)
+      {
+      continue;
+      }
+
+    Entry entry;
+    if (this->ReadEntry(files[i], entry))
+      {
+      if (it != this->EntryIndex.end())
+        {
+        this->Entries[it->second] = entry;
+        }
+      else
+        {
+        this->EntryIndex[entry.Path] = static_cast<int>(this->Entries.size());
+        this->Entries.push_back(entry);
+        }
+      parsed++;
+      }
+
+    double progress = static_cast<double>(i + 1) / files.size();
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    }
+
+  this->RebuildIndex();
+  this->Modified();
+  return parsed;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSCatalog::Save(const char *indexFileName)
+{
+  if (!indexFileName)
+    {
+    return false;
+    }
+
+  std::string tempFileName = std::string(indexFileName) + ".tmp";
+  std::ofstream out(tempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out)
+    {
+    vtkErrorMacro("vtkFITSCatalog::Save : could not write " << tempFileName);
+    return false;
+    }
+
+  out.write(IndexMagic, sizeof(IndexMagic));
+  WriteValue(out, IndexByteOrder);
+  WriteValue(out, static_cast<int>(this->Entries.size()));
+  for (size_t i = 0; i < this->Entries.size(); i++)
+    {
+    const Entry &entry = this->Entries[i];
+    WriteString(out, entry.Path);
+    WriteValue(out, entry.Size);
+    WriteValue(out, entry.MTime);
+    WriteValue(out, entry.Dimensions);
+    WriteValue(out, entry.BITPIX);
+    WriteString(out, entry.Object);
+    for (int axii = 0; axii < 3; axii++)
+      {
+      WriteString(out, entry.CTYPE[axii]);
+      WriteString(out, entry.CUNIT[axii]);
+      }
+    WriteValue(out, entry.CRPIX);
+    WriteValue(out, entry.CRVAL);
+    WriteValue(out, entry.CDELT);
+    WriteValue(out, entry.BMAJ);
+    WriteValue(out, entry.BMIN);
+    WriteValue(out, entry.BPA);
+    WriteValue(out, entry.RESTFREQ);
+    WriteValue(out, entry.RAMin);
+    WriteValue(out, entry.RAMax);
+    WriteValue(out, entry.DecMin);
+    WriteValue(out, entry.DecMax);
+    WriteValue(out, entry.SpectralMin);
+    WriteValue(out, entry.SpectralMax);
+    WriteString(out, entry.SpectralType);
+    }
+
+  out.close();
+  if (!out)
+    {
+    vtkErrorMacro("vtkFITSCatalog::Save : failed writing " << tempFileName);
+    vtksys::SystemTools::RemoveFile(tempFileName.c_str());
+    return false;
+    }
+
+  vtksys::SystemTools::RemoveFile(indexFileName);
+  if (rename(tempFileName.c_str(), indexFileName) != 0)
+    {
+    vtkErrorMacro("vtkFITSCatalog::Save : could not rename " << tempFileName);
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSCatalog::Load(const char *indexFileName)
+{
+  this->Clear();
+  if (!indexFileName)
+    {
+    return false;
+    }
+
+  std::ifstream in(indexFileName, std::ios::in | std::ios::binary);
+  if (!in)
+    {
+    return false;
+    }
+
+  char magic[8];
+  int byteOrder = 0, numberOfEntries = 0;
+  in.read(magic, sizeof(magic));
+  ReadValue(in, byteOrder);
+  ReadValue(in, numberOfEntries);
+  if (!in || memcmp(magic, IndexMagic, sizeof(magic)) != 0 ||
+      byteOrder != IndexByteOrder || numberOfEntries < 0)
+    {
+    vtkErrorMacro("vtkFITSCatalog::Load : " << indexFileName << " is not a valid index.");
+    return false;
+    }
+
+  this->Entries.resize(numberOfEntries);
+  for (int i = 0; i < numberOfEntries && in; i++)
+    {
+    Entry &entry = this->Entries[i];
+    ReadString(in, entry.Path);
+    ReadValue(in, entry.Size);
+    ReadValue(in, entry.MTime);
+    ReadValue(in, entry.Dimensions);
+    ReadValue(in, entry.BITPIX);
+    ReadString(in, entry.Object);
+    for (int axii = 0; axii < 3; axii++)
+      {
+      ReadString(in, entry.CTYPE[axii]);
+      ReadString(in, entry.CUNIT[axii]);
+      }
+    ReadValue(in, entry.CRPIX);
+    ReadValue(in, entry.CRVAL);
+    ReadValue(in, entry.CDELT);
+    ReadValue(in, entry.BMAJ);
+    ReadValue(in, entry.BMIN);
+    ReadValue(in, entry.BPA);
+    ReadValue(in, entry.RESTFREQ);
+    ReadValue(in, entry.RAMin);
+    ReadValue(in, entry.RAMax);
+    ReadValue(in, entry.DecMin);
+    ReadValue(in, entry.DecMax);
+    ReadValue(in, entry.SpectralMin);
+    ReadValue(in, entry.SpectralMax);
+    ReadString(in, entry.SpectralType);
+    }
+
+  if (!in)
+    {
+    vtkErrorMacro("vtkFITSCatalog::Load : " << indexFileName << " is truncated.");
+    this->Clear();
+    return false;
+    }
+
+  this->RebuildIndex();
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSCatalog::FindOverlapping(double raMin, double raMax, double decMin, double decMax,
+                                     double spectralMin, double spectralMax,
+                                     std::vector<int> &entries,
+                                     const char *spectralType)
+{
+  entries.clear();
+  const std::string type = spectralType ? spectralType : "";
+  const size_t numberOfEntries = this->Footprints.size() / 6;
+  for (size_t i = 0; i < numberOfEntries; i++)
+    {
+    const double *footprint = &this->Footprints[i * 6];
+    // entries without sky footprint can not be matched
+    if (footprint[0] != footprint[0] || footprint[2] != footprint[2])
+      {
+      continue;
+      }
+    if (!IntervalsOverlap(footprint[2], footprint[3], decMin, decMax) ||
+        !RAOverlap(footprint[0], footprint[1], raMin, raMax))
+      {
+      continue;
+      }
+    // ranges of different spectral types can not be compared
+    if (footprint[4] == footprint[4] &&
+        (this->Entries[i].SpectralType != type ||
+         !IntervalsOverlap(footprint[4], footprint[5], spectralMin, spectralMax)))
+      {
+      continue;
+      }
+    entries.push_back(static_cast<int>(i));
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSCatalog::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfEntries: " << this->Entries.size() << "\n";
+}
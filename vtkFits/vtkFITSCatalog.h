@@ -0,0 +1,143 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkFITSCatalog_h
+#define __vtkFITSCatalog_h
+
+// std includes
+#include <map>
+#include <string>
+#include <vector>
+
+// VTK includes
+#include "vtkObject.h"
+
+#include "vtkFitsWin32Header.h"
+
+class vtkFITSReader;
+
+/// \brief Header-only index of the FITS files of a directory tree.
+///
+/// Update scans a directory and parses only the headers of the FITS
+/// files (vtkFITSReader::UpdateInformation), keeping for each file its
+/// dimensions, BITPIX, the WCS keys of the first three axes, the beam,
+/// RESTFREQ, OBJECT and the footprint of the cube: the RA/Dec box (in
+/// degrees) and the range of the spectral axis. The spectral ranges are
+/// converted to optical velocity (VOPT, m/s), as vtkFITSReader does for
+/// frequency axes, so that cubes with different spectral axes can be
+/// compared; axes that can not be converted (e.g. frequencies without
+/// RESTFREQ) keep their native type and SI units. Files whose size and
+/// modification time did not change are not opened again, so updating an
+/// index is incremental.
+///
+/// The index is saved in a compact binary file (Save, Load) and queried
+/// in memory (FindOverlapping) without touching the FITS files.
+///
+/// \sa vtkFITSReader
+class VTK_FITS_EXPORT vtkFITSCatalog : public vtkObject
+{
+public:
+  static vtkFITSCatalog *New();
+  vtkTypeMacro(vtkFITSCatalog,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  struct Entry
+    {
+    std::string Path;
+    long long Size;
+    long long MTime;
+    int Dimensions[3];
+    int BITPIX;
+    std::string Object;
+    std::string CTYPE[3];
+    std::string CUNIT[3];
+    double CRPIX[3];
+    double CRVAL[3];
+    double CDELT[3];
+    double BMAJ;
+    double BMIN;
+    double BPA;
+    double RESTFREQ;
+    /// Footprint. RAMin > RAMax if the footprint crosses RA = 0.
+    /// The bounds are NaN if the axis is missing.
+    double RAMin;
+    double RAMax;
+    double DecMin;
+    double DecMax;
+    double SpectralMin;
+    double SpectralMax;
+    /// Type of the spectral range (first four characters of the CTYPE,
+    /// VOPT if converted). Empty if the axis is missing.
+    std::string SpectralType;
+    };
+
+  ///
+  /// Scan directory (and its subdirectories if recursive) for .fits and
+  /// .fz files. New and modified files are parsed, entries of files of
+  /// directory that do not exist anymore are removed. ProgressEvent is
+  /// invoked while parsing. Returns the number of files parsed.
+  int Update(const char *directory, bool recursive = true);
+
+  ///
+  /// Read and write the index file
+  bool Load(const char *indexFileName);
+  bool Save(const char *indexFileName);
+
+  void Clear();
+  int GetNumberOfEntries();
+  const Entry* GetEntry(int index);
+  const Entry* FindEntry(const char *path);
+
+  ///
+  /// Indexes of the entries whose footprint overlaps the given box.
+  /// raMin > raMax selects a box crossing RA = 0. The spectral range is
+  /// given in spectralType (optical velocity in m/s by default): entries
+  /// whose spectral range has another type do not match, the spectral
+  /// range is ignored for entries without spectral axis.
+  void FindOverlapping(double raMin, double raMax, double decMin, double decMax,
+                       double spectralMin, double spectralMax,
+                       std::vector<int> &entries,
+                       const char *spectralType = "VOPT");
+
+protected:
+  vtkFITSCatalog();
+  ~vtkFITSCatalog();
+
+  ///
+  /// Parse the header of path into entry
+  bool ReadEntry(const std::string &path, Entry &entry);
+
+  void ListFiles(const std::string &directory, bool recursive,
+                 std::vector<std::string> &files);
+  void RebuildIndex();
+
+  std::vector<Entry> Entries;
+  std::map<std::string, int> EntryIndex;
+
+  ///
+  /// Footprints of the entries (RAMin, RAMax, DecMin, DecMax, SpectralMin,
+  /// SpectralMax), packed so that a query scans a few MB at most.
+  std::vector<double> Footprints;
+
+private:
+  vtkFITSCatalog(const vtkFITSCatalog&);  /// Not implemented.
+  void operator=(const vtkFITSCatalog&);  /// Not implemented.
+};
+
+#endif
@@ -0,0 +1,342 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// STD includes
+#include <sstream>
+
+// vtkFits includes
+#include <vtkFITSHeader.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkFITSHeader);
+
+namespace
+{
+//----------------------------------------------------------------------------
+template <typename T> T StringToNumber(const char* num)
+{
+  std::stringstream ss;
+  ss << num;
+  T result;
+  return ss >> result ? result : 0;
+}
+
+//----------------------------------------------------------------------------
+std::string IntToString(int Value)
+{
+  std::stringstream strstream;
+  strstream << Value;
+  return strstream.str();
+}
+
+//----------------------------------------------------------------------------
+const std::string EmptyString;
+
+} // end namespace
+
+//----------------------------------------------------------------------------
+vtkFITSHeader::vtkFITSHeader()
+{
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+vtkFITSHeader::~vtkFITSHeader()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHeader::Initialize()
+{
+  this->BITPIX = 0;
+  this->NAXIS = 0;
+  for (int ii = 0; ii < MaximumNumberOfAxes; ii++)
+    {
+    this->NAXISi[ii] = 0;
+    this->CRPIX[ii] = 0.;
+    this->CRVAL[ii] = 0.;
+    this->CDELT[ii] = 0.;
+    this->CTYPE[ii].clear();
+    this->CUNIT[ii].clear();
+    }
+  this->BMAJ = 0.;
+  this->BMIN = 0.;
+  this->BPA = 0.;
+  this->BSCALE = 1.;
+  this->BZERO = 0.;
+  this->BLANK = 0.;
+  this->CROTA = 0.;
+  this->EPOCH = 0.;
+  this->RESTFREQ = 0.;
+  this->DRVAL3 = 0.;
+  this->DATAMIN = 0.;
+  this->DATAMAX = 0.;
+  this->RMS = 0.;
+  this->NOISEMEAN = 0.;
+  this->BUNIT.clear();
+  this->BTYPE.clear();
+  this->OBJECT.clear();
+  this->TELESCOP.clear();
+  this->DUNIT3.clear();
+  this->DATATYPE.clear();
+  this->Keys.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHeader::Parse(const std::map<std::string, std::string> &keyValues)
+{
+  this->Initialize();
+
+  const std::string prefix = "SlicerAstro.";
+  std::map<std::string, std::string>::const_iterator it;
+  for (it = keyValues.begin(); it != keyValues.end(); ++it)
+    {
+    if (it->first.compare(0, prefix.size(), prefix) != 0)
+      {
+      continue;
+      }
+    std::string key = it->first.substr(prefix.size());
+    const char *value = it->second.c_str();
+    this->Keys[key] = true;
+
+    if (key == "BITPIX")
+      {
+      this->BITPIX = StringToNumber<int>(value);
+      }
+    else if (key == "NAXIS")
+      {
+      this->NAXIS = StringToNumber<int>(value);
+      }
+    else if (key == "BMAJ")
+      {
+      this->BMAJ = StringToNumber<double>(value);
+      }
+    else if (key == "BMIN")
+      {
+      this->BMIN = StringToNumber<double>(value);
+      }
+    else if (key == "BPA")
+      {
+      this->BPA = StringToNumber<double>(value);
+      }
+    else if (key == "BSCALE")
+      {
+      this->BSCALE = StringToNumber<double>(value);
+      }
+    else if (key == "BZERO")
+      {
+      this->BZERO = StringToNumber<double>(value);
+      }
+    else if (key == "BLANK")
+      {
+      this->BLANK = StringToNumber<double>(value);
+      }
+    else if (key == "CROTA")
+      {
+      this->CROTA = StringToNumber<double>(value);
+      }
+    else if (key == "EPOCH")
+      {
+      this->EPOCH = StringToNumber<double>(value);
+      }
+    else if (key == "RESTFREQ")
+      {
+      this->RESTFREQ = StringToNumber<double>(value);
+      }
+    else if (key == "DRVAL3")
+      {
+      this->DRVAL3 = StringToNumber<double>(value);
+      }
+    else if (key == "DATAMIN")
+      {
+      this->DATAMIN = StringToNumber<double>(value);
+      }
+    else if (key == "DATAMAX")
+      {
+      this->DATAMAX = StringToNumber<double>(value);
+      }
+    else if (key == "RMS")
+      {
+      this->RMS = StringToNumber<double>(value);
+      }
+    else if (key == "NOISEMEAN")
+      {
+      this->NOISEMEAN = StringToNumber<double>(value);
+      }
+    else if (key == "BUNIT")
+      {
+      this->BUNIT = it->second;
+      }
+    else if (key == "BTYPE")
+      {
+      this->BTYPE = it->second;
+      }
+    else if (key == "OBJECT")
+      {
+      this->OBJECT = it->second;
+      }
+    else if (key == "TELESCOP")
+      {
+      this->TELESCOP = it->second;
+      }
+    else if (key == "DUNIT3")
+      {
+      this->DUNIT3 = it->second;
+      }
+    else if (key == "DATATYPE")
+      {
+      this->DATATYPE = it->second;
+      }
+    }
+
+  // per axis keys
+  for (int ii = 0; ii < MaximumNumberOfAxes; ii++)
+    {
+    std::string axis = IntToString(ii + 1);
+    it = keyValues.find(prefix + "NAXIS" + axis);
+    if (it != keyValues.end())
+      {
+      this->NAXISi[ii] = StringToNumber<int>(it->second.c_str());
+      }
+    it = keyValues.find(prefix + "CRPIX" + axis);
+    if (it != keyValues.end())
+      {
+      this->CRPIX[ii] = StringToNumber<double>(it->second.c_str());
+      }
+    it = keyValues.find(prefix + "CRVAL" + axis);
+    if (it != keyValues.end())
+      {
+      this->CRVAL[ii] = StringToNumber<double>(it->second.c_str());
+      }
+    it = keyValues.find(prefix + "CDELT" + axis);
+    if (it != keyValues.end())
+      {
+      this->CDELT[ii] = StringToNumber<double>(it->second.c_str());
+      }
+    it = keyValues.find(prefix + "CTYPE" + axis);
+    if (it != keyValues.end())
+      {
+      this->CTYPE[ii] = it->second;
+      }
+    it = keyValues.find(prefix + "CUNIT" + axis);
+    if (it != keyValues.end())
+      {
+      this->CUNIT[ii] = it->second;
+      }
+    }
+
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSHeader::GetNAXISi(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return 0;
+    }
+  return this->NAXISi[axis];
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHeader::GetCRPIX(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return 0.;
+    }
+  return this->CRPIX[axis];
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHeader::GetCRVAL(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return 0.;
+    }
+  return this->CRVAL[axis];
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHeader::GetCDELT(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return 0.;
+    }
+  return this->CDELT[axis];
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkFITSHeader::GetCTYPE(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return EmptyString;
+    }
+  return this->CTYPE[axis];
+}
+
+//----------------------------------------------------------------------------
+const std::string& vtkFITSHeader::GetCUNIT(int axis)
+{
+  if (axis < 0 || axis >= MaximumNumberOfAxes)
+    {
+    return EmptyString;
+    }
+  return this->CUNIT[axis];
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHeader::HasKey(const char *key)
+{
+  if (!key)
+    {
+    return false;
+    }
+  return this->Keys.find(key) != this->Keys.end();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHeader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "BITPIX: " << this->BITPIX << "\n";
+  os << indent << "NAXIS: " << this->NAXIS << "\n";
+  for (int ii = 0; ii < MaximumNumberOfAxes; ii++)
+    {
+    os << indent << "Axis " << ii + 1 << ": "
+       << this->NAXISi[ii] << " " << this->CTYPE[ii] << " " << this->CUNIT[ii]
+       << " CRPIX " << this->CRPIX[ii] << " CRVAL " << this->CRVAL[ii]
+       << " CDELT " << this->CDELT[ii] << "\n";
+    }
+  os << indent << "Beam: " << this->BMAJ << " " << this->BMIN << " " << this->BPA << "\n";
+  os << indent << "BSCALE: " << this->BSCALE << "\n";
+  os << indent << "BZERO: " << this->BZERO << "\n";
+  os << indent << "BUNIT: " << this->BUNIT << "\n";
+  os << indent << "DATAMIN: " << this->DATAMIN << "\n";
+  os << indent << "DATAMAX: " << this->DATAMAX << "\n";
+  os << indent << "RMS: " << this->RMS << "\n";
+  os << indent << "DATATYPE: " << this->DATATYPE << "\n";
+}
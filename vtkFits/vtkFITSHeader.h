@@ -0,0 +1,141 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkFITSHeader_h
+#define __vtkFITSHeader_h
+
+// std includes
+#include <map>
+#include <string>
+
+// VTK includes
+#include "vtkObject.h"
+
+#include "vtkFitsWin32Header.h"
+
+/// \brief Typed view of the "SlicerAstro.*" header keys.
+///
+/// vtkFITSReader stores every card of the header as a string (and the
+/// AstroVolume nodes keep them as string attributes for serialization).
+/// Parse converts once the keys used by the processing code: axes, WCS
+/// keys, beam, units, scaling and data range. Numeric keys missing in the
+/// header are 0 (BSCALE is 1), string keys are empty.
+///
+/// \sa vtkFITSReader
+class VTK_FITS_EXPORT vtkFITSHeader : public vtkObject
+{
+public:
+  static vtkFITSHeader *New();
+  vtkTypeMacro(vtkFITSHeader,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Fill the header from "SlicerAstro.*" key/value pairs
+  void Parse(const std::map<std::string, std::string> &keyValues);
+
+  ///
+  /// Reset all the keys to their default
+  void Initialize();
+
+  vtkGetMacro(BITPIX, int);
+  vtkGetMacro(NAXIS, int);
+
+  ///
+  /// Per axis keys (axis is 0 based, up to 3 axes)
+  int GetNAXISi(int axis);
+  double GetCRPIX(int axis);
+  double GetCRVAL(int axis);
+  double GetCDELT(int axis);
+  const std::string& GetCTYPE(int axis);
+  const std::string& GetCUNIT(int axis);
+
+  vtkGetMacro(BMAJ, double);
+  vtkGetMacro(BMIN, double);
+  vtkGetMacro(BPA, double);
+  vtkGetMacro(BSCALE, double);
+  vtkGetMacro(BZERO, double);
+  vtkGetMacro(BLANK, double);
+  vtkGetMacro(CROTA, double);
+  vtkGetMacro(EPOCH, double);
+  vtkGetMacro(RESTFREQ, double);
+  vtkGetMacro(DRVAL3, double);
+  vtkGetMacro(DATAMIN, double);
+  vtkGetMacro(DATAMAX, double);
+  vtkGetMacro(RMS, double);
+  vtkGetMacro(NOISEMEAN, double);
+
+  const std::string& GetBUNIT() { return this->BUNIT; }
+  const std::string& GetBTYPE() { return this->BTYPE; }
+  const std::string& GetOBJECT() { return this->OBJECT; }
+  const std::string& GetTELESCOP() { return this->TELESCOP; }
+  const std::string& GetDUNIT3() { return this->DUNIT3; }
+  const std::string& GetDATATYPE() { return this->DATATYPE; }
+
+  ///
+  /// True if the key (without the "SlicerAstro." prefix) was in the header
+  bool HasKey(const char *key);
+
+  enum
+    {
+    MaximumNumberOfAxes = 3
+    };
+
+protected:
+  vtkFITSHeader();
+  ~vtkFITSHeader();
+
+  int BITPIX;
+  int NAXIS;
+  int NAXISi[MaximumNumberOfAxes];
+  double CRPIX[MaximumNumberOfAxes];
+  double CRVAL[MaximumNumberOfAxes];
+  double CDELT[MaximumNumberOfAxes];
+  std::string CTYPE[MaximumNumberOfAxes];
+  std::string CUNIT[MaximumNumberOfAxes];
+
+  double BMAJ;
+  double BMIN;
+  double BPA;
+  double BSCALE;
+  double BZERO;
+  double BLANK;
+  double CROTA;
+  double EPOCH;
+  double RESTFREQ;
+  double DRVAL3;
+  double DATAMIN;
+  double DATAMAX;
+  double RMS;
+  double NOISEMEAN;
+
+  std::string BUNIT;
+  std::string BTYPE;
+  std::string OBJECT;
+  std::string TELESCOP;
+  std::string DUNIT3;
+  std::string DATATYPE;
+
+  std::map<std::string, bool> Keys;
+
+private:
+  vtkFITSHeader(const vtkFITSHeader&);  /// Not implemented.
+  void operator=(const vtkFITSHeader&);  /// Not implemented.
+};
+
+#endif
@@ -0,0 +1,365 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+// STD includes
+#include <algorithm>
+#include <math.h>
+
+// vtkFits includes
+#include <vtkFITSHistogram.h>
+#include "vtkSlicerAstroConfigure.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkObjectFactory.h>
+
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkFITSHistogram);
+
+namespace
+{
+//----------------------------------------------------------------------------
+// Number of voxels of the blocks histogrammed by each thread
+const vtkIdType HistogramBlockSize = 1 << 16;
+
+//----------------------------------------------------------------------------
+// Each thread fills its own counts (linear bins, log bins and the NaN
+// count, stride values per thread), merged afterwards: the counts do not
+// depend on the number of threads. The voxels are histogrammed as
+// dataScale * voxel + dataOffset.
+template <typename T> void FillHistograms(const T *pixels, vtkIdType numElements,
+                                          double dataScale, double dataOffset,
+                                          double min, double scale, int numBins,
+                                          double logMin, double logScale, int numLogBins,
+                                          std::vector<vtkIdType> &counts, int &numThreads)
+{
+  numThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  const int stride = numBins + numLogBins + 1;
+  counts.assign(static_cast<size_t>(numThreads) * stride, 0);
+
+  const int numBlocks = static_cast<int>((numElements + HistogramBlockSize - 1) / HistogramBlockSize);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int block = 0; block < numBlocks; block++)
+    {
+    int thread = 0;
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    thread = omp_get_thread_num();
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    vtkIdType *linearCounts = &counts[static_cast<size_t>(thread) * stride];
+    vtkIdType *logCounts = linearCounts + numBins;
+    vtkIdType *nanCount = logCounts + numLogBins;
+
+    const vtkIdType first = block * HistogramBlockSize;
+    const vtkIdType last = std::min(first + HistogramBlockSize, numElements);
+    for (vtkIdType elemCnt = first; elemCnt < last; elemCnt++)
+      {
+      double value = *(pixels + elemCnt);
+      if (value != value)
+        {
+        (*nanCount)++;
+        continue;
+        }
+      value = value * dataScale + dataOffset;
+      const double pos = (value - min) * scale;
+      linearCounts[pos <= 0. ? 0 : (pos >= numBins ? numBins - 1 : static_cast<int>(pos))]++;
+
+      if (logScale > 0. && value >= logMin)
+        {
+        const double logPos = log(value / logMin) * logScale;
+        logCounts[logPos >= numLogBins ? numLogBins - 1 : static_cast<int>(logPos)]++;
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Sum the counts of the threads into cumulative counts
+void MergeCounts(const std::vector<vtkIdType> &counts, int numThreads, int offset,
+                 int numBins, int stride, std::vector<vtkIdType> &cumulative)
+{
+  cumulative.assign(numBins + 1, 0);
+  for (int bin = 0; bin < numBins; bin++)
+    {
+    vtkIdType count = 0;
+    for (int thread = 0; thread < numThreads; thread++)
+      {
+      count += counts[static_cast<size_t>(thread) * stride + offset + bin];
+      }
+    cumulative[bin + 1] = cumulative[bin] + count;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Bin containing the target-th voxel and position of the voxel in the bin
+int FindBin(const std::vector<vtkIdType> &cumulative, double target, double &fraction)
+{
+  const int numBins = static_cast<int>(cumulative.size()) - 1;
+  int bin = static_cast<int>(std::upper_bound(cumulative.begin(), cumulative.end(), target)
+                             - cumulative.begin()) - 1;
+  bin = std::max(0, std::min(bin, numBins - 1));
+  const vtkIdType count = cumulative[bin + 1] - cumulative[bin];
+  fraction = count > 0 ? (target - cumulative[bin]) / count : 0.;
+  fraction = std::max(0., std::min(fraction, 1.));
+  return bin;
+}
+
+} // end namespace
+
+//----------------------------------------------------------------------------
+vtkFITSHistogram::vtkFITSHistogram()
+{
+  this->NumberOfBins = 4096;
+  this->NumberOfLogBins = 1024;
+  this->NumberOfDecades = 6.;
+  this->DataScale = 1.;
+  this->DataOffset = 0.;
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+vtkFITSHistogram::~vtkFITSHistogram()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHistogram::Initialize()
+{
+  this->Minimum = 0.;
+  this->Maximum = 0.;
+  this->LogMinimum = 0.;
+  this->Total = 0;
+  this->NaNCount = 0;
+  this->LogTotal = 0;
+  this->Cumulative.assign(2, 0);
+  this->LogCumulative.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHistogram::Build(vtkDataArray *scalars, const double range[2])
+{
+  this->Initialize();
+  if (!scalars)
+    {
+    vtkErrorMacro("vtkFITSHistogram::Build : no scalars.");
+    return false;
+    }
+
+  const double min = range[0] * this->DataScale + this->DataOffset;
+  const double max = range[1] * this->DataScale + this->DataOffset;
+  this->Minimum = std::min(min, max);
+  this->Maximum = std::max(min, max);
+  const int numBins = this->NumberOfBins;
+  const double scale = this->Maximum > this->Minimum ?
+    numBins / (this->Maximum - this->Minimum) : 0.;
+
+  // log bins only for a positive maximum
+  int numLogBins = 0;
+  double logScale = 0.;
+  if (this->Maximum > 0.)
+    {
+    numLogBins = this->NumberOfLogBins;
+    this->LogMinimum = this->Maximum * pow(10., -this->NumberOfDecades);
+    logScale = numLogBins / log(this->Maximum / this->LogMinimum);
+    }
+
+  const vtkIdType numElements = scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+  void *pixels = scalars->GetVoidPointer(0);
+  std::vector<vtkIdType> counts;
+  int numThreads = 1;
+
+  switch (scalars->GetDataType())
+    {
+    case VTK_UNSIGNED_CHAR:
+      FillHistograms(static_cast<unsigned char*>(pixels), numElements,
+                     this->DataScale, this->DataOffset, this->Minimum, scale,
+                     numBins, this->LogMinimum, logScale, numLogBins, counts, numThreads);
+      break;
+    case VTK_SHORT:
+      FillHistograms(static_cast<short*>(pixels), numElements,
+                     this->DataScale, this->DataOffset, this->Minimum, scale,
+                     numBins, this->LogMinimum, logScale, numLogBins, counts, numThreads);
+      break;
+    case VTK_INT:
+      FillHistograms(static_cast<int*>(pixels), numElements,
+                     this->DataScale, this->DataOffset, this->Minimum, scale,
+                     numBins, this->LogMinimum, logScale, numLogBins, counts, numThreads);
+      break;
+    case VTK_FLOAT:
+      FillHistograms(static_cast<float*>(pixels), numElements,
+                     this->DataScale, this->DataOffset, this->Minimum, scale,
+                     numBins, this->LogMinimum, logScale, numLogBins, counts, numThreads);
+      break;
+    case VTK_DOUBLE:
+      FillHistograms(static_cast<double*>(pixels), numElements,
+                     this->DataScale, this->DataOffset, this->Minimum, scale,
+                     numBins, this->LogMinimum, logScale, numLogBins, counts, numThreads);
+      break;
+    default:
+      vtkErrorMacro("vtkFITSHistogram::Build : Attempt to allocate scalars of type not allowed");
+      return false;
+    }
+
+  const int stride = numBins + numLogBins + 1;
+  MergeCounts(counts, numThreads, 0, numBins, stride, this->Cumulative);
+  this->Total = this->Cumulative[numBins];
+  if (numLogBins > 0)
+    {
+    MergeCounts(counts, numThreads, numBins, numLogBins, stride, this->LogCumulative);
+    this->LogTotal = this->LogCumulative[numLogBins];
+    }
+  for (int thread = 0; thread < numThreads; thread++)
+    {
+    this->NaNCount += counts[static_cast<size_t>(thread) * stride + stride - 1];
+    }
+
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::GetBinWidth()
+{
+  return (this->Maximum - this->Minimum) / (this->Cumulative.size() - 1);
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::GetLogBinWidth(double value)
+{
+  if (this->LogTotal == 0 || value < this->LogMinimum)
+    {
+    return this->GetBinWidth();
+    }
+  const double logStep = log(this->Maximum / this->LogMinimum) / (this->LogCumulative.size() - 1);
+  return value * (exp(logStep) - 1.);
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::CountBelow(double value)
+{
+  if (this->Total == 0 || value <= this->Minimum)
+    {
+    return 0.;
+    }
+  if (value >= this->Maximum)
+    {
+    return static_cast<double>(this->Total);
+    }
+
+  if (this->LogTotal > 0 && value >= this->LogMinimum &&
+      this->GetLogBinWidth(value) < this->GetBinWidth())
+    {
+    const int numLogBins = static_cast<int>(this->LogCumulative.size()) - 1;
+    const double logPos = log(value / this->LogMinimum) * numLogBins /
+      log(this->Maximum / this->LogMinimum);
+    const int bin = std::min(static_cast<int>(logPos), numLogBins - 1);
+    return (this->Total - this->LogTotal) + this->LogCumulative[bin] +
+      (logPos - bin) * (this->LogCumulative[bin + 1] - this->LogCumulative[bin]);
+    }
+
+  const int numBins = static_cast<int>(this->Cumulative.size()) - 1;
+  const double pos = (value - this->Minimum) / this->GetBinWidth();
+  const int bin = std::min(static_cast<int>(pos), numBins - 1);
+  return this->Cumulative[bin] +
+    (pos - bin) * (this->Cumulative[bin + 1] - this->Cumulative[bin]);
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::GetQuantile(double q)
+{
+  if (this->Total == 0)
+    {
+    return 0.;
+    }
+
+  q = std::max(0., std::min(q, 1.));
+  const double target = q * this->Total;
+
+  double fraction = 0.;
+  int bin = FindBin(this->Cumulative, target, fraction);
+  double value = this->Minimum + (bin + fraction) * this->GetBinWidth();
+
+  // the voxels above LogMinimum are the LogTotal brightest ones
+  const double logTarget = target - (this->Total - this->LogTotal);
+  if (this->LogTotal > 0 && logTarget >= 0.)
+    {
+    const int numLogBins = static_cast<int>(this->LogCumulative.size()) - 1;
+    bin = FindBin(this->LogCumulative, logTarget, fraction);
+    const double logValue = this->LogMinimum *
+      exp((bin + fraction) * log(this->Maximum / this->LogMinimum) / numLogBins);
+    if (this->GetLogBinWidth(logValue) < this->GetBinWidth())
+      {
+      value = logValue;
+      }
+    }
+
+  return std::max(this->Minimum, std::min(value, this->Maximum));
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::GetFractionAbove(double value)
+{
+  if (this->Total == 0)
+    {
+    return 0.;
+    }
+  return (this->Total - this->CountBelow(value)) / this->Total;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkFITSHistogram::GetBinCount(int bin)
+{
+  if (bin < 0 || bin >= static_cast<int>(this->Cumulative.size()) - 1)
+    {
+    return 0;
+    }
+  return this->Cumulative[bin + 1] - this->Cumulative[bin];
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSHistogram::GetBinValue(int bin)
+{
+  return this->Minimum + bin * this->GetBinWidth();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHistogram::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "NumberOfBins: " << this->NumberOfBins << "\n";
+  os << indent << "NumberOfLogBins: " << this->NumberOfLogBins << "\n";
+  os << indent << "NumberOfDecades: " << this->NumberOfDecades << "\n";
+  os << indent << "DataScale: " << this->DataScale << "\n";
+  os << indent << "DataOffset: " << this->DataOffset << "\n";
+  os << indent << "Minimum: " << this->Minimum << "\n";
+  os << indent << "Maximum: " << this->Maximum << "\n";
+  os << indent << "Total: " << this->Total << "\n";
+  os << indent << "NaNCount: " << this->NaNCount << "\n";
+}
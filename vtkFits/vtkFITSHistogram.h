@@ -0,0 +1,145 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Consil grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkFITSHistogram_h
+#define __vtkFITSHistogram_h
+
+// std includes
+#include <vector>
+
+// VTK includes
+#include "vtkObject.h"
+
+#include "vtkFitsWin32Header.h"
+
+class vtkDataArray;
+
+/// \brief Global histogram of the voxels of a volume.
+///
+/// Build scans the scalars once (in parallel) and fills two histograms:
+/// a linear one, NumberOfBins bins between the minimum and the maximum,
+/// and a logarithmic one, NumberOfLogBins bins over the NumberOfDecades
+/// decades below the maximum (only if the maximum is positive).
+/// The log bins resolve the bright tail of the emission, which in the
+/// linear bins of a cube dominated by the noise ends up in a few bins.
+/// NaN voxels are only counted.
+///
+/// Quantiles and fractions of voxels above a value are then answered
+/// from the cumulative counts with a binary search, interpolating
+/// linearly inside the narrowest bin available for the value.
+///
+/// \sa vtkMRMLAstroVolumeNode::GetHistogram
+class VTK_FITS_EXPORT vtkFITSHistogram : public vtkObject
+{
+public:
+  static vtkFITSHistogram *New();
+  vtkTypeMacro(vtkFITSHistogram,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Number of bins of the linear and log histograms and number of
+  /// decades covered by the log histogram. Used by the next Build.
+  vtkSetClampMacro(NumberOfBins, int, 2, 1 << 20);
+  vtkGetMacro(NumberOfBins, int);
+  vtkSetClampMacro(NumberOfLogBins, int, 2, 1 << 20);
+  vtkGetMacro(NumberOfLogBins, int);
+  vtkSetClampMacro(NumberOfDecades, double, 1., 30.);
+  vtkGetMacro(NumberOfDecades, double);
+
+  ///
+  /// Linear scaling applied to the voxels by the next Build, e.g.
+  /// BSCALE and BZERO of integer data: the histograms, quantiles and
+  /// fractions are then in physical units. Default is 1 and 0.
+  vtkSetMacro(DataScale, double);
+  vtkGetMacro(DataScale, double);
+  vtkSetMacro(DataOffset, double);
+  vtkGetMacro(DataOffset, double);
+
+  ///
+  /// Fill the histograms with the voxels of scalars, whose range
+  /// (NaN excluded, before the scaling) is range. Returns false if the
+  /// data type of the scalars is not supported.
+  bool Build(vtkDataArray *scalars, const double range[2]);
+
+  ///
+  /// Reset the histograms
+  void Initialize();
+
+  ///
+  /// Value below which lies the fraction q (in [0, 1]) of the voxels
+  double GetQuantile(double q);
+
+  ///
+  /// Fraction of the voxels above value
+  double GetFractionAbove(double value);
+
+  ///
+  /// Number of voxels of the histogram (NaN excluded) and of NaN voxels
+  vtkGetMacro(Total, vtkIdType);
+  vtkGetMacro(NaNCount, vtkIdType);
+
+  vtkGetMacro(Minimum, double);
+  vtkGetMacro(Maximum, double);
+
+  ///
+  /// Count of a bin of the linear histogram
+  vtkIdType GetBinCount(int bin);
+
+  ///
+  /// Lower edge of a bin of the linear histogram
+  double GetBinValue(int bin);
+
+protected:
+  vtkFITSHistogram();
+  ~vtkFITSHistogram();
+
+  ///
+  /// Number of voxels below value, from the linear or the log histogram
+  double CountBelow(double value);
+
+  ///
+  /// Width of the bins of the linear histogram and of the bin of the
+  /// log histogram containing value
+  double GetBinWidth();
+  double GetLogBinWidth(double value);
+
+  int NumberOfBins;
+  int NumberOfLogBins;
+  double NumberOfDecades;
+  double DataScale;
+  double DataOffset;
+
+  double Minimum;
+  double Maximum;
+  double LogMinimum;
+
+  vtkIdType Total;
+  vtkIdType NaNCount;
+  vtkIdType LogTotal;
+
+  /// cumulative counts: Cumulative[i] voxels lie below bin i
+  std::vector<vtkIdType> Cumulative;
+  std::vector<vtkIdType> LogCumulative;
+
+private:
+  vtkFITSHistogram(const vtkFITSHistogram&);  /// Not implemented.
+  void operator=(const vtkFITSHistogram&);  /// Not implemented.
+};
+
+#endif
@@ -20,18 +20,23 @@
 #include <cstdlib>
 #include <algorithm>
 #include <cstring>
+#include <limits>
+#include <list>
 #include <string>
 
 // vtkASTRO includes
 #include <vtkFITSReader.h>
+#include "vtkSlicerAstroConfigure.h"
 
 // Qt includes
 #include <QFileInfo>
 #include <QRegExp>
 
 // VTK includes
+#include <vtkCriticalSection.h>
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
+#include <vtkIntArray.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkMatrix4x4.h>
@@ -39,6 +44,7 @@
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkShortArray.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtksys/SystemTools.hxx>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
@@ -48,6 +54,11 @@
 // STD includes
 #include <sstream>
 
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
 vtkStandardNewMacro(vtkFITSReader);
 
 vtkFITSReader::vtkFITSReader()
@@ -56,6 +67,28 @@ vtkFITSReader::vtkFITSReader()
   HeaderKeys = NULL;
   CurrentFileName = NULL;
   UseNativeOrigin = true;
+  ReadUpdateExtent = 0;
+  UseNativeDataType = 0;
+  Subsample = 0;
+  CurrentSubsample = 0;
+  DataScale = 1.;
+  DataOffset = 0.;
+  PixelTransform = NULL;
+  PixelTransformClientData = NULL;
+  for (int i = 0; i < 3; i++)
+    {
+    Binning[i] = 1;
+    CurrentBinning[i] = 1;
+    FileExtent[2 * i] = 0;
+    FileExtent[2 * i + 1] = 0;
+    }
+  NumberOfThreads = 0;
+  UseHeaderCache = 1;
+  ProgressLock = new vtkSimpleCriticalSection;
+  ReadPlanes = 0;
+  ReadPlanesTotal = 0;
+  ReadProgress = 0.;
+  ReadAborted = 0;
   fptr = NULL;
   ReadStatus = 0;
   WCS = NULL;
@@ -85,6 +118,11 @@ vtkFITSReader::~vtkFITSReader()
     CurrentFileName = NULL;
     }
 
+  this->CloseFile();
+
+  delete ProgressLock;
+  ProgressLock = NULL;
+
   if(WCS)
     {
     if((WCSStatus = wcsvfree(&NWCS, &WCS)))
@@ -141,6 +179,261 @@ std::string DoubleToString(double Value)
   return NumberToString<double>(Value);
 }
 
+//----------------------------------------------------------------------------
+// Reads smaller than this (in voxels) are not worth the extra file handles.
+const long long MinimumVoxelsForSlabs = 1 << 24;
+
+//----------------------------------------------------------------------------
+// Reads tracking the progress are done in (about) this number of Z steps:
+// progress is counted and the abort request checked after each of them.
+const int NumberOfProgressSteps = 20;
+
+//----------------------------------------------------------------------------
+// Planes of a progress step. For tile compressed images the step is a
+// multiple of the tile depth, so that no tile is decompressed twice.
+int GetProgressStepPlanes(fitsfile *file, int numPlanes)
+{
+  int step = std::max(1, (numPlanes + NumberOfProgressSteps - 1) / NumberOfProgressSteps);
+  int status = 0;
+  long tileDims[3] = {1, 1, 1};
+  if (fits_is_compressed_image(file, &status) &&
+      !fits_get_tile_dim(file, 3, tileDims, &status) && tileDims[2] > 1)
+    {
+    step = ((step + tileDims[2] - 1) / tileDims[2]) * tileDims[2];
+    }
+  return std::min(step, std::max(numPlanes, 1));
+}
+
+//----------------------------------------------------------------------------
+// Reduce bin[2] input planes of inDims[0] x inDims[1] voxels into one output
+// plane of outDims[0] x outDims[1] voxels. Data are averaged ignoring blank
+// (NaN) voxels, masks keep the maximum label of each bin.
+template <typename T> void BinPlanes(const T *inPixels, T *outPixels,
+                                     const int inDims[2], const int outDims[2],
+                                     const int bin[3], bool average)
+{
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int j = 0; j < outDims[1]; j++)
+    {
+    for (int i = 0; i < outDims[0]; i++)
+      {
+      double sum = 0., max = -std::numeric_limits<double>::max();
+      int cont = 0;
+      for (int k = 0; k < bin[2]; k++)
+        {
+        for (int jj = 0; jj < bin[1]; jj++)
+          {
+          const T *row = inPixels + ((vtkIdType) k * inDims[1] + j * bin[1] + jj) * inDims[0] + i * bin[0];
+          for (int ii = 0; ii < bin[0]; ii++)
+            {
+            const double value = *(row + ii);
+            if (value != value)
+              {
+              continue;
+              }
+            sum += value;
+            max = std::max(max, value);
+            cont++;
+            }
+          }
+        }
+      T *outPixel = outPixels + (vtkIdType) j * outDims[0] + i;
+      if (!cont)
+        {
+        *outPixel = std::numeric_limits<T>::quiet_NaN();
+        }
+      else
+        {
+        *outPixel = static_cast<T>(average ? sum / cont : max);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Keep the first voxel of each bin[0] x bin[1] bin of one input plane.
+template <typename T> void SubsamplePlane(const T *inPixels, T *outPixels,
+                                         const int inDims[2], const int outDims[2],
+                                         const int bin[3])
+{
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int j = 0; j < outDims[1]; j++)
+    {
+    const T *row = inPixels + (vtkIdType) j * bin[1] * inDims[0];
+    T *outRow = outPixels + (vtkIdType) j * outDims[0];
+    for (int i = 0; i < outDims[0]; i++)
+      {
+      *(outRow + i) = *(row + i * bin[0]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+struct wcsprm* CopyWCS(struct wcsprm *source)
+{
+  if (!source)
+    {
+    return NULL;
+    }
+
+  // calloc'ed as a one element array, so that it can be released by wcsvfree
+  struct wcsprm *copy = static_cast<struct wcsprm*>(calloc(1, sizeof(struct wcsprm)));
+  copy->flag = -1;
+  if (wcscopy(1, source, copy) || wcsset(copy))
+    {
+    wcsfree(copy);
+    free(copy);
+    return NULL;
+    }
+  return copy;
+}
+
+//----------------------------------------------------------------------------
+void FreeWCS(struct wcsprm *wcs)
+{
+  if (!wcs)
+    {
+    return;
+    }
+  wcsfree(wcs);
+  free(wcs);
+}
+
+//----------------------------------------------------------------------------
+// Maximum number of headers kept by the cache: the least recently used
+// ones are dropped first.
+const size_t HeaderCacheCapacity = 256;
+
+//----------------------------------------------------------------------------
+// Parsed header of a file. It is valid as long as the size and the
+// modification time (in nanoseconds) of the file do not change.
+struct HeaderCacheEntry
+{
+  long long Size;
+  long long MTime;
+  std::map<std::string, std::string> HeaderKeyValue;
+  bool FixGipsyHeaderOn;
+  struct wcsprm *WCS;
+  /// position of the file in the use order of the cache
+  std::list<std::string>::iterator LastUse;
+};
+
+//----------------------------------------------------------------------------
+// Process-wide header cache shared by all the readers, keyed on the full path.
+class HeaderCache
+{
+public:
+  ~HeaderCache()
+    {
+    this->Clear();
+    }
+
+  void Clear()
+    {
+    for (std::map<std::string, HeaderCacheEntry>::iterator it = this->Entries.begin();
+         it != this->Entries.end(); ++it)
+      {
+      FreeWCS(it->second.WCS);
+      }
+    this->Entries.clear();
+    this->UseOrder.clear();
+    }
+
+  /// Mark an entry as the most recently used
+  void Touch(HeaderCacheEntry &entry)
+    {
+    this->UseOrder.splice(this->UseOrder.begin(), this->UseOrder, entry.LastUse);
+    }
+
+  /// Add or replace the entry of fileName, dropping the least recently
+  /// used entries beyond HeaderCacheCapacity
+  void Insert(const std::string &fileName, const HeaderCacheEntry &entry)
+    {
+    std::map<std::string, HeaderCacheEntry>::iterator it = this->Entries.find(fileName);
+    if (it != this->Entries.end())
+      {
+      FreeWCS(it->second.WCS);
+      std::list<std::string>::iterator lastUse = it->second.LastUse;
+      it->second = entry;
+      it->second.LastUse = lastUse;
+      this->Touch(it->second);
+      return;
+      }
+
+    this->UseOrder.push_front(fileName);
+    HeaderCacheEntry &newEntry = this->Entries[fileName];
+    newEntry = entry;
+    newEntry.LastUse = this->UseOrder.begin();
+
+    while (this->Entries.size() > HeaderCacheCapacity)
+      {
+      it = this->Entries.find(this->UseOrder.back());
+      FreeWCS(it->second.WCS);
+      this->Entries.erase(it);
+      this->UseOrder.pop_back();
+      }
+    }
+
+  std::map<std::string, HeaderCacheEntry> Entries;
+  /// file names, most recently used first
+  std::list<std::string> UseOrder;
+  vtkSimpleCriticalSection Lock;
+};
+
+//----------------------------------------------------------------------------
+HeaderCache& GetHeaderCache()
+{
+  static HeaderCache cache;
+  return cache;
+}
+
+//----------------------------------------------------------------------------
+// Size and modification time of a file. The time has the resolution
+// of the file system (nanoseconds where stat provides it), so that a
+// file rewritten within the same second is not mistaken for the old one.
+bool GetFileStamp(const std::string& fileName, long long &size, long long &mtime)
+{
+  struct stat fileStat;
+  if (stat(fileName.c_str(), &fileStat) != 0)
+    {
+    return false;
+    }
+  size = static_cast<long long>(fileStat.st_size);
+  mtime = static_cast<long long>(fileStat.st_mtime) * 1000000000LL;
+#if defined(__APPLE__)
+  mtime += static_cast<long long>(fileStat.st_mtimespec.tv_nsec);
+#elif defined(__linux__) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L)
+  mtime += static_cast<long long>(fileStat.st_mtim.tv_nsec);
+#endif
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Returns the cache entry of fileName if it is still up to date.
+// The cache lock has to be held by the caller.
+HeaderCacheEntry* FindHeaderCacheEntry(const std::string& fileName)
+{
+  long long size, mtime;
+  if (!GetFileStamp(fileName, size, mtime))
+    {
+    return NULL;
+    }
+
+  std::map<std::string, HeaderCacheEntry>::iterator it =
+    GetHeaderCache().Entries.find(fileName);
+  if (it == GetHeaderCache().Entries.end() ||
+      it->second.Size != size || it->second.MTime != mtime)
+    {
+    return NULL;
+    }
+  GetHeaderCache().Touch(it->second);
+  return &it->second;
+}
+
 }// end namespace
 
 vtkMatrix4x4* vtkFITSReader::GetRasToIjkMatrix()
@@ -225,8 +518,9 @@ int vtkFITSReader::CanReadFile(const char* filename)
     return false;
     }
 
+  // .fz is used for tile compressed (fpack) files
   std::string extension = vtksys::SystemTools::LowerCase( vtksys::SystemTools::GetFilenameLastExtension(fname) );
-  if (extension != ".fits")
+  if (extension != ".fits" && extension != ".fz")
     {
     vtkDebugMacro(<<"The filename extension is not recognized");
     return false;
@@ -242,16 +536,18 @@ int vtkFITSReader::CanReadFile(const char* filename)
     return false;
     }
 
-  char magic[5] = {'\0','\0','\0','\0','\0'};
-  inputStream.read(magic,4*sizeof(char));
+  // the first 80 bytes card of a FITS file is the SIMPLE keyword
+  char card[81];
+  memset(card, '\0', sizeof(card));
+  inputStream.read(card,80*sizeof(char));
 
-  if (inputStream.eof())
+  if (inputStream.gcount() < 80)
     {
     inputStream.close();
     return false;
     }
 
-  if (strcmp(magic,"SIMP")==0)
+  if (strncmp(card,"SIMPLE  =",9)==0)
     {
     inputStream.close();
     return true;
@@ -280,12 +576,23 @@ void vtkFITSReader::ExecuteInformation()
   // save the Fits struct for the current file and
   // don't re-execute the read unless the filename changes
   if (this->CurrentFileName != NULL &&
-       !strcmp (this->CurrentFileName, this->GetFileName()))
+       !strcmp (this->CurrentFileName, this->GetFileName()) &&
+       this->CurrentBinning[0] == this->Binning[0] &&
+       this->CurrentBinning[1] == this->Binning[1] &&
+       this->CurrentBinning[2] == this->Binning[2] &&
+       this->CurrentSubsample == this->Subsample)
     {
-    // filename hasn't changed, don't re-execute
+    // filename (and binning) hasn't changed, don't re-execute
     return;
     }
 
+  this->CurrentSubsample = this->Subsample;
+
+  for (int i = 0; i < 3; i++)
+    {
+    this->CurrentBinning[i] = std::max(this->Binning[i], 1);
+    }
+
   if (this->CurrentFileName != NULL)
     {
     delete [] this->CurrentFileName;
@@ -294,15 +601,16 @@ void vtkFITSReader::ExecuteInformation()
   this->CurrentFileName = new char[1 + strlen(this->GetFileName())];
   strcpy (this->CurrentFileName, this->GetFileName());
 
-  if(fits_open_data(&fptr, this->GetFileName(), READONLY, &ReadStatus))
+  // Release the handle and the WCS of the previous file
+  this->CloseFile();
+  if (WCS)
     {
-    vtkErrorMacro("vtkFITSReader::ExecuteInformation : ERROR IN CFITSIO! Error reading"
-                  " "<< this->GetFileName() << ": \n");
-    fits_report_error(stderr, ReadStatus);
-    return;
+    wcsvfree(&NWCS, &WCS);
+    WCS = NULL;
     }
 
   HeaderKeyValue.clear();
+  FixGipsyHeaderOn = false;
 
   if (this->RasToIjkMatrix)
     {
@@ -314,32 +622,71 @@ void vtkFITSReader::ExecuteInformation()
   this->SetPointDataType(vtkDataSetAttributes::SCALARS);
   this->SetNumberOfComponents(1);
 
-  // Push FITS header key/value pair data into std::map
-  if(!this->AllocateHeader())
+  // Parse the header only if it is not in the cache already.
+  // The file handle is kept open for ExecuteDataWithInformation.
+  if (!this->UseHeaderCache || !this->LoadHeaderFromCache())
     {
-    vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to allocateFitsHeader. \n")
-    return;
+    if(fits_open_data(&fptr, this->GetFileName(), READONLY, &ReadStatus))
+      {
+      vtkErrorMacro("vtkFITSReader::ExecuteInformation : ERROR IN CFITSIO! Error reading"
+                    " "<< this->GetFileName() << ": \n");
+      fits_report_error(stderr, ReadStatus);
+      fptr = NULL;
+      return;
+      }
+
+    // Push FITS header key/value pair data into std::map
+    if(!this->AllocateHeader())
+      {
+      vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to allocateFitsHeader. \n")
+      return;
+      }
+
+    // Push FITS header key/value pair data into std::map
+    if(!this->FixGipsyHeader())
+      {
+      vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to FixGipsyHeader. \n")
+      return;
+      }
+
+    // Push FITS header into WCS struct
+    if(!this->AllocateWCS())
+      {
+      vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to allocateWCS. \n")
+      }
+    else if (this->UseHeaderCache)
+      {
+      this->StoreHeaderInCache();
+      }
     }
 
-  // Push FITS header key/value pair data into std::map
-  if(!this->FixGipsyHeader())
+  // extent of the data in the file, before binning
+  for (int axii = 0; axii < 3; axii++)
     {
-    vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to FixGipsyHeader. \n")
-    return;
+    this->FileExtent[2 * axii] = 0;
+    this->FileExtent[2 * axii + 1] = 0;
+    }
+  for (int axii = 0; axii < StringToInt(this->GetHeaderValue("SlicerAstro.NAXIS")) && axii < 3; axii++)
+    {
+    this->FileExtent[2 * axii + 1] =
+      StringToInt(this->GetHeaderValue(("SlicerAstro.NAXIS"+IntToString(axii+1)).c_str())) - 1;
     }
 
-  // Push FITS header into WCS struct
-  if(!this->AllocateWCS())
+  const bool binned = this->IsBinned();
+  if (binned)
     {
-    vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to allocateWCS. \n")
+    this->ApplyBinning();
     }
 
   // Set type information
   std::string dataType = this->GetHeaderValue("SlicerAstro.DATATYPE");
   if (!dataType.compare("MASK"))
     {
-    this->SetDataType( VTK_SHORT );
-    this->SetDataScalarType( VTK_SHORT );
+    // masks with less than 256 labels are stored with BITPIX = 8
+    const int maskType = StringToInt(this->GetHeaderValue("SlicerAstro.BITPIX")) == 8 ?
+      VTK_UNSIGNED_CHAR : VTK_SHORT;
+    this->SetDataType( maskType );
+    this->SetDataScalarType( maskType );
     }
 
   if (!dataType.compare("DATA") || !dataType.compare("MODEL"))
@@ -347,15 +694,16 @@ void vtkFITSReader::ExecuteInformation()
     switch(StringToInt(this->GetHeaderValue("SlicerAstro.BITPIX")))
       {
       case 8:
-        this->SetDataType( VTK_FLOAT );
-        this->SetDataScalarType( VTK_FLOAT );
+        this->SetDataType( this->UseNativeDataType && !binned ? VTK_UNSIGNED_CHAR : VTK_FLOAT );
+        this->SetDataScalarType( this->GetDataType() );
+        break;
       case 16:
-        this->SetDataType( VTK_FLOAT );
-        this->SetDataScalarType( VTK_FLOAT );
+        this->SetDataType( this->UseNativeDataType && !binned ? VTK_SHORT : VTK_FLOAT );
+        this->SetDataScalarType( this->GetDataType() );
         break;
       case 32:
-        this->SetDataType( VTK_FLOAT );
-        this->SetDataScalarType( VTK_FLOAT );
+        this->SetDataType( this->UseNativeDataType && !binned ? VTK_INT : VTK_FLOAT );
+        this->SetDataScalarType( this->GetDataType() );
         break;
       case -32:
         this->SetDataType( VTK_FLOAT );
@@ -438,11 +786,132 @@ void vtkFITSReader::ExecuteInformation()
   this->SetDataOrigin(origin);
 
   this->vtkImageReader2::ExecuteInformation();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::LoadHeaderFromCache()
+{
+  std::string fileName = vtksys::SystemTools::CollapseFullPath(this->GetFileName());
 
-  if (fits_close_file(fptr, &ReadStatus))
+  bool found = false;
+  GetHeaderCache().Lock.Lock();
+  HeaderCacheEntry *entry = FindHeaderCacheEntry(fileName);
+  struct wcsprm *wcs = entry ? CopyWCS(entry->WCS) : NULL;
+  if (wcs)
     {
-    fits_report_error(stderr, ReadStatus);
+    this->HeaderKeyValue = entry->HeaderKeyValue;
+    this->FixGipsyHeaderOn = entry->FixGipsyHeaderOn;
+    this->WCS = wcs;
+    this->NWCS = 1;
+    this->WCSStatus = 0;
+    found = true;
+    }
+  GetHeaderCache().Lock.Unlock();
+
+  return found;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::StoreHeaderInCache()
+{
+  std::string fileName = vtksys::SystemTools::CollapseFullPath(this->GetFileName());
+
+  HeaderCacheEntry entry;
+  if (!GetFileStamp(fileName, entry.Size, entry.MTime))
+    {
+    return;
+    }
+  entry.WCS = CopyWCS(this->WCS);
+  if (!entry.WCS)
+    {
+    return;
+    }
+  entry.HeaderKeyValue = this->HeaderKeyValue;
+  entry.FixGipsyHeaderOn = this->FixGipsyHeaderOn;
+
+  GetHeaderCache().Lock.Lock();
+  GetHeaderCache().Insert(fileName, entry);
+  GetHeaderCache().Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::ClearHeaderCache()
+{
+  GetHeaderCache().Lock.Lock();
+  GetHeaderCache().Clear();
+  GetHeaderCache().Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+double vtkFITSReader::GetReadProgress()
+{
+  this->ProgressLock->Lock();
+  const double progress = this->ReadProgress;
+  this->ProgressLock->Unlock();
+  return progress;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::AbortRead()
+{
+  this->ProgressLock->Lock();
+  this->ReadAborted = 1;
+  this->ProgressLock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::StartReadProgress(vtkIdType numberOfPlanes)
+{
+  this->ProgressLock->Lock();
+  this->ReadPlanes = 0;
+  this->ReadPlanesTotal = numberOfPlanes;
+  this->ReadProgress = 0.;
+  this->ReadAborted = 0;
+  this->ProgressLock->Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::AddReadPlanes(vtkIdType numberOfPlanes, bool report)
+{
+  this->ProgressLock->Lock();
+  this->ReadPlanes += numberOfPlanes;
+  if (this->ReadPlanesTotal > 0)
+    {
+    this->ReadProgress = std::min(1., static_cast<double>(this->ReadPlanes) /
+                                      this->ReadPlanesTotal);
+    }
+  const double progress = this->ReadProgress;
+  bool aborted = this->ReadAborted != 0;
+  this->ProgressLock->Unlock();
+
+  if (report)
+    {
+    // the observers run (and may set AbortExecute) in the calling thread
+    this->UpdateProgress(progress);
+    if (this->AbortExecute && !aborted)
+      {
+      this->AbortRead();
+      aborted = true;
+      }
     }
+
+  return !aborted;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::CloseFile()
+{
+  if (!fptr)
+    {
+    return;
+    }
+
+  int status = 0;
+  if (fits_close_file(fptr, &status))
+    {
+    fits_report_error(stderr, status);
+    }
+  fptr = NULL;
 }
 
 bool vtkFITSReader::AllocateHeader()
@@ -455,13 +924,33 @@ bool vtkFITSReader::AllocateHeader()
 
    int nkeys, ii;
 
-   fits_get_hdrspace(fptr, &nkeys, NULL, &ReadStatus); /* get # of keywords */
+   // Tile compressed images are stored in a binary table extension:
+   // parse the header of the equivalent uncompressed image instead.
+   char *convertedHeader = NULL;
+   int compressedStatus = 0;
+   if (fits_is_compressed_image(fptr, &compressedStatus))
+     {
+     if (fits_convert_hdr2str(fptr, 0, NULL, 0, &convertedHeader, &nkeys, &ReadStatus))
+       {
+       vtkErrorMacro("vtkFITSReader::AllocateHeader : could not convert the header of the compressed image. \n");
+       fits_report_error(stderr, ReadStatus);
+       return false;
+       }
+     }
+   else
+     {
+     fits_get_hdrspace(fptr, &nkeys, NULL, &ReadStatus); /* get # of keywords */
+     }
 
    /* Read and print each keywords */
    for (ii = 1; ii <= nkeys; ii++)
      {
-
-     if (fits_read_record(fptr, ii, card, &ReadStatus))break;
+     if (convertedHeader)
+       {
+       strncpy(card, convertedHeader + (ii - 1) * (FLEN_CARD - 1), FLEN_CARD - 1);
+       card[FLEN_CARD - 1] = '\0';
+       }
+     else if (fits_read_record(fptr, ii, card, &ReadStatus))break;
      if (fits_get_keyname(card, key, &keylen, &ReadStatus)) break;
      std::string strkey(key);
      if (strkey.compare(0,7,"HISTORY") == 0) continue;
@@ -494,6 +983,11 @@ bool vtkFITSReader::AllocateHeader()
      HeaderKeyValue[strkey1] = str;
      }
 
+   if (convertedHeader)
+     {
+     free(convertedHeader);
+     }
+
    if(HeaderKeyValue.count("SlicerAstro.NAXIS") == 0)
      {
      vtkErrorMacro("vtkFITSReader::ExecuteInformation :"
@@ -1065,7 +1559,16 @@ bool vtkFITSReader::AllocateWCS(){
   char *header;
   int  i, nkeyrec, nreject, stat[NWCSFIX];
 
-  if ((WCSStatus = fits_hdr2str(fptr, 1, NULL, 0, &header, &nkeyrec, &WCSStatus)))
+  int compressedStatus = 0;
+  if (fits_is_compressed_image(fptr, &compressedStatus))
+    {
+    WCSStatus = fits_convert_hdr2str(fptr, 1, NULL, 0, &header, &nkeyrec, &WCSStatus);
+    }
+  else
+    {
+    WCSStatus = fits_hdr2str(fptr, 1, NULL, 0, &header, &nkeyrec, &WCSStatus);
+    }
+  if (WCSStatus)
     {
     fits_report_error(stderr, WCSStatus);
     }
@@ -1292,6 +1795,12 @@ void vtkFITSReader::AllocatePointData(vtkImageData *out, vtkInformation* outInfo
     case VTK_SHORT:
       pd = vtkShortArray::New();
       break;
+    case VTK_INT:
+      pd = vtkIntArray::New();
+      break;
+    case VTK_UNSIGNED_CHAR:
+      pd = vtkUnsignedCharArray::New();
+      break;
     default:
       vtkErrorMacro("Could not allocate data type.");
       return;
@@ -1315,19 +1824,465 @@ void vtkFITSReader::AllocatePointData(vtkImageData *out, vtkInformation* outInfo
 
 
 
+//----------------------------------------------------------------------------
+bool vtkFITSReader::ReadExtent(fitsfile *file, void *ptr, const int extent[6], int *status,
+                               bool trackProgress)
+{
+  double dnullval = NAN;
+  float fnullval = NAN;
+  short snullval = 0;
+  int inullval = 0;
+  unsigned char bnullval = 0;
+  void *nullval = NULL;
+  int fitsType;
+  size_t voxelSize;
+  switch (this->DataType)
+    {
+    case VTK_DOUBLE:
+      fitsType = TDOUBLE;
+      nullval = &dnullval;
+      voxelSize = sizeof(double);
+      break;
+    case VTK_FLOAT:
+      fitsType = TFLOAT;
+      nullval = &fnullval;
+      voxelSize = sizeof(float);
+      break;
+    case VTK_SHORT:
+      fitsType = TSHORT;
+      nullval = &snullval;
+      voxelSize = sizeof(short);
+      break;
+    case VTK_INT:
+      fitsType = TINT;
+      nullval = &inullval;
+      voxelSize = sizeof(int);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      fitsType = TBYTE;
+      nullval = &bnullval;
+      voxelSize = sizeof(unsigned char);
+      break;
+    default:
+      vtkErrorMacro("Could not load data");
+      return false;
+    }
+
+  // Native integer data are kept as stored in the file: BSCALE and BZERO
+  // are applied later (see vtkMRMLAstroVolumeNode::GetDataScaling) and the
+  // BLANK pixels keep their value.
+  const bool rawValues = this->UseNativeDataType && fitsType != TFLOAT &&
+    fitsType != TDOUBLE && this->HeaderKeyValue["SlicerAstro.DATATYPE"] != "MASK";
+  if (rawValues)
+    {
+    nullval = NULL;
+    }
+
+  // BSCALE, BZERO, the linear rescale and the BLANK (or NaN) substitution
+  // are all applied by CFITSIO while decoding the pixels.
+  double scale, zero;
+  this->GetDecodeScaling(rawValues, scale, zero);
+  if (fits_set_bscale(file, scale, zero, status))
+    {
+    fits_report_error(stderr, *status);
+    return false;
+    }
+
+  int anynull;
+  const int *wholeExtent = this->FileExtent;
+
+  // whole XY planes are contiguous on disk: read them as one block
+  // (split in steps only to track the progress).
+  if (extent[0] == wholeExtent[0] && extent[1] == wholeExtent[1] &&
+      extent[2] == wholeExtent[2] && extent[3] == wholeExtent[3])
+    {
+    LONGLONG numPlane = (LONGLONG) (wholeExtent[1] - wholeExtent[0] + 1) *
+                                   (wholeExtent[3] - wholeExtent[2] + 1);
+    const int numPlanes = extent[5] - extent[4] + 1;
+    // without progress tracking each thread reads its planes in one step
+    const int stepPlanes = trackProgress ? GetProgressStepPlanes(file, numPlanes) : numPlanes;
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    // split large reads in Z-slabs, each one decoded by its own
+    // thread through its own CFITSIO handle. For tile compressed
+    // images each thread decompresses only the tiles of its slab.
+    // Every thread counts its planes; the calling thread (0) reports
+    // the progress and all of them stop at their next step if aborted.
+    int numSlabs = this->NumberOfThreads > 0 ? this->NumberOfThreads : omp_get_num_procs();
+    numSlabs = std::min(numSlabs, numPlanes);
+
+    if (numSlabs > 1 && (LONGLONG) numPlanes * numPlane >= MinimumVoxelsForSlabs &&
+        fits_is_reentrant())
+      {
+      bool failed = false;
+      const char *fileName = this->GetFileName();
+
+      #pragma omp parallel for schedule(static) num_threads(numSlabs) shared(failed)
+      for (int slab = 0; slab < numSlabs; slab++)
+        {
+        const int zFirst = extent[4] + (numPlanes * slab) / numSlabs;
+        const int zLast = extent[4] + (numPlanes * (slab + 1)) / numSlabs - 1;
+        const bool report = omp_get_thread_num() == 0;
+        fitsfile *slabFile = NULL;
+        int slabStatus = 0;
+        int slabAnynull;
+
+        bool slabFailed = fits_open_data(&slabFile, fileName, READONLY, &slabStatus) ||
+                          fits_set_bscale(slabFile, scale, zero, &slabStatus);
+        for (int z = zFirst; z <= zLast && !slabFailed; z += stepPlanes)
+          {
+          const int zStep = std::min(z + stepPlanes - 1, zLast);
+          const LONGLONG stepElements = (zStep - z + 1) * numPlane;
+          char *stepPtr = static_cast<char*>(ptr) + (z - extent[4]) * numPlane * voxelSize;
+          if (fits_read_img(slabFile, fitsType, (z - wholeExtent[4]) * numPlane + 1,
+                            stepElements, nullval, stepPtr, &slabAnynull, &slabStatus))
+            {
+            slabFailed = true;
+            break;
+            }
+          this->TransformPixels(stepPtr, (vtkIdType) stepElements);
+          if (trackProgress && !this->AddReadPlanes(zStep - z + 1, report))
+            {
+            break;
+            }
+          }
+
+        if (slabFailed)
+          {
+          #pragma omp critical
+            {
+            fits_report_error(stderr, slabStatus);
+            failed = true;
+            }
+          }
+
+        if (slabFile)
+          {
+          int closeStatus = 0;
+          fits_close_file(slabFile, &closeStatus);
+          }
+        }
+
+      if (failed)
+        {
+        vtkErrorMacro(<< "data is null.");
+        return false;
+        }
+      return true;
+      }
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+    for (int z = extent[4]; z <= extent[5]; z += stepPlanes)
+      {
+      const int zStep = std::min(z + stepPlanes - 1, extent[5]);
+      const LONGLONG stepElements = (zStep - z + 1) * numPlane;
+      char *stepPtr = static_cast<char*>(ptr) + (z - extent[4]) * numPlane * voxelSize;
+      if(fits_read_img(file, fitsType, (z - wholeExtent[4]) * numPlane + 1, stepElements,
+                       nullval, stepPtr, &anynull, status))
+        {
+        fits_report_error(stderr, *status);
+        vtkErrorMacro(<< "data is null.");
+        return false;
+        }
+      this->TransformPixels(stepPtr, (vtkIdType) stepElements);
+      if (trackProgress && !this->AddReadPlanes(zStep - z + 1, true))
+        {
+        break;
+        }
+      }
+    return true;
+    }
+
+  // the file can have more axes than the output (e.g. NAXIS4 = 1)
+  int fileNaxis = 0;
+  if (fits_get_img_dim(file, &fileNaxis, status))
+    {
+    fits_report_error(stderr, *status);
+    return false;
+    }
+
+  std::vector<long> fpixel(std::max(fileNaxis, 3), 1);
+  std::vector<long> lpixel(std::max(fileNaxis, 3), 1);
+  std::vector<long> inc(std::max(fileNaxis, 3), 1);
+  for (int axii = 0; axii < 3; axii++)
+    {
+    fpixel[axii] = extent[2 * axii] + 1;
+    lpixel[axii] = extent[2 * axii + 1] + 1;
+    }
+
+  if(fits_read_subset(file, fitsType, &fpixel[0], &lpixel[0], &inc[0], nullval, ptr, &anynull, status))
+    {
+    fits_report_error(stderr, *status);
+    vtkErrorMacro(<< "data is null.");
+    return false;
+    }
+  this->TransformPixels(ptr, (vtkIdType) (extent[1] - extent[0] + 1) *
+                             (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1));
+  if (trackProgress)
+    {
+    this->AddReadPlanes(extent[5] - extent[4] + 1, true);
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::GetDecodeScaling(bool rawValues, double &scale, double &zero)
+{
+  scale = 1.;
+  zero = 0.;
+  if (rawValues)
+    {
+    return;
+    }
+
+  scale = StringToNumber<double>(this->GetHeaderValue("SlicerAstro.BSCALE"));
+  zero = StringToNumber<double>(this->GetHeaderValue("SlicerAstro.BZERO"));
+  if (this->HeaderKeyValue["SlicerAstro.DATATYPE"] != "MASK")
+    {
+    scale *= this->DataScale;
+    zero = zero * this->DataScale + this->DataOffset;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::SetPixelTransform(PixelTransformFunction function, void *clientData)
+{
+  if (this->PixelTransform == function && this->PixelTransformClientData == clientData)
+    {
+    return;
+    }
+  this->PixelTransform = function;
+  this->PixelTransformClientData = clientData;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::TransformPixels(void *pixels, vtkIdType numberOfPixels)
+{
+  if (this->PixelTransform)
+    {
+    this->PixelTransform(pixels, numberOfPixels, this->DataType,
+                         this->PixelTransformClientData);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::IsBinned()
+{
+  return this->CurrentBinning[0] > 1 || this->CurrentBinning[1] > 1 ||
+         this->CurrentBinning[2] > 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::ApplyBinning()
+{
+  const int naxes = StringToInt(this->GetHeaderValue("SlicerAstro.NAXIS"));
+  for (int axii = 0; axii < naxes && axii < 3; axii++)
+    {
+    const int bin = this->CurrentBinning[axii];
+    if (bin <= 1)
+      {
+      continue;
+      }
+
+    const std::string axis = IntToString(axii + 1);
+    const int naxis = StringToInt(this->GetHeaderValue(("SlicerAstro.NAXIS" + axis).c_str()));
+    HeaderKeyValue["SlicerAstro.NAXIS" + axis] = IntToString(std::max(naxis / bin, 1));
+
+    if (HeaderKeyValue["SlicerAstro.CDELT" + axis].compare("UNDEFINED"))
+      {
+      HeaderKeyValue["SlicerAstro.CDELT" + axis] = DoubleToString
+        (StringToNumber<double>(HeaderKeyValue["SlicerAstro.CDELT" + axis].c_str()) * bin);
+      }
+    // the first binned pixel covers the input pixels 0.5 .. bin + 0.5,
+    // the first subsampled pixel is the input pixel 1
+    const double pixelOrigin = this->CurrentSubsample ? 1. : 0.5;
+    if (HeaderKeyValue["SlicerAstro.CRPIX" + axis].compare("UNDEFINED"))
+      {
+      HeaderKeyValue["SlicerAstro.CRPIX" + axis] = DoubleToString
+        ((StringToNumber<double>(HeaderKeyValue["SlicerAstro.CRPIX" + axis].c_str()) - pixelOrigin) / bin + pixelOrigin);
+      }
+
+    if (!this->WCS || axii >= this->WCS->naxis)
+      {
+      continue;
+      }
+
+    const int n = this->WCS->naxis;
+    this->WCS->crpix[axii] = (this->WCS->crpix[axii] - pixelOrigin) / bin + pixelOrigin;
+    if (this->WCS->altlin & 2)
+      {
+      // CDi_ja matrix: scale the column of the pixel axis
+      for (int i = 0; i < n; i++)
+        {
+        this->WCS->cd[i * n + axii] *= bin;
+        }
+      continue;
+      }
+
+    bool diagonal = true;
+    for (int i = 0; i < n; i++)
+      {
+      if (i != axii && fabs(this->WCS->pc[i * n + axii]) > 1.E-12)
+        {
+        diagonal = false;
+        }
+      }
+    if (diagonal)
+      {
+      this->WCS->cdelt[axii] *= bin;
+      }
+    else
+      {
+      for (int i = 0; i < n; i++)
+        {
+        this->WCS->pc[i * n + axii] *= bin;
+        }
+      }
+    }
+
+  if (this->WCS)
+    {
+    this->WCS->flag = 0;
+    if ((this->WCSStatus = wcsset(this->WCS)))
+      {
+      vtkErrorMacro("vtkFITSReader::ApplyBinning : wcsset ERROR "<<this->WCSStatus<<":\n"<<
+                    "Message from "<<this->WCS->err->function<<
+                    "at line "<<this->WCS->err->line_no<<" of file "<<this->WCS->err->file<<
+                    ": \n"<<this->WCS->err->msg<<"\n");
+      }
+    }
+
+  // the statistics of the file do not apply to the binned data
+  HeaderKeyValue["SlicerAstro.DATAMAX"] = "0.";
+  HeaderKeyValue["SlicerAstro.DATAMIN"] = "0.";
+  HeaderKeyValue["SlicerAstro.RMS"] = "0.";
+  HeaderKeyValue["SlicerAstro.NOISEMEAN"] = "0.";
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::ReadBinnedExtent(fitsfile *file, void *ptr, const int extent[6], int *status)
+{
+  size_t voxelSize;
+  switch (this->DataType)
+    {
+    case VTK_DOUBLE:
+      voxelSize = sizeof(double);
+      break;
+    case VTK_FLOAT:
+      voxelSize = sizeof(float);
+      break;
+    case VTK_SHORT:
+      voxelSize = sizeof(short);
+      break;
+    case VTK_UNSIGNED_CHAR:
+      voxelSize = sizeof(unsigned char);
+      break;
+    default:
+      vtkErrorMacro("vtkFITSReader::ReadBinnedExtent : data type not allowed.");
+      return false;
+    }
+
+  const int *bin = this->CurrentBinning;
+  int inExtent[6] = {extent[0] * bin[0], (extent[1] + 1) * bin[0] - 1,
+                     extent[2] * bin[1], (extent[3] + 1) * bin[1] - 1, 0, 0};
+  const int inDims[2] = {inExtent[1] - inExtent[0] + 1, inExtent[3] - inExtent[2] + 1};
+  const int outDims[2] = {extent[1] - extent[0] + 1, extent[3] - extent[2] + 1};
+  const bool average = this->HeaderKeyValue["SlicerAstro.DATATYPE"] != "MASK";
+  // when subsampling only the first plane of each bin is read
+  const int planes = this->CurrentSubsample ? 1 : bin[2];
+
+  // only the planes of one output plane are in memory at a time
+  std::vector<char> buffer((size_t) inDims[0] * inDims[1] * planes * voxelSize);
+  char *outPtr = static_cast<char*>(ptr);
+  for (int z = extent[4]; z <= extent[5]; z++)
+    {
+    inExtent[4] = z * bin[2];
+    inExtent[5] = z * bin[2] + planes - 1;
+    if (!this->ReadExtent(file, &buffer[0], inExtent, status))
+      {
+      return false;
+      }
+
+    if (this->CurrentSubsample)
+      {
+      switch (this->DataType)
+        {
+        case VTK_DOUBLE:
+          SubsamplePlane(reinterpret_cast<double*>(&buffer[0]), reinterpret_cast<double*>(outPtr),
+                         inDims, outDims, bin);
+          break;
+        case VTK_FLOAT:
+          SubsamplePlane(reinterpret_cast<float*>(&buffer[0]), reinterpret_cast<float*>(outPtr),
+                         inDims, outDims, bin);
+          break;
+        case VTK_SHORT:
+          SubsamplePlane(reinterpret_cast<short*>(&buffer[0]), reinterpret_cast<short*>(outPtr),
+                         inDims, outDims, bin);
+          break;
+        case VTK_UNSIGNED_CHAR:
+          SubsamplePlane(reinterpret_cast<unsigned char*>(&buffer[0]),
+                         reinterpret_cast<unsigned char*>(outPtr), inDims, outDims, bin);
+          break;
+        }
+      }
+    else
+      {
+      switch (this->DataType)
+        {
+        case VTK_DOUBLE:
+          BinPlanes(reinterpret_cast<double*>(&buffer[0]), reinterpret_cast<double*>(outPtr),
+                    inDims, outDims, bin, average);
+          break;
+        case VTK_FLOAT:
+          BinPlanes(reinterpret_cast<float*>(&buffer[0]), reinterpret_cast<float*>(outPtr),
+                    inDims, outDims, bin, average);
+          break;
+        case VTK_SHORT:
+          BinPlanes(reinterpret_cast<short*>(&buffer[0]), reinterpret_cast<short*>(outPtr),
+                    inDims, outDims, bin, average);
+          break;
+        case VTK_UNSIGNED_CHAR:
+          BinPlanes(reinterpret_cast<unsigned char*>(&buffer[0]),
+                    reinterpret_cast<unsigned char*>(outPtr), inDims, outDims, bin, average);
+          break;
+        }
+      }
+    outPtr += (size_t) outDims[0] * outDims[1] * voxelSize;
+
+    if (!this->AddReadPlanes(1, true))
+      {
+      break;
+      }
+    }
+
+  return true;
+}
+
 //----------------------------------------------------------------------------
 // This function reads a data from a file.  The datas extent/axes
 // are assumed to be the same as the file extent/order.
+// If ReadUpdateExtent is on, only the UPDATE_EXTENT is read.
 void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInformation* outInfo)
 {
-  if (this->GetOutputInformation(0))
+  if (!this->ReadUpdateExtent && this->GetOutputInformation(0))
     {
     this->GetOutputInformation(0)->Set(
       vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
     this->GetOutputInformation(0)->Get(
       vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
     }
-  vtkImageData *data = this->AllocateOutputData(output, outInfo);
+
+  vtkImageData *data = vtkImageData::SafeDownCast(output);
+  if (!data)
+    {
+    vtkWarningMacro("Call to ExecuteDataWithInformation with non vtkImageData output");
+    return;
+    }
+
+  this->ExecuteInformation();
+  data->SetExtent(this->GetUpdateExtent());
 
   if (this->GetFileName() == NULL)
     {
@@ -1335,65 +2290,55 @@ void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
     return;
     }
 
-  // Open the fits.  Yes, this means that the file is being opened
-  // twice: once by ExecuteInformation, and once here
-  if(fits_open_data(&fptr, this->GetFileName(), READONLY, &ReadStatus))
+  // Reuse the handle opened by ExecuteInformation of the same update.
+  // The file has to be opened here if the header has been taken from the
+  // cache (or ExecuteInformation did not parse it again).
+  if(!fptr && fits_open_data(&fptr, this->GetFileName(), READONLY, &ReadStatus))
     {
     vtkErrorMacro("ERROR IN CFITSIO! Error reading "<< this->GetFileName() << ":\n");
     fits_report_error(stderr, ReadStatus);
+    fptr = NULL;
     return;
     }
 
-  data->GetPointData()->GetScalars()->SetName("FITSImage");
-  //get pointer
-  void *ptr = NULL;
-  ptr = data->GetPointData()->GetScalars()->GetVoidPointer(0);
+  int extent[6];
+  data->GetExtent(extent);
   this->ComputeDataIncrements();
-  unsigned int naxes = data->GetDataDimension();
-  int naxe[naxes];
-  data->GetDimensions(naxe);
-  int dim = 1;
-  for (unsigned int axii=0; axii < naxes; axii++)
-    {
-    dim *= naxe[axii];
-    }
-  float nullval = NAN;
-  int anynull;
-  // load the data
-  switch (this->DataType)
+  this->StartReadProgress(extent[5] - extent[4] + 1);
+
+  if (this->IsBinned())
     {
-    case VTK_DOUBLE:
-      if(fits_read_img(fptr, TDOUBLE, 1, dim, &nullval, ptr, &anynull, &ReadStatus))
-      {
-        fits_report_error(stderr, ReadStatus);
-        vtkErrorMacro(<< "data is null.");
-        return;
-      }
-      break;
-    case VTK_FLOAT:
-      if(fits_read_img(fptr, TFLOAT, 1, dim, &nullval, ptr, &anynull, &ReadStatus))
+    this->AllocatePointData(data, outInfo);
+    void *ptr = data->GetPointData()->GetScalars()->GetVoidPointer(0);
+    if (!this->ReadBinnedExtent(fptr, ptr, extent, &ReadStatus))
       {
-        fits_report_error(stderr, ReadStatus);
-        vtkErrorMacro(<< "data is null.");
-        return;
-      }
-      break;
-  case VTK_SHORT:
-    if(fits_read_img(fptr, TSHORT, 1, dim, &nullval, ptr, &anynull, &ReadStatus))
-    {
-      fits_report_error(stderr, ReadStatus);
-      vtkErrorMacro(<< "data is null.");
-      return;
-    }
-    break;
-    default:
-      vtkErrorMacro("Could not load data");
+      this->CloseFile();
       return;
+      }
     }
-  if (fits_close_file(fptr, &ReadStatus))
+  else
     {
-    fits_report_error(stderr, ReadStatus);
+    this->AllocatePointData(data, outInfo);
+    //get pointer
+    void *ptr = NULL;
+    ptr = data->GetPointData()->GetScalars()->GetVoidPointer(0);
+
+    // load the data: the whole extent at once, so that large reads
+    // are decoded in parallel slabs.
+    if (!this->ReadExtent(fptr, ptr, extent, &ReadStatus, true))
+      {
+      this->CloseFile();
+      return;
+      }
     }
+
+  // the handle is not kept beyond the update
+  this->CloseFile();
+
+  // the polled progress reaches 1 also when the reads skip planes
+  this->AddReadPlanes(this->ReadPlanesTotal, false);
+
+  data->GetPointData()->GetScalars()->SetName("FITSImage");
 }
 
 
@@ -1401,5 +2346,15 @@ void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
 void vtkFITSReader::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "ReadUpdateExtent: " << this->ReadUpdateExtent << "\n";
+  os << indent << "UseNativeDataType: " << this->UseNativeDataType << "\n";
+  os << indent << "Binning: " << this->Binning[0] << " "
+     << this->Binning[1] << " " << this->Binning[2] << "\n";
+  os << indent << "Subsample: " << this->Subsample << "\n";
+  os << indent << "DataScale: " << this->DataScale << "\n";
+  os << indent << "DataOffset: " << this->DataOffset << "\n";
+  os << indent << "PixelTransform: " << (this->PixelTransform ? "set" : "none") << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "UseHeaderCache: " << this->UseHeaderCache << "\n";
 }
 
@@ -29,6 +29,7 @@
 
 // VTK decleration
 class vtkMatrix4x4;
+class vtkSimpleCriticalSection;
 
 // FITS includes
 #include "fitsio.h"
@@ -41,7 +42,10 @@ class vtkMatrix4x4;
 
 /// \brief Reads FITS files.
 ///
-/// Reads FITS using the CFITSIO library
+/// Reads FITS using the CFITSIO library. Tile compressed image
+/// HDUs (fpack Rice, GZIP, HCOMPRESS) are decompressed on the fly.
+/// Progress is reported (ProgressEvent) while the planes are decoded
+/// and setting AbortExecute (or calling AbortRead) stops the read.
 //
 /// \sa vtkImageReader2
 class VTK_FITS_EXPORT vtkFITSReader : public vtkMedicalImageReader2
@@ -84,7 +88,7 @@ public:
   /// Valid extentsions
   virtual const char* GetFileExtensions()
     {
-    return ".fits";
+    return ".fits .fz";
     }
 
   ///
@@ -134,6 +138,96 @@ public:
     UseNativeOrigin = false;
     }
 
+  ///
+  /// Read only the UPDATE_EXTENT requested by the pipeline
+  /// instead of the whole cube. The output has the size of the
+  /// requested sub-extent. Default is off (the WHOLE_EXTENT is read).
+  vtkSetMacro(ReadUpdateExtent,int);
+  vtkGetMacro(ReadUpdateExtent,int);
+  vtkBooleanMacro(ReadUpdateExtent,int);
+
+  ///
+  /// Keep integer data (BITPIX 8, 16 and 32) in their native type
+  /// (unsigned char, short and int) instead of converting them to float.
+  /// The voxels are the values stored in the file: BSCALE and BZERO
+  /// are not applied. Default is off.
+  vtkSetMacro(UseNativeDataType,int);
+  vtkGetMacro(UseNativeDataType,int);
+  vtkBooleanMacro(UseNativeDataType,int);
+
+  ///
+  /// Bin the data by the given factors along X, Y and Z while reading.
+  /// The output has NAXISi / bin voxels along each axis (the last partial
+  /// bin is dropped) and the header and the WCS (CDELT/CRPIX) are
+  /// adjusted to match. Only bin[2] planes of the file are in memory at
+  /// a time. Data are averaged (blank voxels are ignored), masks keep
+  /// the maximum label. Integer data are always converted to float.
+  /// Default is (1, 1, 1), no binning.
+  vtkSetVector3Macro(Binning,int);
+  vtkGetVector3Macro(Binning,int);
+
+  ///
+  /// Keep the first voxel of each bin instead of reducing the bin.
+  /// Only one plane of the file out of Binning[2] is read, which makes
+  /// this a quick way to get a coarse preview of a large cube.
+  /// Default is off.
+  vtkSetMacro(Subsample,int);
+  vtkGetMacro(Subsample,int);
+  vtkBooleanMacro(Subsample,int);
+
+  ///
+  /// Linear rescale of the decoded values: value * DataScale + DataOffset
+  /// (e.g. 0.005 to convert Westerbork units to Jy/beam). It is folded in
+  /// the BSCALE/BZERO scaling that CFITSIO applies while decoding, so it
+  /// does not cost an extra pass over the data. It is not applied to
+  /// masks and to native integer data. Default is 1 and 0.
+  vtkSetMacro(DataScale,double);
+  vtkGetMacro(DataScale,double);
+  vtkSetMacro(DataOffset,double);
+  vtkGetMacro(DataOffset,double);
+
+  ///
+  /// Per-pixel transform hook, applied to each block of voxels right
+  /// after it has been decoded (BLANK pixels are already NaN and the
+  /// scaling is already applied). The blocks are in the output data type
+  /// and can be processed concurrently from several threads, so the
+  /// function has to be thread safe.
+  typedef void (*PixelTransformFunction)(void *pixels, vtkIdType numberOfPixels,
+                                         int dataType, void *clientData);
+  void SetPixelTransform(PixelTransformFunction function, void *clientData);
+
+  ///
+  /// Number of threads used to decode large reads. The cube is
+  /// split in Z-slabs and each slab is read through its own CFITSIO
+  /// handle. 0 (default) uses all the available processors.
+  /// It requires OpenMP and a reentrant CFITSIO build.
+  vtkSetMacro(NumberOfThreads,int);
+  vtkGetMacro(NumberOfThreads,int);
+
+  ///
+  /// Headers (key/value pairs and WCS) are cached for the whole process,
+  /// keyed on the file path, size and modification time, so that
+  /// reloading or probing the same file does not parse it again.
+  /// The cache keeps the 256 most recently used headers.
+  /// This releases all the cached headers.
+  static void ClearHeaderCache();
+
+  ///
+  /// Use (and fill) the process-wide header cache. Turn it off when
+  /// scanning many files once, e.g. to build a catalog. Default is on.
+  vtkSetMacro(UseHeaderCache,int);
+  vtkGetMacro(UseHeaderCache,int);
+  vtkBooleanMacro(UseHeaderCache,int);
+
+  ///
+  /// Thread safe progress and abort for a read running in another
+  /// thread: GetReadProgress returns the fraction (0 to 1) of the planes
+  /// decoded so far, AbortRead stops the decoding threads at their next
+  /// step. ProgressEvent and AbortExecute are only safe to use from
+  /// the thread that runs the read.
+  double GetReadProgress();
+  void AbortRead();
+
 virtual vtkImageData * AllocateOutputData(vtkDataObject *out, vtkInformation* outInfo);
 virtual void AllocateOutputData(vtkImageData *out, vtkInformation* outInfo, int *uExtent)
     { Superclass::AllocateOutputData(out, outInfo, uExtent); }
@@ -152,6 +246,27 @@ protected:
   int DataType;
   int NumberOfComponents;
   bool UseNativeOrigin;
+  int ReadUpdateExtent;
+  int UseNativeDataType;
+  int NumberOfThreads;
+  int UseHeaderCache;
+  vtkSimpleCriticalSection *ProgressLock;
+  vtkIdType ReadPlanes;
+  vtkIdType ReadPlanesTotal;
+  double ReadProgress;
+  int ReadAborted;
+  int Binning[3];
+  int CurrentBinning[3];
+  int Subsample;
+  int CurrentSubsample;
+  double DataScale;
+  double DataOffset;
+  PixelTransformFunction PixelTransform;
+  void *PixelTransformClientData;
+
+  ///
+  /// Extent of the data in the file (before binning)
+  int FileExtent[6];
 
   fitsfile *fptr;
   int ReadStatus;
@@ -170,6 +285,50 @@ protected:
   bool FixGipsyHeader();
   bool AllocateWCS();
 
+  ///
+  /// Fill HeaderKeyValue and WCS from the header cache.
+  /// Returns false if the file has no up to date entry.
+  bool LoadHeaderFromCache();
+  void StoreHeaderInCache();
+
+  ///
+  /// Close fptr. The handle opened by ExecuteInformation is kept open
+  /// only for the data pass of the same update, which closes it.
+  void CloseFile();
+
+  ///
+  /// Read the voxels inside extent (in IJK, zero based) from the
+  /// image HDU of file into ptr. Full XY planes are read as one
+  /// contiguous block, otherwise a subset read is used. With
+  /// trackProgress the planes are read in steps and counted with
+  /// AddReadPlanes; the read stops early (returning true) if aborted.
+  bool ReadExtent(fitsfile *file, void *ptr, const int extent[6], int *status,
+                  bool trackProgress = false);
+
+  ///
+  /// Progress of the current read. AddReadPlanes can be called by any
+  /// decoding thread; report has to be true only in the thread running
+  /// the read, which invokes the ProgressEvent and checks AbortExecute.
+  /// Returns false once the read has been aborted.
+  void StartReadProgress(vtkIdType numberOfPlanes);
+  bool AddReadPlanes(vtkIdType numberOfPlanes, bool report);
+
+  ///
+  /// Scaling set in CFITSIO for the decode: BSCALE and BZERO of the
+  /// header combined with DataScale and DataOffset (1 and 0 for rawValues).
+  void GetDecodeScaling(bool rawValues, double &scale, double &zero);
+
+  ///
+  /// Apply the PixelTransform (if any) to decoded voxels
+  void TransformPixels(void *pixels, vtkIdType numberOfPixels);
+
+  ///
+  /// Binning helpers: ApplyBinning updates the header and the WCS,
+  /// ReadBinnedExtent reads and bins the voxels of extent (binned IJK).
+  bool IsBinned();
+  void ApplyBinning();
+  bool ReadBinnedExtent(fitsfile *file, void *ptr, const int extent[6], int *status);
+
   bool FixGipsyHeaderOn;
 
 private:
@@ -17,19 +17,25 @@
 
 ==============================================================================*/
 
+#include <algorithm>
 #include <map>
-#include<cstdlib>
+#include <cstdlib>
+#include <cstring>
 
 // vtkASTRO includes
 #include <vtkFITSWriter.h>
 
 // VTK includes
+#include <vtkCommand.h>
 #include <vtkDoubleArray.h>
+#include <vtkErrorCode.h>
 #include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkPointData.h>
 #include <vtkObjectFactory.h>
 #include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkVersion.h>
 
 // STD includes
@@ -44,15 +50,32 @@ vtkFITSWriter::vtkFITSWriter()
 {
   this->FileName = NULL;
   this->UseCompression = 0;
+  this->CompressionType = RICE_1;
+  this->QuantizeLevel = 0.;
+  this->TileDimensions[0] = 0;
+  this->TileDimensions[1] = 0;
+  this->TileDimensions[2] = 1;
   this->FileType = VTK_BINARY;
   this->WriteErrorOff();
   this->Attributes = new AttributeMapType;
   this->WriteStatus = 0;
+  this->fptr = NULL;
+  this->ImageDataType = 0;
+  this->SlabPlanes = 0;
+  this->StreamingSlabPlanes = 0;
+  this->CurrentSlab = 0;
+  this->NumberOfSlabs = 0;
+  for (int ii = 0; ii < 6; ii++)
+    {
+    this->WholeExtent[ii] = 0;
+    }
 }
 
 //----------------------------------------------------------------------------
 vtkFITSWriter::~vtkFITSWriter()
 {
+  this->CloseFile();
+
   if ( this->FileName )
     {
     delete [] this->FileName;
@@ -83,25 +106,66 @@ int StringToInt(const char* str)
 }
 
 //----------------------------------------------------------------------------
-float StringToDouble(const char* str)
+double StringToDouble(const char* str)
 {
   return StringToNumber<double>(str);
 }
 
 //----------------------------------------------------------------------------
-template <typename T> std::string NumberToString(T V)
+enum KeyTypes
 {
-    std::string stringValue;
-    std::stringstream strstream;
-    strstream << V;
-    strstream >> stringValue;
-    return stringValue;
+  SkipKey = 0,
+  IntegerKey,
+  DoubleKey,
+  StringKey,
+  GuessKey
+};
+
+//----------------------------------------------------------------------------
+bool KeyHasPrefix(const std::string &key, const char *prefix)
+{
+  return !key.compare(0, strlen(prefix), prefix);
 }
 
 //----------------------------------------------------------------------------
-std::string IntToString(int Value)
+// Type of the card of a key. Keys of the image structure are written by
+// fits_create_img (or by CFITSIO in the Z-keywords of a compressed HDU).
+KeyTypes GetKeyType(const std::string &key)
 {
-    return NumberToString<int>(Value);
+  if (KeyHasPrefix(key, "SIMPLE") || KeyHasPrefix(key, "EXTEND") ||
+      KeyHasPrefix(key, "BLOCKED") || KeyHasPrefix(key, "BITPIX") ||
+      KeyHasPrefix(key, "NAXIS"))
+    {
+    return SkipKey;
+    }
+  if (KeyHasPrefix(key, "BLANK"))
+    {
+    return IntegerKey;
+    }
+  if (KeyHasPrefix(key, "CTYPE") || KeyHasPrefix(key, "CUNIT") ||
+      KeyHasPrefix(key, "BUNIT") || KeyHasPrefix(key, "BTYPE") ||
+      KeyHasPrefix(key, "OBJECT") || KeyHasPrefix(key, "TELESCOP") ||
+      KeyHasPrefix(key, "INSTRUME") || KeyHasPrefix(key, "OBSERVER") ||
+      KeyHasPrefix(key, "ORIGIN") || KeyHasPrefix(key, "DUNIT") ||
+      KeyHasPrefix(key, "RADESYS") || KeyHasPrefix(key, "SPECSYS") ||
+      KeyHasPrefix(key, "DATE") || KeyHasPrefix(key, "CELLSCAL") ||
+      KeyHasPrefix(key, "DATATYPE"))
+    {
+    return StringKey;
+    }
+  if (KeyHasPrefix(key, "CRPIX") || KeyHasPrefix(key, "CRVAL") ||
+      KeyHasPrefix(key, "CDELT") || KeyHasPrefix(key, "CROTA") ||
+      KeyHasPrefix(key, "DRVAL") || KeyHasPrefix(key, "BMAJ") ||
+      KeyHasPrefix(key, "BMIN") || KeyHasPrefix(key, "BPA") ||
+      KeyHasPrefix(key, "BSCALE") || KeyHasPrefix(key, "BZERO") ||
+      KeyHasPrefix(key, "EPOCH") || KeyHasPrefix(key, "EQUINOX") ||
+      KeyHasPrefix(key, "RESTFREQ") || KeyHasPrefix(key, "DATAMIN") ||
+      KeyHasPrefix(key, "DATAMAX") || KeyHasPrefix(key, "RMS") ||
+      KeyHasPrefix(key, "NOISEMEAN"))
+    {
+    return DoubleKey;
+    }
+  return GuessKey;
 }
 }// end namespace
 
@@ -129,146 +193,449 @@ int vtkFITSWriter::FillInputPortInformation(
 
 
 //----------------------------------------------------------------------------
-// Writes all the data from the input.
-void vtkFITSWriter::WriteData()
+int vtkFITSWriter::ProcessRequest(vtkInformation *request,
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector)
 {
+  if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_EXTENT()))
+    {
+    return this->RequestUpdateExtent(request, inputVector, outputVector);
+    }
 
-  this->WriteErrorOff();
-  if (this->GetFileName() == NULL)
+  return this->Superclass::ProcessRequest(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSWriter::RequestUpdateExtent(vtkInformation *vtkNotUsed(request),
+                                       vtkInformationVector **inputVector,
+                                       vtkInformationVector *vtkNotUsed(outputVector))
+{
+  if (this->SlabPlanes <= 0)
     {
-    vtkErrorMacro("FileName has not been set. Cannot save file");
-    this->WriteErrorOn();
-    return;
+    return 1;
+    }
+
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  if (!inInfo || !inInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+    {
+    return 1;
+    }
+
+  if (this->CurrentSlab == 0)
+    {
+    inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), this->WholeExtent);
+    int planes = this->SlabPlanes;
+    int depth = this->WholeExtent[5] - this->WholeExtent[4] + 1;
+    // compressed tiles have to be written whole: a tile depth <= 0
+    // spans the whole third axis (see CreateImage), i.e. one slab
+    if (this->UseCompression && this->TileDimensions[2] <= 0)
+      {
+      planes = std::max(depth, 1);
+      }
+    else if (this->UseCompression && this->TileDimensions[2] > 1)
+      {
+      planes = ((planes + this->TileDimensions[2] - 1) / this->TileDimensions[2]) *
+               this->TileDimensions[2];
+      }
+    this->StreamingSlabPlanes = planes;
+    this->NumberOfSlabs = depth > 0 ? (depth + planes - 1) / planes : 1;
     }
 
-    // Fill in image information.
+  int extent[6];
+  this->GetSlabExtent(this->CurrentSlab, extent);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent, 6);
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSWriter::GetSlabExtent(int slab, int extent[6])
+{
+  for (int ii = 0; ii < 6; ii++)
+    {
+    extent[ii] = this->WholeExtent[ii];
+    }
+  extent[4] = this->WholeExtent[4] + slab * this->StreamingSlabPlanes;
+  extent[5] = std::min(extent[4] + this->StreamingSlabPlanes - 1, this->WholeExtent[5]);
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSWriter::RequestData(vtkInformation *request,
+                               vtkInformationVector **inputVector,
+                               vtkInformationVector *outputVector)
+{
+  if (this->SlabPlanes <= 0)
+    {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
 
   vtkImageData *input = this->GetInput();
-  vtkDataArray *array;
-  array = static_cast<vtkDataArray *> (input->GetPointData()->GetScalars());
-  int vtkType = array->GetDataType();
-  void *buffer = array->GetVoidPointer(0);
-  unsigned int naxes = input->GetDataDimension();
-  long int naxe[naxes];
-  int dim = 1;
+  if (this->CurrentSlab == 0)
+    {
+    this->SetErrorCode(vtkErrorCode::NoError);
+    this->WriteErrorOff();
+    this->InvokeEvent(vtkCommand::StartEvent, NULL);
+    this->UpdateProgress(0.);
 
-  //allocate FITS struct
-  remove(this->GetFileName());
-  fits_create_file(&fptr, this->GetFileName(), &WriteStatus);
+    if (this->GetFileName() == NULL)
+      {
+      vtkErrorMacro("FileName has not been set. Cannot save file");
+      this->WriteErrorOn();
+      this->SetErrorCode(vtkErrorCode::NoFileNameError);
+      this->InvokeEvent(vtkCommand::EndEvent, NULL);
+      return 1;
+      }
+
+    if (!input || !input->GetPointData()->GetScalars() ||
+        !this->CreateImage(input->GetPointData()->GetScalars()->GetDataType(),
+                           this->WholeExtent))
+      {
+      this->WriteErrorOn();
+      this->InvokeEvent(vtkCommand::EndEvent, NULL);
+      return 1;
+      }
+    }
+
+  int extent[6];
+  this->GetSlabExtent(this->CurrentSlab, extent);
+  bool written = this->WriteExtent(input, extent);
+
+  this->CurrentSlab++;
+  this->UpdateProgress(static_cast<double>(this->CurrentSlab) / this->NumberOfSlabs);
+  if (written && !this->AbortExecute && this->CurrentSlab < this->NumberOfSlabs)
+    {
+    request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+    return 1;
+    }
+
+  request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+  this->CloseFile();
+  if (!written || this->AbortExecute)
+    {
+    this->WriteErrorOn();
+    }
+  this->CurrentSlab = 0;
+  this->InvokeEvent(vtkCommand::EndEvent, NULL);
+  this->WriteTime.Modified();
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::CreateImage(int vtkType, const int wholeExtent[6])
+{
+  long naxe[3] = {1, 1, 1};
+  int naxes = 0;
+  for (int axii = 0; axii < 3; axii++)
+    {
+    long size = wholeExtent[2 * axii + 1] - wholeExtent[2 * axii] + 1;
+    if (size > 1)
+      {
+      naxes = axii + 1;
+      }
+    naxe[axii] = size;
+    }
+  if (naxes == 0)
+    {
+    naxes = 1;
+    }
+
+  if (this->ImageDataType != 0)
+    {
+    vtkType = this->ImageDataType;
+    }
 
-  switch (vtkType){
-    case  VTK_DOUBLE:
-      fits_create_img(fptr, DOUBLE_IMG, naxes, naxe, &WriteStatus);
+  int imageType;
+  switch (vtkType)
+    {
+    case VTK_DOUBLE:
+      imageType = DOUBLE_IMG;
       break;
     case VTK_FLOAT:
-      fits_create_img(fptr, FLOAT_IMG, naxes, naxe, &WriteStatus);
+      imageType = FLOAT_IMG;
+      break;
+    case VTK_SHORT:
+      imageType = SHORT_IMG;
       break;
-    case  VTK_SHORT:
-      fits_create_img(fptr, SHORT_IMG, naxes, naxe, &WriteStatus);
+    case VTK_INT:
+      imageType = LONG_IMG;
+      break;
+    case VTK_UNSIGNED_CHAR:
+      imageType = BYTE_IMG;
       break;
     default:
       vtkErrorMacro("Could not write data type");
-      return;
-  }
+      return false;
+    }
 
-  // write the header.
+  if (this->GetFileType() == VTK_ASCII)
+    {
+    vtkErrorMacro("In 3-DSlicer FITS table are not supported");
+    return false;
+    }
+
+  //allocate FITS struct
+  this->WriteStatus = 0;
+  remove(this->GetFileName());
+  if (fits_create_file(&fptr, this->GetFileName(), &WriteStatus))
+    {
+    fits_report_error(stderr, WriteStatus);
+    vtkErrorMacro("vtkFITSWriter::CreateImage : could not create " << this->GetFileName() << ".");
+    return false;
+    }
 
-  //fits_write_key
-  AttributeMapType::iterator ait;
-  for (ait = this->Attributes->begin(); ait != this->Attributes->end(); ++ait)
+  // the compression parameters have to be set before creating the image
+  if (this->UseCompression)
     {
-    std::size_t pos = ait->first.find("SlicerAstro.");
-    if (pos == std::string::npos)
+    long tileDim[3] = {1, 1, 1};
+    for (int axii = 0; axii < naxes; axii++)
       {
-      continue;
+      tileDim[axii] = this->TileDimensions[axii] > 0 ?
+        std::min<long>(this->TileDimensions[axii], naxe[axii]) : naxe[axii];
       }
-    std::string tmp = ait->first.substr(pos+12);
-    if ((!tmp.compare(0,6,"SIMPLE")) || (!tmp.compare(0,6,"EXTEND"))
-          || (!tmp.compare(0,7,"BLOCKED")))
+    // Rice and H-compress work on integers: unquantized floating point
+    // pixels can only be compressed losslessly with GZIP.
+    int compressionType = this->CompressionType;
+    if ((vtkType == VTK_FLOAT || vtkType == VTK_DOUBLE) && this->QuantizeLevel == 0. &&
+        compressionType != GZIP_1 && compressionType != GZIP_2)
       {
-      continue;
+      vtkWarningMacro("vtkFITSWriter::CreateImage : lossless compression of floating point "
+                      "data (QuantizeLevel = 0) is not supported by the requested "
+                      "compression type: " << this->GetFileName() << " is compressed with GZIP_1.");
+      compressionType = GZIP_1;
       }
-    std::string tmp2 = ait->second;
-    if (!tmp2.compare("UNDEFINED"))
+    fits_set_compression_type(fptr, compressionType, &WriteStatus);
+    fits_set_tile_dim(fptr, naxes, tileDim, &WriteStatus);
+    fits_set_quantize_level(fptr, this->QuantizeLevel, &WriteStatus);
+    if (WriteStatus)
       {
-      continue;
+      fits_report_error(stderr, WriteStatus);
+      vtkErrorMacro("vtkFITSWriter::CreateImage : could not set the compression parameters.");
+      this->CloseFile();
+      return false;
       }
-    std::string ts = ((ait->second).substr(0,1));
-    if ((!tmp.compare(0,6,"BITPIX")) || (!tmp.compare(0,5,"NAXIS"))
-            || (!tmp.compare(0,5,"BLANK")))
+    }
+
+  fits_create_img(fptr, imageType, naxes, naxe, &WriteStatus);
+
+  // write the header.
+  this->WriteHeaderKeys();
+
+  // Integer voxels are written as they are: if the volume has been loaded
+  // with its native data type, BSCALE and BZERO still describe them.
+  if (vtkType == VTK_SHORT || vtkType == VTK_INT || vtkType == VTK_UNSIGNED_CHAR)
+    {
+    fits_set_bscale(fptr, 1., 0., &WriteStatus);
+    }
+
+  if (WriteStatus)
+    {
+    fits_report_error(stderr, WriteStatus);
+    vtkErrorMacro("vtkFITSWriter::CreateImage : could not write the header of "
+                  << this->GetFileName() << ".");
+    this->CloseFile();
+    return false;
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSWriter::WriteHeaderKeys()
+{
+  const std::string prefix = "SlicerAstro.";
+
+  // the "SlicerAstro." keys are contiguous in the (sorted) attributes
+  AttributeMapType::const_iterator begin = this->Attributes->lower_bound(prefix);
+  AttributeMapType::const_iterator end = begin;
+  int numberOfKeys = 0;
+  while (end != this->Attributes->end() && KeyHasPrefix(end->first, prefix.c_str()))
+    {
+    ++end;
+    ++numberOfKeys;
+    }
+
+  // reserve the header blocks once
+  fits_set_hdrsize(fptr, numberOfKeys, &WriteStatus);
+
+  // the keys are unique and the HDU has only the keys of the image
+  // structure: append the cards instead of searching the header.
+  for (AttributeMapType::const_iterator ait = begin; ait != end && !WriteStatus; ++ait)
+    {
+    if (!ait->second.compare("UNDEFINED"))
       {
-      int ti = StringToInt((ait->second).c_str());;
-      fits_update_key(fptr, TINT, tmp.c_str(), &ti, "", &WriteStatus);
+      continue;
       }
-    else if (!(std::string::npos != ts.find_first_of("-1234567890"))
-               || (!tmp.compare(0,4,"DATE")) || (!tmp.compare(0, 8, "CELLSCAL"))
-               || (!tmp.compare(0,8,"DATATYPE")))
+    std::string key = ait->first.substr(prefix.size());
+    KeyTypes keyType = GetKeyType(key);
+    if (keyType == GuessKey)
       {
-      fits_update_key(fptr, TSTRING, tmp.c_str(), (char *) (ait->second).c_str(), "", &WriteStatus);
+      keyType = ait->second.find_first_of("-1234567890") == 0 ? DoubleKey : StringKey;
       }
-    else
+
+    switch (keyType)
       {
-      double td;
-      td = StringToDouble((ait->second).c_str());
-      fits_update_key(fptr, TDOUBLE, tmp.c_str(), &td, "", &WriteStatus);
+      case IntegerKey:
+        {
+        int ti = StringToInt(ait->second.c_str());
+        fits_write_key(fptr, TINT, key.c_str(), &ti, "", &WriteStatus);
+        break;
+        }
+      case DoubleKey:
+        {
+        double td = StringToDouble(ait->second.c_str());
+        fits_write_key(fptr, TDOUBLE, key.c_str(), &td, "", &WriteStatus);
+        break;
+        }
+      case StringKey:
+        fits_write_key(fptr, TSTRING, key.c_str(),
+                       const_cast<char*>(ait->second.c_str()), "", &WriteStatus);
+        break;
+      default:
+        break;
       }
     }
+}
 
-  // Write the FITS to file.
-  for (unsigned int axii=0; axii < naxes; axii++)
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::WriteExtent(vtkImageData *input, const int extent[6])
+{
+  if (!fptr)
     {
-    naxe[axii] = StringToInt(this->GetAttribute(("SlicerAstro.NAXIS"+IntToString(axii+1))));
-    dim *= naxe[axii];
+    return false;
     }
 
-  int fileType = this->GetFileType();
+  vtkDataArray *array = input ? input->GetPointData()->GetScalars() : NULL;
+  if (!array)
+    {
+    vtkErrorMacro("vtkFITSWriter::WriteExtent : no scalars to write.");
+    return false;
+    }
 
-  switch (fileType)
+  // the planes of extent are contiguous in the input only if the input
+  // holds whole rows and planes.
+  int inExtent[6];
+  input->GetExtent(inExtent);
+  if (inExtent[0] != extent[0] || inExtent[1] != extent[1] ||
+      inExtent[2] != extent[2] || inExtent[3] != extent[3] ||
+      inExtent[4] > extent[4] || inExtent[5] < extent[5])
     {
-    case VTK_BINARY:
-      switch (vtkType)
-        {
-        case  VTK_DOUBLE:
-          if(fits_write_img(fptr, TDOUBLE, 1, dim, buffer, &WriteStatus))
-            {
-            fits_report_error(stderr, WriteStatus);
-            vtkErrorMacro("Write: Error writing "<< this->GetFileName() << "\n");
-            this->WriteErrorOn();
-            }
-          break;
-        case VTK_FLOAT:
-          if(fits_write_img(fptr, TFLOAT, 1, dim, buffer, &WriteStatus))
-            {
-            fits_report_error(stderr, WriteStatus);
-            vtkErrorMacro("Write: Error writing "<< this->GetFileName() << "\n");
-            this->WriteErrorOn();
-            }
-          break;
-        case VTK_SHORT:
-          if(fits_write_img(fptr, TSHORT, 1, dim, buffer, &WriteStatus))
-            {
-            fits_report_error(stderr, WriteStatus);
-            vtkErrorMacro("Write: Error writing "<< this->GetFileName() << "\n");
-            this->WriteErrorOn();
-            }
-          break;
-        }
+    vtkErrorMacro("vtkFITSWriter::WriteExtent : the input does not contain the planes "
+                  << extent[4] << "-" << extent[5] << ".");
+    return false;
+    }
+
+  int dataType;
+  switch (array->GetDataType())
+    {
+    case VTK_DOUBLE:
+      dataType = TDOUBLE;
+      break;
+    case VTK_FLOAT:
+      dataType = TFLOAT;
+      break;
+    case VTK_SHORT:
+      dataType = TSHORT;
       break;
-    case VTK_ASCII:
-     vtkErrorMacro("In 3-DSlicer FITS table are not supported");
-    break;
-  }
+    case VTK_INT:
+      dataType = TINT;
+      break;
+    case VTK_UNSIGNED_CHAR:
+      dataType = TBYTE;
+      break;
+    default:
+      vtkErrorMacro("Could not write data type");
+      return false;
+    }
+
+  void *buffer = input->GetScalarPointer(extent[0], extent[2], extent[4]);
+
+  // FITS pixels are 1 based and relative to the first voxel of the image
+  long fpixel[3], lpixel[3];
+  for (int axii = 0; axii < 3; axii++)
+    {
+    fpixel[axii] = extent[2 * axii] - this->WholeExtent[2 * axii] + 1;
+    lpixel[axii] = extent[2 * axii + 1] - this->WholeExtent[2 * axii] + 1;
+    }
+
+  if (fits_write_subset(fptr, dataType, fpixel, lpixel, buffer, &WriteStatus))
+    {
+    fits_report_error(stderr, WriteStatus);
+    vtkErrorMacro("Write: Error writing "<< this->GetFileName() << "\n");
+    return false;
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSWriter::CloseFile()
+{
+  if (!fptr)
+    {
+    return;
+    }
 
   // Free the FITS struct
-  fits_close_file(fptr, &WriteStatus);
-  fits_report_error(stderr, WriteStatus);
+  int status = 0;
+  fits_close_file(fptr, &status);
+  if (status)
+    {
+    fits_report_error(stderr, status);
+    this->WriteErrorOn();
+    }
+  fptr = NULL;
+}
+
+//----------------------------------------------------------------------------
+// Writes all the data from the input.
+void vtkFITSWriter::WriteData()
+{
+
+  this->WriteErrorOff();
+  if (this->GetFileName() == NULL)
+    {
+    vtkErrorMacro("FileName has not been set. Cannot save file");
+    this->WriteErrorOn();
+    return;
+    }
+
+  vtkImageData *input = this->GetInput();
+  if (!input || !input->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("vtkFITSWriter::WriteData : no scalars to write.");
+    this->WriteErrorOn();
+    return;
+    }
+
+  input->GetExtent(this->WholeExtent);
+  if (!this->CreateImage(input->GetPointData()->GetScalars()->GetDataType(),
+                         this->WholeExtent))
+    {
+    this->WriteErrorOn();
+    return;
+    }
 
-  return;
+  // Write the FITS to file.
+  if (!this->WriteExtent(input, this->WholeExtent))
+    {
+    this->WriteErrorOn();
+    }
+
+  this->CloseFile();
 }
 
+//----------------------------------------------------------------------------
 void vtkFITSWriter::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "UseCompression: " << this->UseCompression << "\n";
+  os << indent << "CompressionType: " << this->CompressionType << "\n";
+  os << indent << "QuantizeLevel: " << this->QuantizeLevel << "\n";
+  os << indent << "TileDimensions: " << this->TileDimensions[0] << " "
+     << this->TileDimensions[1] << " " << this->TileDimensions[2] << "\n";
+  os << indent << "ImageDataType: " << this->ImageDataType << "\n";
+  os << indent << "SlabPlanes: " << this->SlabPlanes << "\n";
 }
 
 void vtkFITSWriter::SetAttribute(const std::string& name, const std::string& value)
@@ -58,15 +58,60 @@ public:
   vtkSetStringMacro(FileName);
   vtkGetStringMacro(FileName);
 
+  ///
+  /// Write the image as a tile-compressed HDU (fpack format).
+  /// Default is off.
   vtkSetMacro(UseCompression,int);
   vtkGetMacro(UseCompression,int);
   vtkBooleanMacro(UseCompression,int);
 
+  ///
+  /// CFITSIO compression algorithm: RICE_1 (default), GZIP_1,
+  /// GZIP_2 or HCOMPRESS_1. RICE_1 and HCOMPRESS_1 compress floating
+  /// point images only if QuantizeLevel is not 0: float and double
+  /// volumes written losslessly are compressed with GZIP_1 instead
+  /// (and a warning is issued).
+  vtkSetMacro(CompressionType,int);
+  vtkGetMacro(CompressionType,int);
+
+  ///
+  /// Quantization level of floating point pixels (noise sigma / q)
+  /// used by lossy compression. 0 (default) stores the pixels
+  /// losslessly, which is possible only with the GZIP algorithms
+  /// (see CompressionType).
+  vtkSetMacro(QuantizeLevel,float);
+  vtkGetMacro(QuantizeLevel,float);
+
+  ///
+  /// Size of the compression tiles along each axis. 0 means the whole
+  /// axis length. Default is one tile per plane: (0, 0, 1).
+  vtkSetVector3Macro(TileDimensions,int);
+  vtkGetVector3Macro(TileDimensions,int);
+
   vtkSetClampMacro(FileType,int,VTK_ASCII,VTK_BINARY);
   vtkGetMacro(FileType,int);
   void SetFileTypeToASCII() {this->SetFileType(VTK_ASCII);};
   void SetFileTypeToBinary() {this->SetFileType(VTK_BINARY);};
 
+  ///
+  /// Streaming mode: number of planes (along Z) requested from the
+  /// input and written in each pass. The input is updated one slab of
+  /// planes at a time and each slab is written as a subset of the image,
+  /// so the whole cube never has to be in memory. With compression the
+  /// slabs are rounded to whole tiles (a tile depth of 0 spans the whole
+  /// cube, which is then written in one slab). 0 (default) writes the
+  /// whole input at once.
+  vtkSetClampMacro(SlabPlanes,int,0,VTK_INT_MAX);
+  vtkGetMacro(SlabPlanes,int);
+
+  ///
+  /// VTK scalar type of the image on disk (BITPIX). CFITSIO converts the
+  /// pixels while writing, e.g. a VTK_SHORT label map whose labels are in
+  /// [0, 255] can be stored as VTK_UNSIGNED_CHAR (BITPIX = 8).
+  /// 0 (default) uses the type of the input.
+  vtkSetMacro(ImageDataType,int);
+  vtkGetMacro(ImageDataType,int);
+
   vtkBooleanMacro(WriteError, int);
   vtkSetMacro(WriteError, int);
   vtkGetMacro(WriteError, int);
@@ -82,10 +127,35 @@ protected:
 
   virtual int FillInputPortInformation(int port, vtkInformation *info);
 
+  virtual int ProcessRequest(vtkInformation *request,
+                             vtkInformationVector **inputVector,
+                             vtkInformationVector *outputVector);
+  virtual int RequestUpdateExtent(vtkInformation *request,
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector);
+  virtual int RequestData(vtkInformation *request,
+                          vtkInformationVector **inputVector,
+                          vtkInformationVector *outputVector);
+
   ///
   /// Write method. It is called by vtkWriter::Write();
   void WriteData();
 
+  ///
+  /// Create the file and write the header of an image of wholeExtent
+  bool CreateImage(int vtkType, const int wholeExtent[6]);
+
+  ///
+  /// Write the voxels of extent (whole rows and planes of WholeExtent)
+  bool WriteExtent(vtkImageData *input, const int extent[6]);
+
+  ///
+  /// Append the cards of the "SlicerAstro.*" attributes to the header
+  void WriteHeaderKeys();
+
+  void CloseFile();
+  void GetSlabExtent(int slab, int extent[6]);
+
   ///
   /// Flag to set to on when a write error occured
   int WriteError;
@@ -93,6 +163,9 @@ protected:
   char *FileName;
 
   int UseCompression;
+  int CompressionType;
+  float QuantizeLevel;
+  int TileDimensions[3];
   int FileType;
 
   AttributeMapType *Attributes;
@@ -100,6 +173,14 @@ protected:
   fitsfile *fptr;
   int WriteStatus;
 
+  int ImageDataType;
+
+  int SlabPlanes;
+  int StreamingSlabPlanes;
+  int CurrentSlab;
+  int NumberOfSlabs;
+  int WholeExtent[6];
+
 private:
   vtkFITSWriter(const vtkFITSWriter&);  /// Not implemented.
   void operator=(const vtkFITSWriter&);  /// Not implemented.